@@ -0,0 +1,94 @@
+#include "BVH.h"
+
+#include <algorithm>
+
+
+namespace {
+
+const uint32_t MAX_LEAF_SIZE = 4;
+// Keeps the traversal stack bounded even for degenerate input.
+const int MAX_DEPTH = 48;
+
+}
+
+
+void BVH::build(const std::vector<AABB>& newBoxes) {
+	boxes = newBoxes;
+	nodes.clear();
+	order.resize(boxes.size());
+	if (boxes.empty()) {
+		return;
+	}
+
+	std::vector<glm::vec3> centroids(boxes.size());
+	for (uint32_t i = 0; i < boxes.size(); ++i) {
+		order[i] = i;
+		centroids[i] = boxes[i].center();
+	}
+
+	nodes.reserve(2 * boxes.size() / MAX_LEAF_SIZE + 1);
+	buildNode(centroids, 0, uint32_t(boxes.size()), 0);
+}
+
+
+uint32_t BVH::buildNode(std::vector<glm::vec3>& centroids, uint32_t start, uint32_t count, int depth) {
+	uint32_t index = uint32_t(nodes.size());
+	nodes.push_back(Node{ AABB(), start, count, 0 });
+
+	AABB bounds;
+	AABB centroidBounds;
+	for (uint32_t i = start; i < start + count; ++i) {
+		bounds.expand(boxes[order[i]]);
+		centroidBounds.expand(centroids[order[i]]);
+	}
+	nodes[index].bounds = bounds;
+
+	if (count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH) {
+		return index;
+	}
+
+	glm::vec3 size = centroidBounds.max - centroidBounds.min;
+	int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+
+	uint32_t half = count / 2;
+	std::nth_element(order.begin() + start, order.begin() + start + half, order.begin() + start + count,
+		[&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+
+	buildNode(centroids, start, half, depth + 1);
+	uint32_t right = buildNode(centroids, start + half, count - half, depth + 1);
+	nodes[index].right = right;
+	return index;
+}
+
+
+void BVH::refit(const std::vector<AABB>& newBoxes) {
+	if (newBoxes.size() != boxes.size()) {
+		build(newBoxes);
+		return;
+	}
+	boxes = newBoxes;
+
+	// Children always come after their parent, so walking backwards visits
+	// them first.
+	for (size_t n = nodes.size(); n-- > 0;) {
+		Node& node = nodes[n];
+		AABB bounds;
+		if (node.right == 0) {
+			for (uint32_t i = node.start; i < node.start + node.count; ++i) {
+				bounds.expand(boxes[order[i]]);
+			}
+		}
+		else {
+			bounds = nodes[n + 1].bounds;
+			bounds.expand(nodes[node.right].bounds);
+		}
+		node.bounds = bounds;
+	}
+}
+
+
+void BVH::clear() {
+	nodes.clear();
+	order.clear();
+	boxes.clear();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Bounding volume hierarchy over a fixed set of boxes.
+//
+// build() sorts the boxes into a binary tree by splitting at the median
+// centroid along the widest axis. As long as the number of boxes stays the
+// same, refit() updates the tree for moved boxes in one bottom-up pass without
+// changing its shape.
+//
+// Nodes are stored in pre-order, so a node's left child directly follows it,
+// and the boxes under any node form one contiguous run of getOrder().
+//------------------------------------------------------------------------------
+
+#include "Bounds.h"
+
+#include <cstdint>
+#include <vector>
+
+class BVH {
+
+public:
+	enum Visibility { CULLED, PARTIAL, VISIBLE };
+
+	void build(const std::vector<AABB>& boxes);
+	void refit(const std::vector<AABB>& boxes);
+	void clear();
+
+	size_t size() const { return order.size(); }
+	size_t nodeCount() const { return nodes.size(); }
+
+	// Walks the tree from the root. classify(bounds, boxCount) decides each
+	// node: CULLED skips it, VISIBLE accepts every box under it without
+	// further tests, and PARTIAL descends (or, at a leaf, tests each box
+	// individually). visit(boxIndex) is called for every accepted box.
+	template <typename Classify, typename Visit>
+	void traverse(Classify&& classify, Visit&& visit) const {
+		if (nodes.empty()) {
+			return;
+		}
+
+		uint32_t stack[64];
+		int top = 0;
+		stack[top++] = 0;
+
+		while (top > 0) {
+			const Node& node = nodes[stack[--top]];
+			Visibility visibility = classify(node.bounds, node.count);
+			if (visibility == CULLED) {
+				continue;
+			}
+
+			if (visibility == VISIBLE) {
+				for (uint32_t i = node.start; i < node.start + node.count; ++i) visit(order[i]);
+			}
+			else if (node.right == 0) {
+				for (uint32_t i = node.start; i < node.start + node.count; ++i) {
+					if (classify(boxes[order[i]], 1) != CULLED) visit(order[i]);
+				}
+			}
+			else {
+				stack[top++] = node.right;
+				stack[top++] = uint32_t(&node - nodes.data()) + 1;
+			}
+		}
+	}
+
+private:
+	struct Node {
+		AABB bounds;
+		// The boxes under this node are order[start, start + count).
+		uint32_t start;
+		uint32_t count;
+		// Index of the right child, or 0 for a leaf.
+		uint32_t right;
+	};
+
+	uint32_t buildNode(std::vector<glm::vec3>& centroids, uint32_t start, uint32_t count, int depth);
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> order;
+	std::vector<AABB> boxes;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Axis-aligned boxes and view frustums for culling.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+
+struct AABB {
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	bool isEmpty() const { return min.x > max.x; }
+	glm::vec3 center() const { return 0.5f * (min + max); }
+	glm::vec3 extent() const { return 0.5f * (max - min); }
+
+	void expand(const glm::vec3& p) {
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	void expand(const AABB& other) {
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	// Box around this one after transformation by m.
+	AABB transformed(const glm::mat4& m) const {
+		if (isEmpty()) return *this;
+		glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+		glm::mat3 absolute(glm::abs(glm::vec3(m[0])), glm::abs(glm::vec3(m[1])), glm::abs(glm::vec3(m[2])));
+		glm::vec3 e = absolute * extent();
+		return AABB{ c - e, c + e };
+	}
+};
+
+
+struct Frustum {
+	enum Result { OUTSIDE, INTERSECTS, INSIDE };
+
+	// Planes as (normal, distance) with normals pointing inwards.
+	glm::vec4 planes[6];
+
+	// Extracts the planes of viewProjection (Gribb and Hartmann).
+	explicit Frustum(const glm::mat4& viewProjection) {
+		glm::mat4 m = glm::transpose(viewProjection);
+		planes[0] = m[3] + m[0];
+		planes[1] = m[3] - m[0];
+		planes[2] = m[3] + m[1];
+		planes[3] = m[3] - m[1];
+		planes[4] = m[3] + m[2];
+		planes[5] = m[3] - m[2];
+		for (glm::vec4& plane : planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+	}
+
+	Result test(const AABB& box) const {
+		glm::vec3 c = box.center();
+		glm::vec3 e = box.extent();
+		Result result = INSIDE;
+		for (const glm::vec4& plane : planes) {
+			float distance = glm::dot(glm::vec3(plane), c) + plane.w;
+			float radius = glm::dot(glm::abs(glm::vec3(plane)), e);
+			if (distance < -radius) return OUTSIDE;
+			if (distance < radius) result = INTERSECTS;
+		}
+		return result;
+	}
+};
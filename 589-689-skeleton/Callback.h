@@ -2,6 +2,7 @@
 
 #include "Window.h"
 #include "Camera.h"
+#include "FrameUniforms.h"
 #include "ShaderProgram.h"
 
 #include "glm/glm.hpp"
@@ -26,9 +27,7 @@ public:
 		, mouseOldY(-1.0)
 		, screenWidth(screenWidth)
 		, screenHeight(screenHeight)
-	{
-		updateUniformLocations();
-	}
+	{}
 
 	glm::ivec2 getMousePos() {
 		return glm::ivec2(mouseOldX, mouseOldY);
@@ -141,61 +140,72 @@ public:
 		}
 	}
 
+	// Computes the camera once for the frame and uploads it to the Frame
+	// blocks (see FrameUniforms). Must be called before any viewPipeline*().
+	void beginFrame() {
+		view = camera.getView();
+		projection = glm::perspective(glm::radians(45.0f), aspect, 0.01f, 1000.f);
+		glm::vec3 cameraPos = camera.getPos();
+		sceneFrame.update(view, projection, cameraPos);
+		editingFrame.update(view, glm::ortho(-aspect, aspect, -1.0f, 1.0f, -1.0f, 100.0f), cameraPos);
+		sceneFrame.bind();
+	}
+
+	// Each viewPipeline*() selects the frame block its shader reads V and P
+	// from and sets its model matrix. The shader must be in use.
 	void viewPipeline() {
-		glm::mat4 M = glm::mat4(1.0);
-		glm::mat4 V = camera.getView();
-		glm::mat4 P = glm::perspective(glm::radians(45.0f), aspect, 0.01f, 1000.f);
-		glUniformMatrix4fv(mLoc, 1, GL_FALSE, glm::value_ptr(M));
-		glUniformMatrix4fv(vLoc, 1, GL_FALSE, glm::value_ptr(V));
-		glUniformMatrix4fv(pLoc, 1, GL_FALSE, glm::value_ptr(P));
+		sceneFrame.bind();
+		shader.setModel(glm::mat4(1.0f));
 	}
 
 	void viewPipelinePicker() {
-		glm::mat4 M = glm::mat4(1.0);
-		glm::mat4 V = camera.getView();
-		glm::mat4 P = glm::perspective(glm::radians(45.0f), aspect, 0.01f, 1000.f);
-		glUniformMatrix4fv(mLocPicker, 1, GL_FALSE, glm::value_ptr(M));
-		glUniformMatrix4fv(vLocPicker, 1, GL_FALSE, glm::value_ptr(V));
-		glUniformMatrix4fv(pLocPicker, 1, GL_FALSE, glm::value_ptr(P));
+		sceneFrame.bind();
+		pickerShader.setModel(glm::mat4(1.0f));
 	}
 
 	void viewPipelineControlPoints(ShaderProgram& sp) {
-		glm::mat4 M = glm::mat4(1.0f);
-		glm::mat4 V = camera.getView();
-		glm::mat4 P = glm::perspective(glm::radians(45.0f), aspect, 0.01f, 1000.f);
-
-		GLint uniMat = glGetUniformLocation(sp, "M");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(M));
-		uniMat = glGetUniformLocation(sp, "V");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(V));
-		uniMat = glGetUniformLocation(sp, "P");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(P));
+		sceneFrame.bind();
+		sp.setModel(glm::mat4(1.0f));
 	}
 
 	void viewPipelinePlantPreview(const glm::mat4& modelMatrix) {
-		glm::mat4 M = modelMatrix;
-		glm::mat4 V = camera.getView();
-		glm::mat4 P = glm::perspective(glm::radians(45.0f), aspect, 0.01f, 1000.f);
-
-		GLint uniMat = glGetUniformLocation(shader, "M");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(M));
-		uniMat = glGetUniformLocation(shader, "V");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(V));
-		uniMat = glGetUniformLocation(shader, "P");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(P));
+		viewPipelinePlantPreview(shader, modelMatrix);
+	}
+
+	void viewPipelinePlantPreview(ShaderProgram& sp, const glm::mat4& modelMatrix) {
+		sceneFrame.bind();
+		sp.setModel(modelMatrix);
+	}
+
+	// For the instanced plant and impostor shaders, which also read
+	// cameraPos from the frame block. M is set per part by the caller, since
+	// every draw uses a different part transform.
+	void viewPipelineInstanced(ShaderProgram& sp) {
+		sceneFrame.bind();
+	}
+
+	// The same camera the view pipelines above use, for culling on the CPU.
+	glm::mat4 getViewProjection() const {
+		return projection * view;
+	}
+
+	glm::vec3 getCameraPos() const {
+		return glm::vec3(sceneFrame.getBlock().cameraPos);
+	}
+
+	// How many times the camera has changed enough to be uploaded again.
+	size_t getFrameUploads() const {
+		return sceneFrame.getUploads() + editingFrame.getUploads();
+	}
+
+	// Screen pixels covered by one unit seen from one unit away.
+	float getPixelsPerUnit() {
+		return static_cast<float>(screenHeight) * 0.5f / std::tan(glm::radians(45.0f) * 0.5f);
 	}
 
 	void viewPipelineEditing(ShaderProgram& sp) {
-		glm::mat4 M = glm::mat4(1.0f);
-		glm::mat4 V = camera.getView();
-		glm::mat4 P = glm::ortho(-aspect, aspect, -1.0f, 1.0f, -1.0f, 100.0f);
-
-		GLint uniMat = glGetUniformLocation(sp, "M");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(M));
-		uniMat = glGetUniformLocation(sp, "V");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(V));
-		uniMat = glGetUniformLocation(sp, "P");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, glm::value_ptr(P));
+		editingFrame.bind();
+		sp.setModel(glm::mat4(1.0f));
 	}
 
 	void updateShadingUniforms(
@@ -203,11 +213,19 @@ public:
 	)
 	{
 		// Like viewPipeline(), this function assumes shader.use() was called before.
-		glUniform3f(diffuseColLoc, diffuseCol.r, diffuseCol.g, diffuseCol.b);
-		glUniform3f(lightPosLoc, lightPos.x, lightPos.y, lightPos.z);
-		glUniform3f(lightColLoc, lightCol.r, lightCol.g, lightCol.b);
-		glUniform1f(ambientStrengthLoc, ambientStrength);
-		glUniform1i(texExistenceLoc, (int)texExistence);
+		updateShadingUniforms(shader, lightPos, lightCol, diffuseCol, ambientStrength, texExistence);
+	}
+
+	// Same as above, for a shader other than the default one. sp must be in use.
+	void updateShadingUniforms(
+		ShaderProgram& sp, const glm::vec3& lightPos, const glm::vec3& lightCol, glm::vec3& diffuseCol, float ambientStrength, bool texExistence
+	)
+	{
+		glUniform3f(sp.uniform("diffuseCol"), diffuseCol.r, diffuseCol.g, diffuseCol.b);
+		glUniform3f(sp.uniform("lightPos"), lightPos.x, lightPos.y, lightPos.z);
+		glUniform3f(sp.uniform("lightCol"), lightCol.r, lightCol.g, lightCol.b);
+		glUniform1f(sp.uniform("ambientStrength"), ambientStrength);
+		glUniform1i(sp.uniform("texExistence"), (int)texExistence);
 	}
 
 	glm::vec2 getCursorPosGL() {
@@ -229,28 +247,11 @@ public:
 		return temp + glm::vec2(camera.getLookAt());
 	}
 
-	Camera getCamera() {
+	const Camera& getCamera() const {
 		return camera;
 	}
 
 private:
-	// Uniform locations do not, ordinarily, change between frames.
-	// However, we may need to update them if the shader is changed and recompiled.
-	void updateUniformLocations() {
-		mLoc = glGetUniformLocation(shader, "M");
-		vLoc = glGetUniformLocation(shader, "V");
-		pLoc = glGetUniformLocation(shader, "P");
-		lightPosLoc = glGetUniformLocation(shader, "lightPos");
-		lightColLoc = glGetUniformLocation(shader, "lightCol");
-		ambientStrengthLoc = glGetUniformLocation(shader, "ambientStrength");
-		diffuseColLoc = glGetUniformLocation(shader, "diffuseCol");
-		texExistenceLoc = glGetUniformLocation(shader, "texExistence");
-
-		mLocPicker = glGetUniformLocation(pickerShader, "M");
-		vLocPicker = glGetUniformLocation(pickerShader, "V");
-		pLocPicker = glGetUniformLocation(pickerShader, "P");
-	}
-
 	int screenWidth;
 	int screenHeight;
 
@@ -261,26 +262,18 @@ private:
 	double mouseOldX;
 	double mouseOldY;
 
-	// Uniform locations
-	GLint mLoc;
-	GLint vLoc;
-	GLint pLoc;
-	GLint lightPosLoc;
-	GLint lightColLoc;
-	GLint diffuseColLoc;
-	GLint ambientStrengthLoc;
-	GLint texExistenceLoc;
-
-	// Uniform locations for Picker Shader
-	GLint mLocPicker;
-	GLint vLocPicker;
-	GLint pLocPicker;
-
 	ShaderProgram& shader;
 	ShaderProgram& pickerShader;
 
 	Camera camera;
 
+	// This frame's camera, from beginFrame(). The editing view shares the
+	// view matrix but projects orthographically.
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	FrameUniforms sceneFrame;
+	FrameUniforms editingFrame;
+
 	bool is3D = false;
 	glm::vec3 dragOffset = glm::vec3(0.0f, 0.0f, 0.0f);
 };
@@ -11,7 +11,7 @@ Camera::Camera(float t, float p, float r) : theta(t), phi(p), radius(r) {
 	lookat = glm::vec3(0.0f, 0.0f, 0.0f);
 }
 
-glm::mat4 Camera::getView() {
+glm::mat4 Camera::getView() const {
 	glm::vec3 offset = radius * glm::vec3(std::cos(theta) * std::sin(phi), std::sin(theta), std::cos(theta) * std::cos(phi));
 	glm::vec3 eye = lookat + offset;
 	glm::vec3 at = lookat;
@@ -20,7 +20,7 @@ glm::mat4 Camera::getView() {
 	return glm::lookAt(eye, at, up);
 }
 
-glm::vec3 Camera::getPos() {
+glm::vec3 Camera::getPos() const {
 	glm::vec3 offset = radius * glm::vec3(std::cos(theta) * std::sin(phi), std::sin(theta), std::cos(theta) * std::cos(phi));
 	return lookat + offset;
 }
@@ -47,7 +47,7 @@ void Camera::incrementR(float dr) {
 	}
 }
 
-Frame Camera::generateFrameVectors() {
+Frame Camera::generateFrameVectors() const {
 	glm::vec3 offset = radius * glm::vec3(std::cos(theta) * std::sin(phi), std::sin(theta), std::cos(theta) * std::cos(phi));
 	glm::vec3 eye = lookat + offset;
 	glm::vec3 n = glm::normalize(eye - lookat);
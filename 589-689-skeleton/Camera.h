@@ -20,9 +20,9 @@ public:
 
 	Camera(float t, float p, float r);
 
-	glm::mat4 getView();
-	glm::vec3 getPos();
-	glm::vec3 getLookAt() { return lookat; }
+	glm::mat4 getView() const;
+	glm::vec3 getPos() const;
+	glm::vec3 getLookAt() const { return lookat; }
 
 	void incrementTheta(float dt);
 	void incrementPhi(float dp);
@@ -35,7 +35,7 @@ public:
 		radius = r_;
 	}
 
-	Frame getFrame() {
+	Frame getFrame() const {
 		return generateFrameVectors();
 	}
 
@@ -46,5 +46,5 @@ private:
 	float phi;
 	float radius;
 
-	Frame generateFrameVectors();
+	Frame generateFrameVectors() const;
 };
@@ -0,0 +1,119 @@
+#include "DepthRaster.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+// Clip w below this counts as behind the camera.
+const float NEAR_W = 1e-2f;
+// Occluders must be this much nearer (relatively) than a box to hide it.
+const float DEPTH_BIAS = 0.02f;
+
+}
+
+
+DepthRaster::DepthRaster(int width, int height)
+	: width(width)
+	, height(height)
+	, viewProjection(1.0f)
+	, inverseDepth(size_t(width) * height, 0.0f)
+{}
+
+
+void DepthRaster::begin(const glm::mat4& vp) {
+	viewProjection = vp;
+	std::fill(inverseDepth.begin(), inverseDepth.end(), 0.0f);
+}
+
+
+void DepthRaster::rasterize(const std::vector<glm::vec3>& triangles) {
+	for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+		glm::vec2 screen[3];
+		float invW[3];
+		bool behind = false;
+
+		for (int k = 0; k < 3; ++k) {
+			glm::vec4 clip = viewProjection * glm::vec4(triangles[t + k], 1.0f);
+			if (clip.w < NEAR_W) {
+				behind = true;
+				break;
+			}
+			invW[k] = 1.0f / clip.w;
+			screen[k] = glm::vec2((clip.x * invW[k] * 0.5f + 0.5f) * static_cast<float>(width), (clip.y * invW[k] * 0.5f + 0.5f) * static_cast<float>(height));
+		}
+		if (behind) {
+			continue;
+		}
+
+		glm::vec2 e1 = screen[1] - screen[0];
+		glm::vec2 e2 = screen[2] - screen[0];
+		float area = e1.x * e2.y - e1.y * e2.x;
+		if (std::abs(area) < 1e-8f) {
+			continue;
+		}
+
+		int x0 = std::max(0, int(std::floor(std::min({ screen[0].x, screen[1].x, screen[2].x }))));
+		int x1 = std::min(width - 1, int(std::ceil(std::max({ screen[0].x, screen[1].x, screen[2].x }))));
+		int y0 = std::max(0, int(std::floor(std::min({ screen[0].y, screen[1].y, screen[2].y }))));
+		int y1 = std::min(height - 1, int(std::ceil(std::max({ screen[0].y, screen[1].y, screen[2].y }))));
+
+		for (int y = y0; y <= y1; ++y) {
+			for (int x = x0; x <= x1; ++x) {
+				glm::vec2 p = glm::vec2(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f) - screen[0];
+				float b1 = (p.x * e2.y - p.y * e2.x) / area;
+				float b2 = (e1.x * p.y - e1.y * p.x) / area;
+				float b0 = 1.0f - b1 - b2;
+				if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f) {
+					continue;
+				}
+
+				float depth = b0 * invW[0] + b1 * invW[1] + b2 * invW[2];
+				float& stored = inverseDepth[size_t(y) * width + x];
+				stored = std::max(stored, depth);
+			}
+		}
+	}
+}
+
+
+bool DepthRaster::isOccluded(const AABB& box) const {
+	if (box.isEmpty()) {
+		return false;
+	}
+
+	glm::vec2 low(FLT_MAX), high(-FLT_MAX);
+	float nearest = 0.0f;
+	for (int corner = 0; corner < 8; ++corner) {
+		glm::vec3 p((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y, (corner & 4) ? box.max.z : box.min.z);
+		glm::vec4 clip = viewProjection * glm::vec4(p, 1.0f);
+		if (clip.w < NEAR_W) {
+			return false;
+		}
+		float invW = 1.0f / clip.w;
+		glm::vec2 screen((clip.x * invW * 0.5f + 0.5f) * static_cast<float>(width), (clip.y * invW * 0.5f + 0.5f) * static_cast<float>(height));
+		low = glm::min(low, screen);
+		high = glm::max(high, screen);
+		nearest = std::max(nearest, invW);
+	}
+
+	int x0 = std::max(0, int(std::floor(low.x)) - 1);
+	int x1 = std::min(width - 1, int(std::ceil(high.x)) + 1);
+	int y0 = std::max(0, int(std::floor(low.y)) - 1);
+	int y1 = std::min(height - 1, int(std::ceil(high.y)) + 1);
+	if (x0 > x1 || y0 > y1) {
+		return false;
+	}
+
+	float threshold = nearest * (1.0f + DEPTH_BIAS);
+	for (int y = y0; y <= y1; ++y) {
+		const float* row = &inverseDepth[size_t(y) * width];
+		for (int x = x0; x <= x1; ++x) {
+			if (row[x] <= threshold) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
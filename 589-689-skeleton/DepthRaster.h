@@ -0,0 +1,42 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Coarse software depth buffer for occlusion culling.
+//
+// Occluder triangles are rasterized on the CPU at low resolution, keeping the
+// nearest depth per pixel. A box is occluded only if every pixel its screen
+// rectangle touches (plus a one pixel margin) holds an occluder clearly nearer
+// than the box's nearest corner, so the test errs towards drawing.
+//------------------------------------------------------------------------------
+
+#include "Bounds.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class DepthRaster {
+
+public:
+	DepthRaster(int width = 128, int height = 72);
+
+	// Clears the buffer and sets the camera subsequent calls use.
+	void begin(const glm::mat4& viewProjection);
+
+	// Adds a triangle list (three points per triangle) as occluders.
+	// Triangles crossing the near plane are skipped.
+	void rasterize(const std::vector<glm::vec3>& triangles);
+
+	bool isOccluded(const AABB& box) const;
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+private:
+	int width;
+	int height;
+	glm::mat4 viewProjection;
+	// 1 / clip w of the nearest occluder per pixel, 0 where there is none.
+	// Unlike w itself this interpolates linearly across the screen.
+	std::vector<float> inverseDepth;
+};
@@ -3,13 +3,27 @@
 #include <utility>
 
 
-ElementBuffer::ElementBuffer(GLuint index, GLint size, GLenum dataType)
+ElementBuffer::ElementBuffer()
 	: bufferID{}
 {
 }
 
 
+ElementBuffer::ElementBuffer(GLuint, GLint, GLenum)
+	: ElementBuffer()
+{
+}
+
+
 void ElementBuffer::uploadData(GLsizeiptr size, const void* data, GLenum usage) {
 	bind();
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, usage);
 }
+
+
+void ElementBuffer::updateData(GLintptr offset, GLsizeiptr size, const void* data) {
+	if (size > 0) {
+		bind();
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, data);
+	}
+}
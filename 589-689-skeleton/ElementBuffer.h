@@ -8,12 +8,16 @@
 class ElementBuffer {
 
 public:
+	ElementBuffer();
+	// Index buffers have no attribute; these arguments are ignored.
 	ElementBuffer(GLuint index, GLint size, GLenum dataType);
 
 	// Public interface
 	void bind() { glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferID); }
 
 	void uploadData(GLsizeiptr size, const void* data, GLenum usage);
+	// Overwrites size bytes at offset within storage from a prior uploadData().
+	void updateData(GLintptr offset, GLsizeiptr size, const void* data);
 
 private:
 	ElementBufferHandle bufferID;
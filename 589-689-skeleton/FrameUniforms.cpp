@@ -0,0 +1,32 @@
+#include "FrameUniforms.h"
+
+#include "GLState.h"
+
+#include <cstring>
+
+
+void FrameUniforms::update(const glm::mat4& V, const glm::mat4& P, const glm::vec3& cameraPos) {
+	Block next;
+	next.V = V;
+	next.P = P;
+	next.cameraPos = glm::vec4(cameraPos, 1.0f);
+	if (allocated && std::memcmp(&next, &block, sizeof(Block)) == 0) {
+		return;
+	}
+	block = next;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	if (!allocated) {
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), &block, GL_DYNAMIC_DRAW);
+		allocated = true;
+	}
+	else {
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+	}
+	uploads++;
+}
+
+
+void FrameUniforms::bind() const {
+	GLState::bindUniformBuffer(BINDING, buffer);
+}
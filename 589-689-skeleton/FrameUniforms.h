@@ -0,0 +1,49 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The per-frame camera, shared by every shader through one std140 uniform
+// block:
+//
+//     layout (std140) uniform Frame {
+//         mat4 V;
+//         mat4 P;
+//         vec4 cameraPos;
+//     };
+//
+// ShaderProgram binds any program declaring the block to BINDING when it is
+// linked, so the camera is uploaded once per frame rather than set on every
+// program before every draw. Programs read whichever buffer was bound last.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+
+#include <glm/glm.hpp>
+
+class FrameUniforms {
+
+public:
+	static const GLuint BINDING = 0;
+
+	// Laid out as the block above.
+	struct Block {
+		glm::mat4 V = glm::mat4(1.0f);
+		glm::mat4 P = glm::mat4(1.0f);
+		// w is unused.
+		glm::vec4 cameraPos = glm::vec4(0.0f);
+	};
+
+	// Uploads the camera unless it is the one already in the buffer.
+	void update(const glm::mat4& V, const glm::mat4& P, const glm::vec3& cameraPos);
+
+	// Makes this the buffer programs read the Frame block from.
+	void bind() const;
+
+	const Block& getBlock() const { return block; }
+	size_t getUploads() const { return uploads; }
+
+private:
+	VertexBufferHandle buffer;
+	Block block;
+	bool allocated = false;
+	size_t uploads = 0;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GLHandles.h"
+#include "GLState.h"
 #include "Renderbuffer.h"
 #include "Texture.h"
 #include <glad/glad.h>
@@ -17,14 +18,18 @@ public:
 	// https://en.cppreference.com/w/cpp/language/rule_of_three
 	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
 
-	void bind() { glBindFramebuffer(GL_FRAMEBUFFER, framebufferID); }
-	void unbind() { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+	void bind() { GLState::bindFramebuffer(framebufferID); }
+	void unbind() { GLState::bindFramebuffer(0); }
 
 	// "attachmentType" tells OpenGL whether the texture/buffer is for depth
 	// data, color data, stencil data, etc.
 	void addTextureAttachment(GLenum attachmentType, Texture& tex);
 	void addRenderbufferAttachment(GLenum attachmentType, Renderbuffer& rb);
 
+	operator GLuint() const {
+		return framebufferID;
+	}
+
 private:
 	FramebufferHandle framebufferID;
 
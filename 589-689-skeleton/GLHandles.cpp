@@ -1,5 +1,7 @@
 #include "GLHandles.h"
 
+#include "GLState.h"
+
 #include <algorithm> // For std::swap
 
 ShaderHandle::ShaderHandle(GLenum type)
@@ -59,6 +61,7 @@ ShaderProgramHandle& ShaderProgramHandle::operator=(ShaderProgramHandle&& other)
 
 
 ShaderProgramHandle::~ShaderProgramHandle() {
+	GLState::forgetProgram(programID);
 	glDeleteProgram(programID);
 }
 
@@ -96,6 +99,7 @@ VertexArrayHandle& VertexArrayHandle::operator=(VertexArrayHandle&& other) noexc
 
 
 VertexArrayHandle::~VertexArrayHandle() {
+	GLState::forgetVertexArray(vaoID);
 	glDeleteVertexArrays(1, &vaoID);
 }
 
@@ -133,6 +137,7 @@ VertexBufferHandle& VertexBufferHandle::operator=(VertexBufferHandle&& other) no
 
 
 VertexBufferHandle::~VertexBufferHandle() {
+	GLState::forgetBuffer(vboID);
 	glDeleteBuffers(1, &vboID);
 }
 
@@ -204,6 +209,7 @@ FramebufferHandle& FramebufferHandle::operator=(FramebufferHandle&& other) noexc
 
 
 FramebufferHandle::~FramebufferHandle() {
+	GLState::forgetFramebuffer(framebufferID);
 	glDeleteFramebuffers(1, &framebufferID);
 }
 
@@ -0,0 +1,181 @@
+#include "GLState.h"
+
+#include <unordered_map>
+
+
+namespace {
+
+// Stands for state the cache does not know, so the next call must reach GL.
+const GLuint UNKNOWN = ~0u;
+const GLenum UNKNOWN_ENUM = ~0u;
+const float UNKNOWN_FLOAT = -1.0f;
+
+// Uniform buffer binding points tracked; higher ones always reach GL.
+const GLuint UNIFORM_BINDINGS = 16;
+
+struct Cache {
+	GLuint program = UNKNOWN;
+	GLuint vertexArray = UNKNOWN;
+	GLuint framebuffer = UNKNOWN;
+	GLuint uniformBuffers[UNIFORM_BINDINGS];
+	GLenum polygonMode = UNKNOWN_ENUM;
+	float pointSize = UNKNOWN_FLOAT;
+	float lineWidth = UNKNOWN_FLOAT;
+	std::unordered_map<GLenum, bool> enabled;
+
+	Cache() {
+		for (GLuint& buffer : uniformBuffers) {
+			buffer = UNKNOWN;
+		}
+	}
+};
+
+Cache cache;
+GLState::Counts frameCounts;
+GLState::Counts lastFrameCounts;
+
+// Records the call and returns true if it has to be issued.
+template <typename T>
+bool change(T& cached, T value) {
+	if (cached == value) {
+		frameCounts.redundant++;
+		return false;
+	}
+	cached = value;
+	frameCounts.issued++;
+	return true;
+}
+
+}
+
+
+void GLState::useProgram(GLuint program) {
+	if (change(cache.program, program)) {
+		glUseProgram(program);
+	}
+}
+
+
+void GLState::bindVertexArray(GLuint vertexArray) {
+	if (change(cache.vertexArray, vertexArray)) {
+		glBindVertexArray(vertexArray);
+	}
+}
+
+
+void GLState::bindFramebuffer(GLuint framebuffer) {
+	if (change(cache.framebuffer, framebuffer)) {
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+}
+
+
+void GLState::bindUniformBuffer(GLuint binding, GLuint buffer) {
+	if (binding >= UNIFORM_BINDINGS) {
+		frameCounts.issued++;
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+		return;
+	}
+	if (change(cache.uniformBuffers[binding], buffer)) {
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+	}
+}
+
+
+void GLState::polygonMode(GLenum mode) {
+	if (change(cache.polygonMode, mode)) {
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+	}
+}
+
+
+void GLState::pointSize(float size) {
+	if (change(cache.pointSize, size)) {
+		glPointSize(size);
+	}
+}
+
+
+void GLState::lineWidth(float width) {
+	if (change(cache.lineWidth, width)) {
+		glLineWidth(width);
+	}
+}
+
+
+void GLState::setEnabled(GLenum capability, bool enabled) {
+	auto it = cache.enabled.find(capability);
+	if (it != cache.enabled.end() && it->second == enabled) {
+		frameCounts.redundant++;
+		return;
+	}
+	cache.enabled[capability] = enabled;
+	frameCounts.issued++;
+	if (enabled) {
+		glEnable(capability);
+	}
+	else {
+		glDisable(capability);
+	}
+}
+
+
+GLuint GLState::getFramebuffer() {
+	if (cache.framebuffer == UNKNOWN) {
+		GLint framebuffer = 0;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+		cache.framebuffer = GLuint(framebuffer);
+	}
+	return cache.framebuffer;
+}
+
+
+void GLState::forgetProgram(GLuint program) {
+	// A deleted program stays in use until another replaces it, but its
+	// name may be reused; only a fresh glUseProgram is safe.
+	if (program != 0 && cache.program == program) {
+		cache.program = UNKNOWN;
+	}
+}
+
+
+void GLState::forgetVertexArray(GLuint vertexArray) {
+	if (vertexArray != 0 && cache.vertexArray == vertexArray) {
+		cache.vertexArray = UNKNOWN;
+	}
+}
+
+
+void GLState::forgetFramebuffer(GLuint framebuffer) {
+	if (framebuffer != 0 && cache.framebuffer == framebuffer) {
+		cache.framebuffer = UNKNOWN;
+	}
+}
+
+
+void GLState::forgetBuffer(GLuint buffer) {
+	if (buffer == 0) {
+		return;
+	}
+	for (GLuint& bound : cache.uniformBuffers) {
+		if (bound == buffer) {
+			bound = UNKNOWN;
+		}
+	}
+}
+
+
+void GLState::invalidate() {
+	cache = Cache();
+}
+
+
+void GLState::beginFrame() {
+	lastFrameCounts = frameCounts;
+	frameCounts = Counts();
+}
+
+
+const GLState::Counts& GLState::getLastFrameCounts() {
+	return lastFrameCounts;
+}
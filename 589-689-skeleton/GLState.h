@@ -0,0 +1,55 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A cache of the GL binding and fixed-function state the scene changes most,
+// so that setting what is already set costs nothing.
+//
+// ShaderProgram::use(), VertexArray::bind(), Framebuffer::bind() and
+// FrameUniforms::bind() all go through here, as should any other code that
+// changes the state below. The GLHandles destructors tell the cache when a
+// bound object is deleted, since GL then falls back to 0 and the name may be
+// handed out again.
+//
+// Code that changes this state behind the cache's back (ImGui restores what
+// it changes, so it does not count) must call invalidate() afterwards.
+//------------------------------------------------------------------------------
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+namespace GLState {
+
+	struct Counts {
+		// Calls that reached GL.
+		size_t issued = 0;
+		// Calls dropped because the state was already set.
+		size_t redundant = 0;
+	};
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	void bindFramebuffer(GLuint framebuffer);
+	void bindUniformBuffer(GLuint binding, GLuint buffer);
+	void polygonMode(GLenum mode);
+	void pointSize(float size);
+	void lineWidth(float width);
+	void setEnabled(GLenum capability, bool enabled);
+
+	// The framebuffer bound through bindFramebuffer(), or GL's if unknown.
+	GLuint getFramebuffer();
+
+	// Called by the GLHandles destructors.
+	void forgetProgram(GLuint program);
+	void forgetVertexArray(GLuint vertexArray);
+	void forgetFramebuffer(GLuint framebuffer);
+	void forgetBuffer(GLuint buffer);
+
+	// Forgets everything, so the next call of each kind reaches GL.
+	void invalidate();
+
+	// Starts counting a new frame; getLastFrameCounts() then returns the
+	// frame that just ended.
+	void beginFrame();
+	const Counts& getLastFrameCounts();
+}
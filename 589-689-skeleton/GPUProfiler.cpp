@@ -0,0 +1,166 @@
+#include "GPUProfiler.h"
+
+#include <algorithm>
+
+
+namespace {
+
+double toMs(GLuint64 ns) {
+	return double(ns) / 1e6;
+}
+
+}
+
+
+GPUProfiler::~GPUProfiler() {
+	if (!allQueries.empty()) {
+		glDeleteQueries(GLsizei(allQueries.size()), allQueries.data());
+	}
+}
+
+
+int GPUProfiler::registerPass(const std::string& name) {
+	for (size_t i = 0; i < passes.size(); ++i) {
+		if (passes[i].name == name) {
+			return int(i);
+		}
+	}
+	Pass pass;
+	pass.name = name;
+	passes.push_back(pass);
+	return int(passes.size() - 1);
+}
+
+
+void GPUProfiler::beginFrame() {
+	// In case the last frame was never ended.
+	endFrame();
+
+	// Oldest first, so each pass's history stays in order.
+	for (int i = 1; i <= FRAME_LATENCY; ++i) {
+		Frame& frame = frames[(current + i) % FRAME_LATENCY];
+		if (frame.pending) {
+			frame.pending = !collect(frame);
+		}
+	}
+
+	measuring = false;
+	if (!enabled) {
+		return;
+	}
+	current = (current + 1) % FRAME_LATENCY;
+	if (frames[current].pending) {
+		skippedFrames++;
+		return;
+	}
+	measuring = true;
+}
+
+
+void GPUProfiler::endFrame() {
+	end();
+	if (measuring && !frames[current].queries.empty()) {
+		frames[current].pending = true;
+	}
+	measuring = false;
+}
+
+
+void GPUProfiler::begin(int pass) {
+	if (!measuring) {
+		return;
+	}
+	end();
+	GLuint query = acquireQuery();
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	frames[current].queries.push_back(Query{ query, pass });
+	running = true;
+}
+
+
+void GPUProfiler::end() {
+	if (running) {
+		glEndQuery(GL_TIME_ELAPSED);
+		running = false;
+	}
+}
+
+
+bool GPUProfiler::collect(Frame& frame) {
+	for (const Query& query : frame.queries) {
+		GLint available = 0;
+		glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			return false;
+		}
+	}
+
+	sums.assign(passes.size(), 0);
+	ran.assign(passes.size(), false);
+	for (const Query& query : frame.queries) {
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &elapsed);
+		sums[query.pass] += elapsed;
+		ran[query.pass] = true;
+		freeQueries.push_back(query.query);
+	}
+	frame.queries.clear();
+
+	// The first frame pays for first use of everything it draws, and
+	// llvmpipe reports nonsense for a query begun before its first draw.
+	if (!warmedUp) {
+		warmedUp = true;
+		return true;
+	}
+
+	for (size_t i = 0; i < passes.size(); ++i) {
+		if (!ran[i]) {
+			continue;
+		}
+		Pass& pass = passes[i];
+		if (pass.history.size() < size_t(HISTORY)) {
+			pass.history.push_back(sums[i]);
+		}
+		else {
+			pass.history[pass.next] = sums[i];
+		}
+		pass.next = (pass.next + 1) % HISTORY;
+	}
+	return true;
+}
+
+
+GLuint GPUProfiler::acquireQuery() {
+	if (freeQueries.empty()) {
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		allQueries.push_back(query);
+		return query;
+	}
+	GLuint query = freeQueries.back();
+	freeQueries.pop_back();
+	return query;
+}
+
+
+GPUProfiler::Stats GPUProfiler::stats(int pass) const {
+	Stats result;
+	const Pass& p = passes[pass];
+	if (p.history.empty()) {
+		return result;
+	}
+
+	std::vector<GLuint64> sorted = p.history;
+	std::sort(sorted.begin(), sorted.end());
+	GLuint64 total = 0;
+	for (GLuint64 ns : sorted) {
+		total += ns;
+	}
+	result.samples = sorted.size();
+	result.last = toMs(p.history[(p.next + HISTORY - 1) % HISTORY]);
+	result.mean = toMs(total) / static_cast<double>(sorted.size());
+	result.median = toMs(sorted[sorted.size() / 2]);
+	result.p95 = toMs(sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)]);
+	result.max = toMs(sorted.back());
+	return result;
+}
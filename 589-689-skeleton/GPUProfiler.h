@@ -0,0 +1,111 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Measures how long the GPU spends on each pass of a frame, using
+// GL_TIME_ELAPSED queries.
+//
+// Passes are registered once by name. During a frame, begin(pass) starts a
+// query for it, ending whichever query was running, since elapsed-time
+// queries cannot nest. A pass may be begun several times a frame (the render
+// queue interleaves passes when it sorts their draws); its queries are summed.
+//
+// Results are never waited for. Each frame's queries are kept until GL
+// reports them all available, usually a frame or two later, and only then
+// added to the pass's history. Queries come from a pool and go back to it
+// once read, so none are created per frame after the first few. If a frame's
+// slot is still waiting when it comes round again, FRAME_LATENCY frames on,
+// that frame is not measured rather than stalling on it. The first measured
+// frame is thrown away.
+//------------------------------------------------------------------------------
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+class GPUProfiler {
+
+public:
+	// Frames whose queries may be outstanding at once.
+	static const int FRAME_LATENCY = 4;
+	// Measured frames kept per pass for the statistics.
+	static const int HISTORY = 120;
+
+	struct Stats {
+		// In milliseconds, over the frames in the history that ran the pass.
+		double last = 0.0;
+		double mean = 0.0;
+		double median = 0.0;
+		double p95 = 0.0;
+		double max = 0.0;
+		size_t samples = 0;
+	};
+
+	GPUProfiler() = default;
+	~GPUProfiler();
+
+	GPUProfiler(const GPUProfiler&) = delete;
+	GPUProfiler& operator=(const GPUProfiler&) = delete;
+
+	// Returns the pass's id; registering a name again returns the same one.
+	int registerPass(const std::string& name);
+
+	// Reads back whatever earlier frames have finished, and starts this one.
+	void beginFrame();
+	// Ends the running query, if any.
+	void endFrame();
+
+	// Starts timing pass, ending the previous one's query.
+	void begin(int pass);
+	void end();
+
+	void setEnabled(bool enabled_) { enabled = enabled_; }
+	bool isEnabled() const { return enabled; }
+
+	size_t passCount() const { return passes.size(); }
+	const std::string& passName(int pass) const { return passes[pass].name; }
+	Stats stats(int pass) const;
+
+	// Frames not measured because their slot was still waiting on the GPU.
+	size_t getSkippedFrames() const { return skippedFrames; }
+
+private:
+	struct Pass {
+		std::string name;
+		// The last HISTORY measurements in nanoseconds, oldest overwritten first.
+		std::vector<GLuint64> history;
+		size_t next = 0;
+	};
+
+	struct Query {
+		GLuint query;
+		int pass;
+	};
+
+	struct Frame {
+		std::vector<Query> queries;
+		bool pending = false;
+	};
+
+	// Adds a finished frame's times to the passes and recycles its queries.
+	bool collect(Frame& frame);
+	GLuint acquireQuery();
+
+	std::vector<Pass> passes;
+	Frame frames[FRAME_LATENCY];
+	int current = 0;
+	// Whether this frame is being measured, and whether a query is running.
+	bool measuring = false;
+	bool running = false;
+	bool enabled = true;
+
+	std::vector<GLuint> freeQueries;
+	std::vector<GLuint> allQueries;
+	// Per-pass sums for the frame being collected, kept to avoid allocating.
+	std::vector<GLuint64> sums;
+	std::vector<bool> ran;
+
+	size_t skippedFrames = 0;
+	// Whether the first measured frame, which is discarded, has been read.
+	bool warmedUp = false;
+};
@@ -0,0 +1,120 @@
+#include "GPUSweep.h"
+
+#include "Log.h"
+
+#include <algorithm>
+
+
+bool GPUSweep::draw(PartHandle handle, const PlantPart& part, ShaderProgram& shader) {
+	std::unique_ptr<Entry>& slot = entries[keyOf(handle)];
+	if (!slot) {
+		slot = std::make_unique<Entry>();
+	}
+	Entry& entry = *slot;
+	upload(entry, part);
+
+	// A surface needs two rings and a profile that spans some distance.
+	if (!entry.profileValid || entry.rings < 2) {
+		return false;
+	}
+
+	if (!strips) {
+		strips = std::make_unique<VertexArray>();
+	}
+	strips->bind();
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, entry.ringTexture);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_BUFFER, entry.profileTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(shader.uniform("rings"), 1);
+	glUniform1i(shader.uniform("profile"), 2);
+	glUniform1i(shader.uniform("ringCount"), entry.rings);
+	glUniform1i(shader.uniform("curveSize"), entry.curveSize);
+	glUniformMatrix4fv(shader.uniform("profileMatrix"), 1, GL_FALSE, &entry.profileMatrix[0][0]);
+	glUniform3fv(shader.uniform("sweepColor"), 1, &part.getBaseColor()[0]);
+
+	// One strip per band, closing the ring by repeating its first sample.
+	int profilePoints = 2 * entry.curveSize - 2;
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (profilePoints + 1), entry.rings - 1);
+	return true;
+}
+
+
+void GPUSweep::collect(PlantStore& plants) {
+	for (auto it = entries.begin(); it != entries.end();) {
+		PartHandle handle{ uint32_t(it->first >> 32), uint32_t(it->first) };
+		if (!plants.getPart(handle)) {
+			it = entries.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+
+void GPUSweep::beginFrame() {
+	frameBytes = 0;
+}
+
+
+void GPUSweep::upload(Entry& entry, const PlantPart& part) {
+	const std::vector<glm::vec3>& left = part.getLeftCurve();
+	const std::vector<glm::vec3>& right = part.getRightCurve();
+	const std::vector<glm::vec3>& crossSection = part.getCrossSectionCurve();
+
+	bool ringsChanged = left != entry.left || right != entry.right;
+	bool profileChanged = crossSection != entry.crossSection;
+	if (entry.texturesAttached && !ringsChanged && !profileChanged) {
+		return;
+	}
+
+	if (ringsChanged || !entry.texturesAttached) {
+		entry.left = left;
+		entry.right = right;
+		entry.rings = int(std::min(left.size(), right.size()));
+
+		std::vector<glm::vec4> texels(size_t(entry.rings) * 2);
+		for (int i = 0; i < entry.rings; ++i) {
+			texels[2 * i] = glm::vec4(left[i], 1.0f);
+			texels[2 * i + 1] = glm::vec4(right[i], 1.0f);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, entry.ringBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * texels.size(), texels.data(), GL_DYNAMIC_DRAW);
+		frameBytes += sizeof(glm::vec4) * texels.size();
+		totalBytes += sizeof(glm::vec4) * texels.size();
+	}
+
+	if (profileChanged || !entry.texturesAttached) {
+		entry.crossSection = crossSection;
+		entry.curveSize = int(crossSection.size());
+		entry.profileValid = PlantPart::computeProfileMatrix(crossSection, entry.profileMatrix);
+
+		std::vector<glm::vec4> texels(crossSection.size());
+		for (size_t i = 0; i < crossSection.size(); ++i) {
+			texels[i] = glm::vec4(crossSection[i], 1.0f);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, entry.profileBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * texels.size(), texels.data(), GL_DYNAMIC_DRAW);
+		frameBytes += sizeof(glm::vec4) * texels.size();
+		totalBytes += sizeof(glm::vec4) * texels.size();
+	}
+
+	// The textures keep referring to the buffers across reallocations.
+	if (!entry.texturesAttached) {
+		glBindTexture(GL_TEXTURE_BUFFER, entry.ringTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, entry.ringBuffer);
+		glBindTexture(GL_TEXTURE_BUFFER, entry.profileTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, entry.profileBuffer);
+		entry.texturesAttached = true;
+
+		GLint maxTexels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+		if (size_t(entry.rings) * 2 > size_t(maxTexels)) {
+			Log::error("{} sweep rings exceed this GPU's buffer texture limit of {} texels", entry.rings, maxTexels);
+		}
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Sweep surfaces built on the GPU, for previewing parts while they are edited.
+//
+// Instead of waiting for a worker to regenerate a part's mesh, the left, right
+// and cross-section curve samples are uploaded as they are (a few hundred
+// bytes) to buffer textures, and sweep.vert rebuilds the surface from them:
+// one instance per band between two rings, drawn as a triangle strip whose
+// vertices pick their ring and profile sample from gl_InstanceID and
+// gl_VertexID. Positions follow PlantPart::generateSurfaceFast(); normals come
+// from central differences across neighbouring samples.
+//
+// Nothing is uploaded for a part whose curves have not changed since it was
+// last drawn.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "PlantPart.h"
+#include "PlantStore.h"
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class GPUSweep {
+
+public:
+	// Draws the part's surface with shader, which must be sweep.vert's
+	// program, in use with its model matrix, frame block and lighting set. Returns
+	// false if the curves describe no surface.
+	bool draw(PartHandle handle, const PlantPart& part, ShaderProgram& shader);
+
+	// Frees the buffers of parts that no longer exist in plants.
+	void collect(PlantStore& plants);
+
+	// Resets the per-frame upload counter.
+	void beginFrame();
+
+	size_t size() const { return entries.size(); }
+	size_t getFrameBytes() const { return frameBytes; }
+	size_t getTotalBytes() const { return totalBytes; }
+
+private:
+	struct Entry {
+		// Two texels per ring: its left and right curve points.
+		VertexBufferHandle ringBuffer;
+		TextureHandle ringTexture;
+		// The cross-section samples before normalisation.
+		VertexBufferHandle profileBuffer;
+		TextureHandle profileTexture;
+		bool texturesAttached = false;
+
+		// The curves currently in the buffers, kept to skip unchanged uploads.
+		std::vector<glm::vec3> left;
+		std::vector<glm::vec3> right;
+		std::vector<glm::vec3> crossSection;
+
+		glm::mat4 profileMatrix = glm::mat4(1.0f);
+		bool profileValid = false;
+		int rings = 0;
+		int curveSize = 0;
+	};
+
+	static uint64_t keyOf(PartHandle handle) {
+		return (uint64_t(handle.index) << 32) | handle.generation;
+	}
+
+	// Brings entry up to date with part's curves.
+	void upload(Entry& entry, const PlantPart& part);
+
+	std::unordered_map<uint64_t, std::unique_ptr<Entry>> entries;
+	// Attribute-less strips; made on first use.
+	std::unique_ptr<VertexArray> strips;
+
+	size_t frameBytes = 0;
+	size_t totalBytes = 0;
+};
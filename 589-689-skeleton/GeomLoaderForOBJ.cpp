@@ -3,11 +3,13 @@
 #include "GeomLoaderForOBJ.h"
 
 #include "Log.h";
+#include "Profiler.h"
 
 #include "tiny_obj_loader.h"
 
 // Most of this function is just boilerplate from tinyobjloader's GitHub README.
 CPU_Geometry GeomLoaderForOBJ::loadIntoCPUGeometry(std::string filename) {
+	PROFILE_SCOPE("GeomLoaderForOBJ::loadIntoCPUGeometry");
 	CPU_Geometry geom;
 
 	tinyobj::attrib_t attrib;
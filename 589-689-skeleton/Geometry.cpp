@@ -1,5 +1,8 @@
 #include "Geometry.h"
 
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
 #include <utility>
 
 
@@ -14,23 +17,199 @@ GPU_Geometry::GPU_Geometry()
 
 
 void GPU_Geometry::setVerts(const std::vector<glm::vec3>& verts) {
-	vertBuffer.uploadData(sizeof(glm::vec3) * verts.size(), verts.data(), GL_STATIC_DRAW);
+	upload(vertBuffer, sizeof(glm::vec3) * verts.size(), verts.data());
 }
 
 
 void GPU_Geometry::setUVs(const std::vector<glm::vec2>& uvs) {
-	uvBuffer.uploadData(sizeof(glm::vec2) * uvs.size(), uvs.data(), GL_STATIC_DRAW);
+	upload(uvBuffer, sizeof(glm::vec2) * uvs.size(), uvs.data());
 }
 
 void GPU_Geometry::setNormals(const std::vector<glm::vec3>& norms) {
-	normalsBuffer.uploadData(sizeof(glm::vec3) * norms.size(), norms.data(), GL_STATIC_DRAW);
+	upload(normalsBuffer, sizeof(glm::vec3) * norms.size(), norms.data());
 }
 
 void GPU_Geometry::setCols(const std::vector<glm::vec3>& cols) {
-	colBuffer.uploadData(sizeof(glm::vec3) * cols.size(), cols.data(), GL_STATIC_DRAW);
+	upload(colBuffer, sizeof(glm::vec3) * cols.size(), cols.data());
 }
 
 void GPU_Geometry::setIndices(const std::vector<unsigned int>& indices)
 {
 	ebo.uploadData(sizeof(unsigned int) * indices.size(), indices.data(), GL_STATIC_DRAW);
+}
+
+void GPU_Geometry::setIndices(const CompactIndices& indices)
+{
+	ebo.uploadData(indices.sizeInBytes(), indices.data(), GL_STATIC_DRAW);
+}
+
+
+void GPU_Geometry::upload(VertexBuffer& buffer, GLsizeiptr size, const void* data) {
+	if (stream) {
+		vao.bind();
+		buffer.streamData(*stream, size, data);
+	}
+	else {
+		buffer.uploadData(size, data, usage);
+	}
+}
+
+
+void GPU_Geometry::updateVerts(const std::vector<glm::vec3>& verts, size_t first, size_t count) {
+	vertBuffer.updateData(sizeof(glm::vec3) * first, sizeof(glm::vec3) * count, verts.data() + first);
+}
+
+void GPU_Geometry::updateUVs(const std::vector<glm::vec2>& uvs, size_t first, size_t count) {
+	uvBuffer.updateData(sizeof(glm::vec2) * first, sizeof(glm::vec2) * count, uvs.data() + first);
+}
+
+void GPU_Geometry::updateCols(const std::vector<glm::vec3>& cols, size_t first, size_t count) {
+	colBuffer.updateData(sizeof(glm::vec3) * first, sizeof(glm::vec3) * count, cols.data() + first);
+}
+
+void GPU_Geometry::updateNormals(const std::vector<glm::vec3>& norms, size_t first, size_t count) {
+	normalsBuffer.updateData(sizeof(glm::vec3) * first, sizeof(glm::vec3) * count, norms.data() + first);
+}
+
+void GPU_Geometry::updateIndices(const CompactIndices& indices, size_t first, size_t count) {
+	size_t indexSize = indices.type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	ebo.updateData(indexSize * first, indexSize * count, (const char*)indices.data() + indexSize * first);
+}
+
+
+void CompactIndices::assign(const std::vector<unsigned int>& indices, size_t vertexCount) {
+	clear();
+	if (vertexCount <= 65536) {
+		type = GL_UNSIGNED_SHORT;
+		shortIndices.assign(indices.begin(), indices.end());
+	}
+	else {
+		type = GL_UNSIGNED_INT;
+		intIndices = indices;
+	}
+}
+
+void CompactIndices::clear() {
+	shortIndices.clear();
+	intIndices.clear();
+	type = GL_UNSIGNED_INT;
+}
+
+
+PackedVertices PackedVertices::pack(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& colors, const Options& options)
+{
+	PackedVertices packed;
+	packed.count = positions.size();
+	size_t count = packed.count;
+
+	// Compact positions are stored relative to a cube around the mesh.
+	glm::vec3 center(0.0f);
+	float scale = 1.0f;
+	if (options.positions != VertexLayout::Format::FLOAT3 && count > 0) {
+		glm::vec3 low = positions[0];
+		glm::vec3 high = positions[0];
+		for (const glm::vec3& p : positions) {
+			low = glm::min(low, p);
+			high = glm::max(high, p);
+		}
+		center = (low + high) * 0.5f;
+		glm::vec3 half = (high - low) * 0.5f;
+		scale = std::max(std::max(half.x, half.y), half.z);
+		if (scale <= 0.0f) {
+			scale = 1.0f;
+		}
+		packed.decode = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(scale));
+	}
+
+	packed.layout.add(0, options.positions);
+
+	if (count > 0 && uvs.size() == count) {
+		bool unit = true;
+		for (const glm::vec2& uv : uvs) {
+			unit = unit && uv.x >= 0.0f && uv.x <= 1.0f && uv.y >= 0.0f && uv.y <= 1.0f;
+		}
+		packed.layout.add(1, unit ? VertexLayout::Format::UNORM16x2 : VertexLayout::Format::FLOAT2);
+	}
+
+	if (count > 0 && normals.size() == count) {
+		packed.layout.add(2, options.normals);
+	}
+
+	if (count > 0 && colors.size() == count) {
+		bool shared = true;
+		bool unit = true;
+		for (const glm::vec3& c : colors) {
+			shared = shared && c == colors[0];
+			unit = unit && glm::all(glm::greaterThanEqual(c, glm::vec3(0.0f))) && glm::all(glm::lessThanEqual(c, glm::vec3(1.0f)));
+		}
+		if (shared) {
+			packed.layout.addConstant(3, glm::vec4(colors[0], 1.0f));
+		}
+		else {
+			packed.layout.add(3, unit ? VertexLayout::Format::UNORM8x4 : VertexLayout::Format::HALF4);
+		}
+	}
+
+	GLsizei stride = packed.layout.getStride();
+	packed.bytes.resize(size_t(stride) * count);
+	for (size_t v = 0; v < count; ++v) {
+		unsigned char* vertex = packed.bytes.data() + size_t(stride) * v;
+		for (const VertexLayout::Attribute& attribute : packed.layout.getAttributes()) {
+			glm::vec4 value(0.0f);
+			switch (attribute.location) {
+			case 0: value = glm::vec4((positions[v] - center) / scale, 0.0f); break;
+			case 1: value = glm::vec4(uvs[v], 0.0f, 0.0f); break;
+			case 2: value = glm::vec4(normals[v], 0.0f); break;
+			case 3: value = glm::vec4(colors[v], 1.0f); break;
+			}
+			if (!attribute.constant) {
+				VertexLayout::encode(attribute.format, value, vertex + attribute.offset);
+			}
+		}
+	}
+	return packed;
+}
+
+
+PackedGeometry::PackedGeometry()
+	: vao()
+	, vertexBuffer()
+	, ebo()
+{}
+
+
+void PackedGeometry::upload(const PackedVertices& vertices, const CompactIndices& indices) {
+	vao.bind();
+
+	// Attributes the new layout lacks would otherwise keep reading the old
+	// offsets.
+	for (const VertexLayout::Attribute& attribute : layout.getAttributes()) {
+		glDisableVertexAttribArray(attribute.location);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.bytes.size(), vertices.bytes.data(), GL_STATIC_DRAW);
+	vertices.layout.apply(vertexBuffer);
+	ebo.uploadData(indices.sizeInBytes(), indices.data(), GL_STATIC_DRAW);
+
+	layout = vertices.layout;
+	decode = vertices.decode;
+	bytes = vertices.bytes.size() + indices.sizeInBytes();
+}
+
+
+void PackedGeometry::updateVertices(const PackedVertices& vertices, size_t first, size_t count) {
+	if (count == 0) {
+		return;
+	}
+	size_t stride = size_t(vertices.layout.getStride());
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, stride * first, stride * count, vertices.bytes.data() + stride * first);
+}
+
+
+void PackedGeometry::updateIndices(const CompactIndices& indices, size_t first, size_t count) {
+	size_t indexSize = indices.type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+	ebo.updateData(indexSize * first, indexSize * count, (const char*)indices.data() + indexSize * first);
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "VertexArray.h"
 #include "VertexBuffer.h"
 #include "ElementBuffer.h"
+#include "VertexLayout.h"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -25,6 +26,22 @@ struct CPU_Geometry {
 };
 
 
+// Triangle indices stored at the narrowest type that can address every vertex:
+// 16-bit when the mesh has at most 65536 vertices, 32-bit otherwise.
+struct CompactIndices {
+	std::vector<unsigned short> shortIndices;
+	std::vector<unsigned int> intIndices;
+	GLenum type = GL_UNSIGNED_INT;
+
+	void assign(const std::vector<unsigned int>& indices, size_t vertexCount);
+	void clear();
+
+	size_t count() const { return type == GL_UNSIGNED_SHORT ? shortIndices.size() : intIndices.size(); }
+	size_t sizeInBytes() const { return type == GL_UNSIGNED_SHORT ? shortIndices.size() * sizeof(unsigned short) : intIndices.size() * sizeof(unsigned int); }
+	const void* data() const { return type == GL_UNSIGNED_SHORT ? (const void*)shortIndices.data() : (const void*)intIndices.data(); }
+};
+
+
 // VAO and two VBOs for storing vertices and texture coordinates, respectively
 class GPU_Geometry {
 
@@ -39,8 +56,33 @@ public:
 	void setCols(const std::vector<glm::vec3>& cols);
 	void setNormals(const std::vector<glm::vec3>& norms);
 	void setIndices(const std::vector<unsigned int>& indices);
+	void setIndices(const CompactIndices& indices);
+
+	// The usage vertex data is uploaded with; GL_STATIC_DRAW by default.
+	// Geometry replaced often should use GL_DYNAMIC_DRAW, so uploads orphan
+	// the previous storage (see VertexBuffer::uploadData()).
+	void setUsage(GLenum usage_) { usage = usage_; }
+	// Once set, vertex data is written to stream instead, for geometry
+	// rebuilt every time it is drawn. It is only valid for the frame it was
+	// set in. Indices are unaffected.
+	void setStream(StreamBuffer* stream_) { stream = stream_; }
+
+	// Re-upload elements [first, first + count) of data previously passed to
+	// the matching setter, which must not have grown since. The VAO must be
+	// bound before updating indices.
+	void updateVerts(const std::vector<glm::vec3>& verts, size_t first, size_t count);
+	void updateUVs(const std::vector<glm::vec2>& uvs, size_t first, size_t count);
+	void updateCols(const std::vector<glm::vec3>& cols, size_t first, size_t count);
+	void updateNormals(const std::vector<glm::vec3>& norms, size_t first, size_t count);
+	void updateIndices(const CompactIndices& indices, size_t first, size_t count);
+
+	// Makes this geometry's own index buffer the VAO's again after drawing
+	// from another one. The VAO must be bound.
+	void bindIndices() { ebo.bind(); }
 
 private:
+	void upload(VertexBuffer& buffer, GLsizeiptr size, const void* data);
+
 	// note: due to how OpenGL works, vao needs to be
 	// defined and initialized before the vertex buffers
 	VertexArray vao;
@@ -51,4 +93,68 @@ private:
 
 	VertexBuffer colBuffer;
 	ElementBuffer ebo;
+
+	GLenum usage = GL_STATIC_DRAW;
+	StreamBuffer* stream = nullptr;
+};
+
+
+// Vertices packed into one interleaved array in a compact layout.
+struct PackedVertices {
+	struct Options {
+		VertexLayout::Format positions = VertexLayout::Format::SNORM16x4;
+		VertexLayout::Format normals = VertexLayout::Format::SNORM10x3;
+	};
+
+	VertexLayout layout;
+	std::vector<unsigned char> bytes;
+	size_t count = 0;
+	// Takes packed positions back to the originals, to be multiplied onto
+	// the model matrix. The scale is uniform, so normals only change length,
+	// which the fragment shaders normalise away.
+	glm::mat4 decode = glm::mat4(1.0f);
+
+	// Locations as GPU_Geometry: 0 position, 1 uv, 2 normal, 3 colour.
+	// Empty arrays are left out. Colours become a constant if every vertex
+	// has the same one, and are stored as bytes if none exceeds 1.
+	static PackedVertices pack(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+		const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& colors, const Options& options);
+};
+
+
+// GPU_Geometry's counterpart for PackedVertices: one interleaved vertex
+// buffer instead of one per attribute.
+class PackedGeometry {
+
+public:
+	PackedGeometry();
+
+	void bind() { vao.bind(); }
+
+	// Replaces the vertices and indices. Binds the VAO.
+	void upload(const PackedVertices& vertices, const CompactIndices& indices);
+
+	// Re-upload elements [first, first + count) of data in the layout of the
+	// last upload(), which must not have grown since. The VAO must be bound.
+	void updateVertices(const PackedVertices& vertices, size_t first, size_t count);
+	void updateIndices(const CompactIndices& indices, size_t first, size_t count);
+
+	// As GPU_Geometry::bindIndices().
+	void bindIndices() { ebo.bind(); }
+
+	// Must be called before every draw; see VertexLayout::applyConstants().
+	void applyConstants() const { layout.applyConstants(); }
+	const glm::mat4& getDecode() const { return decode; }
+	size_t getBytes() const { return bytes; }
+
+private:
+	// note: as in GPU_Geometry, vao must be initialized before the buffers
+	VertexArray vao;
+
+	VertexBufferHandle vertexBuffer;
+	ElementBuffer ebo;
+
+	VertexLayout layout;
+	glm::mat4 decode = glm::mat4(1.0f);
+	size_t bytes = 0;
 };
@@ -0,0 +1,104 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Generational handle pool.
+//
+// Objects live in a std::deque of slots, so they never move once created and
+// removing one does not shift the others. A handle is a slot index plus the
+// slot's generation at creation time; removing an object bumps the generation,
+// so stale handles resolve to nullptr instead of to whatever reused the slot.
+//------------------------------------------------------------------------------
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <utility>
+#include <vector>
+
+template <typename T>
+struct PoolHandle {
+	static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+	uint32_t index = INVALID_INDEX;
+	uint32_t generation = 0;
+
+	bool isValid() const { return index != INVALID_INDEX; }
+
+	bool operator==(const PoolHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const PoolHandle& other) const { return !(*this == other); }
+};
+
+
+template <typename T>
+class HandlePool {
+
+public:
+	using Handle = PoolHandle<T>;
+
+	template <typename... Args>
+	Handle emplace(Args&&... args) {
+		uint32_t index;
+		if (!freeSlots.empty()) {
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			index = static_cast<uint32_t>(slots.size());
+			slots.emplace_back();
+		}
+
+		Slot& slot = slots[index];
+		slot.value.emplace(std::forward<Args>(args)...);
+		liveCount++;
+		return Handle{ index, slot.generation };
+	}
+
+	bool remove(Handle handle) {
+		if (!get(handle)) {
+			return false;
+		}
+
+		Slot& slot = slots[handle.index];
+		slot.value.reset();
+		slot.generation++;
+		freeSlots.push_back(handle.index);
+		liveCount--;
+		return true;
+	}
+
+	T* get(Handle handle) {
+		if (handle.index >= slots.size()) return nullptr;
+		Slot& slot = slots[handle.index];
+		return slot.generation == handle.generation && slot.value ? &*slot.value : nullptr;
+	}
+
+	const T* get(Handle handle) const {
+		if (handle.index >= slots.size()) return nullptr;
+		const Slot& slot = slots[handle.index];
+		return slot.generation == handle.generation && slot.value ? &*slot.value : nullptr;
+	}
+
+	size_t size() const { return liveCount; }
+
+	// Calls fn(handle, object) for every live object, in slot order.
+	template <typename F>
+	void forEach(F&& fn) {
+		for (size_t i = 0; i < slots.size(); ++i) {
+			Slot& slot = slots[i];
+			if (slot.value) {
+				fn(Handle{ static_cast<uint32_t>(i), slot.generation }, *slot.value);
+			}
+		}
+	}
+
+private:
+	struct Slot {
+		std::optional<T> value;
+		// Starts at 1 so a default-constructed handle never matches.
+		uint32_t generation = 1;
+	};
+
+	std::deque<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+	size_t liveCount = 0;
+};
@@ -0,0 +1,211 @@
+#include "Headless.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+
+#include "Framebuffer.h"
+#include "GLState.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "Renderbuffer.h"
+#include "Texture.h"
+
+#include <argh.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+
+namespace {
+
+// How long the warm-up keeps drawing while meshes are still being built, in
+// seconds, before timing starts regardless.
+const double MAX_WARMUP_SECONDS = 30.0;
+
+struct FrameTime {
+	// From updateScene() until the draws were issued, and until they finished.
+	double cpuMs;
+	double totalMs;
+};
+
+double percentile(std::vector<double> values, double fraction) {
+	if (values.empty()) {
+		return 0.0;
+	}
+	size_t index = std::min(values.size() - 1, size_t(fraction * static_cast<double>(values.size() - 1) + 0.5));
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+bool positive(const char* name, int value) {
+	if (value <= 0) {
+		Log::error("HEADLESS --{} must be positive, got {}", name, value);
+		return false;
+	}
+	return true;
+}
+
+}
+
+
+bool Headless::parseArguments(int argc, char** argv, Settings& settings) {
+	argh::parser cmdl(argc, argv, argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
+
+	settings.enabled = cmdl["headless"];
+	settings.imgui = cmdl["imgui"];
+
+	std::string size;
+	if (cmdl("size") >> size) {
+		int width = 0;
+		int height = 0;
+		char separator = 0;
+		if (std::sscanf(size.c_str(), "%d%c%d", &width, &separator, &height) != 3 || (separator != 'x' && separator != 'X')) {
+			Log::error("HEADLESS --size must look like 640x480, got {}", size);
+			return false;
+		}
+		settings.width = width;
+		settings.height = height;
+	}
+
+	if (!(cmdl("frames", settings.frames) >> settings.frames)
+		|| !(cmdl("warmup", settings.warmupFrames) >> settings.warmupFrames)
+		|| !(cmdl("save-every", settings.saveEvery) >> settings.saveEvery)) {
+		Log::error("HEADLESS --frames, --warmup and --save-every take whole numbers");
+		return false;
+	}
+	cmdl("out", settings.output) >> settings.output;
+	cmdl("scene", settings.scene) >> settings.scene;
+	cmdl("trace", settings.trace) >> settings.trace;
+
+	if (settings.scene != "landscape" && settings.scene != "editing") {
+		Log::error("HEADLESS unknown --scene {}; expected landscape or editing", settings.scene);
+		return false;
+	}
+	return positive("size", settings.width) && positive("size", settings.height) && positive("frames", settings.frames)
+		&& settings.warmupFrames >= 0 && settings.saveEvery >= 0;
+}
+
+
+int Headless::run(Scene& scene, Window& window, const Settings& settings) {
+	const glm::ivec2 size = window.getFramebufferSize();
+	if (size.x != settings.width || size.y != settings.height) {
+		Log::warn("HEADLESS asked for {}x{} but the window's framebuffer is {}x{}", settings.width, settings.height, size.x, size.y);
+	}
+	Log::info("HEADLESS drawing {} frames of the {} scene at {}x{} on {}", settings.frames, settings.scene, size.x, size.y,
+		(const char*)glGetString(GL_RENDERER));
+
+	// sRGB, so that GL_FRAMEBUFFER_SRGB encodes the scene as it does on a
+	// window's sRGB-capable back buffer.
+	Texture color(0, GL_SRGB8_ALPHA8, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, GL_NEAREST);
+	Renderbuffer depth;
+	depth.setStorage(GL_DEPTH_COMPONENT24, size.x, size.y);
+	Framebuffer framebuffer;
+	framebuffer.addTextureAttachment(GL_COLOR_ATTACHMENT0, color);
+	framebuffer.addRenderbufferAttachment(GL_DEPTH_ATTACHMENT, depth);
+
+	framebuffer.bind();
+	auto fbStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (fbStatus != GL_FRAMEBUFFER_COMPLETE) {
+		Log::error("Error creating headless framebuffer : {}", fbStatus);
+		throw std::runtime_error("Framebuffer creation error!");
+	}
+	glViewport(0, 0, size.x, size.y);
+
+	scene.setRenderTarget(framebuffer);
+	scene.setImGuiEnabled(settings.imgui);
+	scene.setMode(settings.scene == "editing" ? 1 : 0);
+
+	auto drawFrame = [&]() {
+		glfwPollEvents();
+		scene.updateScene();
+		scene.draw();
+	};
+
+	auto warmupStart = std::chrono::steady_clock::now();
+	int warmedUp = 0;
+	for (;;) {
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - warmupStart).count();
+		if (warmedUp >= settings.warmupFrames && (!scene.hasBackgroundWork() || elapsed > MAX_WARMUP_SECONDS)) {
+			break;
+		}
+		drawFrame();
+		glFinish();
+		warmedUp++;
+	}
+	if (scene.hasBackgroundWork()) {
+		Log::warn("HEADLESS still building meshes after {} s of warm-up; timings may include them", MAX_WARMUP_SECONDS);
+	}
+
+	std::vector<FrameTime> times;
+	times.reserve(settings.frames);
+	std::vector<unsigned char> pixels(size_t(size.x) * size.y * 4);
+	bool saved = true;
+
+	for (int frame = 0; frame < settings.frames; ++frame) {
+		auto start = std::chrono::steady_clock::now();
+		drawFrame();
+		auto issued = std::chrono::steady_clock::now();
+		glFinish();
+		auto finished = std::chrono::steady_clock::now();
+
+		FrameTime time;
+		time.cpuMs = std::chrono::duration<double, std::milli>(issued - start).count();
+		time.totalMs = std::chrono::duration<double, std::milli>(finished - start).count();
+		times.push_back(time);
+		Log::info("HEADLESS frame {}: {:.3f} ms ({:.3f} ms issuing)", frame, time.totalMs, time.cpuMs);
+
+		bool last = frame == settings.frames - 1;
+		bool periodic = settings.saveEvery > 0 && frame % settings.saveEvery == 0;
+		if (!settings.output.empty() && (last || periodic)) {
+			// Outside the timings, since the readback stalls the pipeline.
+			GLState::bindFramebuffer(framebuffer);
+			glReadBuffer(GL_COLOR_ATTACHMENT0);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+			glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+			// glReadPixels returns the bottom row first, so hand stb the last
+			// row and a negative stride to write it top down.
+			std::string path = fmt::format("{}{:04d}.png", settings.output, frame);
+			int stride = size.x * 4;
+			if (stbi_write_png(path.c_str(), size.x, size.y, 4, pixels.data() + size_t(size.y - 1) * stride, -stride)) {
+				Log::info("HEADLESS saved {}", path);
+			}
+			else {
+				Log::error("HEADLESS could not write {}", path);
+				saved = false;
+			}
+		}
+	}
+
+	std::vector<double> totals;
+	double totalSum = 0.0;
+	double cpuSum = 0.0;
+	for (const FrameTime& time : times) {
+		totals.push_back(time.totalMs);
+		totalSum += time.totalMs;
+		cpuSum += time.cpuMs;
+	}
+	double mean = totalSum / static_cast<double>(totals.size());
+	Log::info("HEADLESS {} frames: mean {:.3f} ms ({:.1f} fps), min {:.3f}, median {:.3f}, 95th percentile {:.3f}, max {:.3f}; {:.3f} ms issuing on average",
+		totals.size(), mean, 1000.0 / mean, *std::min_element(totals.begin(), totals.end()), percentile(totals, 0.5),
+		percentile(totals, 0.95), *std::max_element(totals.begin(), totals.end()), cpuSum / static_cast<double>(times.size()));
+
+	const GPUProfiler& gpu = scene.getGPUProfiler();
+	for (size_t i = 0; i < gpu.passCount(); ++i) {
+		GPUProfiler::Stats stats = gpu.stats(int(i));
+		if (stats.samples > 0) {
+			Log::info("HEADLESS GPU {} over {} frames: mean {:.3f} ms, median {:.3f}, 95th percentile {:.3f}, max {:.3f}",
+				gpu.passName(int(i)), stats.samples, stats.mean, stats.median, stats.p95, stats.max);
+		}
+	}
+
+	if (!settings.trace.empty() && !Profiler::exportChromeTrace(settings.trace)) {
+		saved = false;
+	}
+
+	scene.setRenderTarget(0);
+	return saved ? 0 : 1;
+}
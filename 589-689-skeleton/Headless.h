@@ -0,0 +1,64 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Drawing without anyone watching, for performance runs and image regression
+// tests on build machines:
+//
+//     main --headless --scene landscape --size 640x480 --frames 120
+//          --out frames/landscape --save-every 30 --trace landscape.json
+//
+// The window is created hidden, and every frame is drawn into an offscreen
+// framebuffer (an sRGB colour texture and a depth renderbuffer) of the given
+// size rather than the window's back buffer. Frames are drawn back to back
+// whether or not anything changed, each timed from updateScene() until
+// glFinish() returns, and the timings are logged with a summary at the end,
+// followed by the GPU time of each pass (see GPUProfiler).
+// Frames are written to <out>NNNN.png with stb_image_write; without
+// --save-every, only the last.
+//
+// GLFW 3.3 still needs a display to create even a hidden window, so build
+// machines without one run it under a virtual server, e.g.
+//
+//     LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -s "-screen 0 1280x1024x24" ./main --headless ...
+//
+// which also forces Mesa's llvmpipe rasterizer.
+//------------------------------------------------------------------------------
+
+#include "Scene.h"
+#include "Window.h"
+
+#include <string>
+
+namespace Headless {
+
+	struct Settings {
+		bool enabled = false;
+		int width = 1200;
+		int height = 1200;
+		// Frames drawn and timed, after the warm-up.
+		int frames = 60;
+		// Frames drawn untimed first, so caches and background builds settle.
+		int warmupFrames = 10;
+		// Frames are saved as output followed by the frame number; empty to
+		// save none.
+		std::string output = "frame";
+		// Save every Nth frame as well as the last; 0 for only the last.
+		int saveEvery = 0;
+		// "landscape" or "editing".
+		std::string scene = "landscape";
+		// Where to save the CPU zones as a Chrome trace once done; empty for
+		// nowhere. See Profiler.h.
+		std::string trace;
+		// Draw the UI on top. Off by default since its frame time readout
+		// differs from run to run.
+		bool imgui = false;
+	};
+
+	// Reads the settings from the command line. Returns false, having
+	// logged why, if an option's value is invalid.
+	bool parseArguments(int argc, char** argv, Settings& settings);
+
+	// Draws the frames. window must have been created hidden with the
+	// settings' size. Returns the process exit status.
+	int run(Scene& scene, Window& window, const Settings& settings);
+}
@@ -0,0 +1,86 @@
+#include "ImpostorAtlas.h"
+
+#include "GLState.h"
+#include "Log.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cmath>
+#include <stdexcept>
+
+
+ImpostorAtlas::ImpostorAtlas()
+	: color(0, GL_RGBA8, FRAMES * FRAME_SIZE, FRAMES * FRAME_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR)
+	, normal(0, GL_RGBA8, FRAMES * FRAME_SIZE, FRAMES * FRAME_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR)
+{
+	depth.setStorage(GL_DEPTH_COMPONENT24, FRAMES * FRAME_SIZE, FRAMES * FRAME_SIZE);
+
+	framebuffer.addTextureAttachment(GL_COLOR_ATTACHMENT0, color);
+	framebuffer.addTextureAttachment(GL_COLOR_ATTACHMENT1, normal);
+	framebuffer.addRenderbufferAttachment(GL_DEPTH_ATTACHMENT, depth);
+
+	framebuffer.bind();
+	const GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, buffers);
+	auto fbStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	framebuffer.unbind();
+	if (fbStatus != GL_FRAMEBUFFER_COMPLETE)
+	{
+		Log::error("Error creating impostor framebuffer : {}", fbStatus);
+		throw std::runtime_error("Framebuffer creation error!");
+	}
+}
+
+
+glm::vec3 ImpostorAtlas::frameDirection(int x, int y) {
+	// Cell centre to [-1, 1], then decode; y is the octahedron's pole.
+	glm::vec2 e = (glm::vec2(x, y) + 0.5f) / float(FRAMES) * 2.0f - 1.0f;
+	glm::vec3 d(e.x, 1.0f - std::abs(e.x) - std::abs(e.y), e.y);
+	if (d.y < 0.0f) {
+		float dx = d.x;
+		d.x = (1.0f - std::abs(d.z)) * (dx >= 0.0f ? 1.0f : -1.0f);
+		d.z = (1.0f - std::abs(dx)) * (d.z >= 0.0f ? 1.0f : -1.0f);
+	}
+	return glm::normalize(d);
+}
+
+
+void ImpostorAtlas::bake(const AABB& bounds, ShaderProgram& shader, const std::function<void()>& drawPlant) {
+	center = bounds.center();
+	radius = std::max(glm::length(bounds.extent()), 1e-4f);
+
+	GLuint previousFramebuffer = GLState::getFramebuffer();
+	GLint previousViewport[4];
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	framebuffer.bind();
+	const GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const GLfloat clearDepth = 1.0f;
+	glClearBufferfv(GL_COLOR, 0, clearColor);
+	glClearBufferfv(GL_COLOR, 1, clearColor);
+	glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+	GLState::polygonMode(GL_FILL);
+
+	shader.use();
+	GLint vLoc = shader.uniform("V");
+	GLint pLoc = shader.uniform("P");
+	glm::mat4 P = glm::ortho(-radius, radius, -radius, radius, 0.0f, 4.0f * radius);
+	glUniformMatrix4fv(pLoc, 1, GL_FALSE, glm::value_ptr(P));
+
+	for (int y = 0; y < FRAMES; ++y) {
+		for (int x = 0; x < FRAMES; ++x) {
+			glm::vec3 direction = frameDirection(x, y);
+			// Must match the quad's basis in impostor.vert.
+			glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			glm::mat4 V = glm::lookAt(center + direction * 2.0f * radius, center, up);
+			glUniformMatrix4fv(vLoc, 1, GL_FALSE, glm::value_ptr(V));
+
+			glViewport(x * FRAME_SIZE, y * FRAME_SIZE, FRAME_SIZE, FRAME_SIZE);
+			drawPlant();
+		}
+	}
+
+	GLState::bindFramebuffer(previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Octahedral impostor atlas for one plant.
+//
+// The plant is rendered from FRAMES x FRAMES directions spread over the sphere
+// by an octahedral mapping: frame (x, y) looks at the plant from the direction
+// whose octahedral encoding falls in cell (x, y). Each frame stores unlit
+// colour in one texture and the plant-space normal in another, so a
+// camera-facing quad can later pick the frame nearest the view direction and
+// be lit like the real mesh. impostor.vert uses the same mapping.
+//------------------------------------------------------------------------------
+
+#include "Bounds.h"
+#include "Framebuffer.h"
+#include "Renderbuffer.h"
+#include "ShaderProgram.h"
+#include "Texture.h"
+
+#include <glm/glm.hpp>
+
+#include <functional>
+
+class ImpostorAtlas {
+
+public:
+	static const int FRAMES = 8;
+	static const int FRAME_SIZE = 64;
+
+	ImpostorAtlas();
+
+	// Renders the plant, which lies within bounds in plant space, into every
+	// frame. shader must take M, V and P like test.vert; V and P are set here
+	// per frame, and drawPlant issues the draws with shader in use. The
+	// previously bound framebuffer and viewport are restored afterwards.
+	void bake(const AABB& bounds, ShaderProgram& shader, const std::function<void()>& drawPlant);
+
+	// Plant-space direction from the plant towards the camera for frame (x, y).
+	static glm::vec3 frameDirection(int x, int y);
+
+	Texture& getColor() { return color; }
+	Texture& getNormal() { return normal; }
+	// The sphere every frame is fitted to.
+	glm::vec3 getCenter() const { return center; }
+	float getRadius() const { return radius; }
+
+private:
+	Texture color;
+	Texture normal;
+	Renderbuffer depth;
+	Framebuffer framebuffer;
+
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
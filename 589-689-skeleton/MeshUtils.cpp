@@ -0,0 +1,707 @@
+#include "MeshUtils.h"
+
+#include "Log.h"
+#include "ThreadPool.h"
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+	// Below these sizes the cost of waking workers outweighs the work itself.
+	const size_t MIN_TRIANGLES_PER_CHUNK = 8192;
+	const size_t MIN_VERTICES_PER_CHUNK = 16384;
+
+	// How much worse than the cache order optimizeOverdraw() may leave the
+	// ACMR, as a factor (the lambda of Tipsify's overdraw pass).
+	const float MAX_OVERDRAW_ACMR_GROWTH = 1.05f;
+
+	uint64_t edgeKey(unsigned int a, unsigned int b) {
+		return (uint64_t(a) << 32) | uint64_t(b);
+	}
+}
+
+std::vector<glm::vec3> MeshUtils::computeVertexNormals(const std::vector<glm::vec3>& verts, const std::vector<unsigned int>& indices) {
+	const size_t vertCount = verts.size();
+	const size_t triCount = indices.size() / 3;
+
+	std::vector<glm::vec3> normals(vertCount, glm::vec3(0.0f));
+	if (vertCount == 0) {
+		return normals;
+	}
+
+	ThreadPool& pool = ThreadPool::shared();
+
+	// Chunk 0 accumulates straight into the result; every other chunk gets its
+	// own buffer so no two threads ever write the same vertex.
+	std::vector<std::vector<glm::vec3>> partial(pool.chunkCount(triCount, MIN_TRIANGLES_PER_CHUNK));
+
+	pool.parallelFor(triCount, MIN_TRIANGLES_PER_CHUNK, [&](size_t begin, size_t end, size_t chunk) {
+		std::vector<glm::vec3>& acc = chunk == 0 ? normals : partial[chunk];
+		if (chunk != 0) {
+			acc.assign(vertCount, glm::vec3(0.0f));
+		}
+
+		for (size_t t = begin; t < end; ++t) {
+			unsigned int i0 = indices[3 * t];
+			unsigned int i1 = indices[3 * t + 1];
+			unsigned int i2 = indices[3 * t + 2];
+
+			// The cross product's length is twice the triangle's area.
+			glm::vec3 n = glm::cross(verts[i1] - verts[i0], verts[i2] - verts[i0]);
+			acc[i0] += n;
+			acc[i1] += n;
+			acc[i2] += n;
+		}
+	});
+
+	pool.parallelFor(vertCount, MIN_VERTICES_PER_CHUNK, [&](size_t begin, size_t end, size_t) {
+		for (size_t v = begin; v < end; ++v) {
+			glm::vec3 n = normals[v];
+			for (size_t c = 1; c < partial.size(); ++c) {
+				n += partial[c][v];
+			}
+
+			float length = glm::length(n);
+			normals[v] = length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+	});
+
+	return normals;
+}
+
+void MeshUtils::weldVertices(std::vector<glm::vec3>& verts, std::vector<unsigned int>& indices, float epsilon) {
+	auto cellOf = [epsilon](const glm::vec3& p) {
+		return glm::ivec3(glm::floor(p / epsilon));
+	};
+	auto cellKey = [](const glm::ivec3& c) {
+		// 21 bits per axis is plenty for the extents of a plant part.
+		return (uint64_t(c.x & 0x1FFFFF) << 42) | (uint64_t(c.y & 0x1FFFFF) << 21) | uint64_t(c.z & 0x1FFFFF);
+	};
+
+	std::unordered_map<uint64_t, std::vector<unsigned int>> grid;
+	std::vector<glm::vec3> welded;
+	std::vector<unsigned int> remap(verts.size());
+
+	for (size_t i = 0; i < verts.size(); ++i) {
+		glm::ivec3 cell = cellOf(verts[i]);
+		int match = -1;
+
+		// A neighbour within epsilon always lies in one of the 27 surrounding cells.
+		for (int dx = -1; dx <= 1 && match < 0; ++dx) {
+			for (int dy = -1; dy <= 1 && match < 0; ++dy) {
+				for (int dz = -1; dz <= 1 && match < 0; ++dz) {
+					auto it = grid.find(cellKey(cell + glm::ivec3(dx, dy, dz)));
+					if (it == grid.end()) continue;
+					for (unsigned int candidate : it->second) {
+						if (glm::length(welded[candidate] - verts[i]) <= epsilon) {
+							match = int(candidate);
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if (match < 0) {
+			match = int(welded.size());
+			welded.push_back(verts[i]);
+			grid[cellKey(cell)].push_back(unsigned(match));
+		}
+		remap[i] = unsigned(match);
+	}
+
+	std::vector<unsigned int> weldedIndices;
+	weldedIndices.reserve(indices.size());
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		unsigned int a = remap[indices[t]];
+		unsigned int b = remap[indices[t + 1]];
+		unsigned int c = remap[indices[t + 2]];
+		if (a == b || b == c || a == c) continue;
+
+		weldedIndices.push_back(a);
+		weldedIndices.push_back(b);
+		weldedIndices.push_back(c);
+	}
+
+	verts = std::move(welded);
+	indices = std::move(weldedIndices);
+}
+
+int MeshUtils::capBoundaryLoops(std::vector<glm::vec3>& verts, std::vector<unsigned int>& indices) {
+	std::unordered_map<uint64_t, int> directedEdges;
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		for (int e = 0; e < 3; ++e) {
+			directedEdges[edgeKey(indices[t + e], indices[t + (e + 1) % 3])]++;
+		}
+	}
+
+	// A boundary edge is one whose twin (the same edge walked the other way)
+	// belongs to no triangle.
+	std::unordered_multimap<unsigned int, unsigned int> boundaryNext;
+	for (const auto& edge : directedEdges) {
+		unsigned int a = unsigned(edge.first >> 32);
+		unsigned int b = unsigned(edge.first & 0xFFFFFFFF);
+		if (directedEdges.find(edgeKey(b, a)) == directedEdges.end()) {
+			boundaryNext.emplace(a, b);
+		}
+	}
+
+	int loops = 0;
+	while (!boundaryNext.empty()) {
+		auto startIt = boundaryNext.begin();
+		unsigned int start = startIt->first;
+
+		std::vector<unsigned int> loop;
+		unsigned int current = start;
+		while (true) {
+			auto it = boundaryNext.find(current);
+			if (it == boundaryNext.end()) break;
+
+			loop.push_back(current);
+			current = it->second;
+			boundaryNext.erase(it);
+			if (current == start) break;
+		}
+
+		if (loop.size() < 3) continue;
+
+		glm::vec3 centroid(0.0f);
+		for (unsigned int v : loop) {
+			centroid += verts[v];
+		}
+		centroid /= float(loop.size());
+
+		unsigned int centre = unsigned(verts.size());
+		verts.push_back(centroid);
+
+		// Boundary edges run a -> b in their own triangle, so the cap walks them b -> a.
+		for (size_t i = 0; i < loop.size(); ++i) {
+			indices.push_back(loop[(i + 1) % loop.size()]);
+			indices.push_back(loop[i]);
+			indices.push_back(centre);
+		}
+		loops++;
+	}
+	return loops;
+}
+
+bool MeshUtils::writeOBJ(const std::string& path, const std::vector<glm::vec3>& verts,
+	const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& indices) {
+
+	std::ofstream out(path);
+	if (!out) {
+		Log::error("Could not open {} for writing", path);
+		return false;
+	}
+
+	for (const auto& v : verts) {
+		out << "v " << v.x << " " << v.y << " " << v.z << "\n";
+	}
+	for (const auto& n : normals) {
+		out << "vn " << n.x << " " << n.y << " " << n.z << "\n";
+	}
+
+	bool hasNormals = normals.size() == verts.size();
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		out << "f";
+		for (int c = 0; c < 3; ++c) {
+			unsigned int i = indices[t + c] + 1;
+			if (hasNormals) out << " " << i << "//" << i;
+			else out << " " << i;
+		}
+		out << "\n";
+	}
+
+	Log::info("Wrote {} vertices and {} triangles to {}", verts.size(), indices.size() / 3, path);
+	return true;
+}
+
+namespace {
+	// Symmetric 4x4 matrix summing weighted squared distances to a set of
+	// planes, and the total weight.
+	struct Quadric {
+		double a[10] = {};
+		double weight = 0.0;
+
+		void addPlane(const glm::dvec3& n, double d, double w) {
+			double p[4] = { n.x, n.y, n.z, d };
+			int k = 0;
+			for (int i = 0; i < 4; ++i) {
+				for (int j = i; j < 4; ++j) {
+					a[k++] += w * p[i] * p[j];
+				}
+			}
+			weight += w;
+		}
+
+		void add(const Quadric& other) {
+			for (int i = 0; i < 10; ++i) a[i] += other.a[i];
+			weight += other.weight;
+		}
+
+		double evaluate(const glm::vec3& v) const {
+			double x = v.x, y = v.y, z = v.z;
+			return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+				+ a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+				+ a[7] * z * z + 2 * a[8] * z
+				+ a[9];
+		}
+	};
+
+	// Boundary planes are weighted this much more than faces.
+	const double BOUNDARY_WEIGHT = 100.0;
+	// Collapses that turn a triangle's normal by more than about 78 degrees
+	// are refused.
+	const float MIN_NORMAL_DOT = 0.2f;
+
+	struct Collapse {
+		double cost;
+		// cost over the quadric's weight: a mean squared distance.
+		double error;
+		unsigned int from;
+		unsigned int to;
+		uint32_t fromVersion;
+		uint32_t toVersion;
+
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+}
+
+std::vector<MeshUtils::SimplifiedLevel> MeshUtils::simplify(const std::vector<glm::vec3>& verts, const std::vector<unsigned int>& indices,
+	const std::vector<size_t>& targetTriangles) {
+
+	std::vector<SimplifiedLevel> levels;
+	const size_t triCount = indices.size() / 3;
+	if (triCount == 0 || targetTriangles.empty()) {
+		return levels;
+	}
+
+	std::vector<unsigned int> tris(indices.begin(), indices.begin() + triCount * 3);
+	std::vector<bool> alive(triCount, true);
+	std::vector<std::vector<uint32_t>> vertexTris(verts.size());
+	std::vector<Quadric> quadrics(verts.size());
+	std::unordered_map<uint64_t, int> edgeUse;
+
+	for (uint32_t t = 0; t < triCount; ++t) {
+		unsigned int v[3] = { tris[t * 3], tris[t * 3 + 1], tris[t * 3 + 2] };
+		glm::dvec3 cross = glm::cross(glm::dvec3(verts[v[1]] - verts[v[0]]), glm::dvec3(verts[v[2]] - verts[v[0]]));
+		double area = glm::length(cross);
+		if (area > 0.0) {
+			glm::dvec3 n = cross / area;
+			for (int c = 0; c < 3; ++c) {
+				quadrics[v[c]].addPlane(n, -glm::dot(n, glm::dvec3(verts[v[0]])), area);
+			}
+		}
+		for (int c = 0; c < 3; ++c) {
+			vertexTris[v[c]].push_back(t);
+			unsigned int a = v[c], b = v[(c + 1) % 3];
+			edgeUse[edgeKey(std::min(a, b), std::max(a, b))]++;
+		}
+	}
+
+	// Pin open boundaries with planes through each boundary edge, at right
+	// angles to its triangle.
+	for (uint32_t t = 0; t < triCount; ++t) {
+		unsigned int v[3] = { tris[t * 3], tris[t * 3 + 1], tris[t * 3 + 2] };
+		glm::dvec3 faceNormal = glm::cross(glm::dvec3(verts[v[1]] - verts[v[0]]), glm::dvec3(verts[v[2]] - verts[v[0]]));
+		for (int c = 0; c < 3; ++c) {
+			unsigned int a = v[c], b = v[(c + 1) % 3];
+			if (edgeUse[edgeKey(std::min(a, b), std::max(a, b))] != 1) {
+				continue;
+			}
+			glm::dvec3 edge = glm::dvec3(verts[b] - verts[a]);
+			glm::dvec3 n = glm::cross(edge, faceNormal);
+			double length = glm::length(n);
+			if (length <= 0.0) {
+				continue;
+			}
+			n /= length;
+			double weight = BOUNDARY_WEIGHT * glm::dot(edge, edge);
+			quadrics[a].addPlane(n, -glm::dot(n, glm::dvec3(verts[a])), weight);
+			quadrics[b].addPlane(n, -glm::dot(n, glm::dvec3(verts[b])), weight);
+		}
+	}
+
+	std::vector<uint32_t> version(verts.size(), 0);
+	std::vector<bool> removed(verts.size(), false);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+	// Queues the cheaper direction of collapsing edge (a, b).
+	auto consider = [&](unsigned int a, unsigned int b) {
+		Quadric q = quadrics[a];
+		q.add(quadrics[b]);
+		double toB = std::max(q.evaluate(verts[b]), 0.0);
+		double toA = std::max(q.evaluate(verts[a]), 0.0);
+		double weight = std::max(q.weight, 1e-30);
+		if (toB <= toA) queue.push(Collapse{ toB, toB / weight, a, b, version[a], version[b] });
+		else queue.push(Collapse{ toA, toA / weight, b, a, version[b], version[a] });
+	};
+
+	for (auto& edge : edgeUse) {
+		consider(unsigned(edge.first >> 32), unsigned(edge.first & 0xffffffffu));
+	}
+
+	// Whether moving from onto to keeps every surviving triangle of from facing
+	// roughly the same way.
+	auto keepsOrientation = [&](unsigned int from, unsigned int to) {
+		for (uint32_t t : vertexTris[from]) {
+			if (!alive[t]) continue;
+			unsigned int* v = &tris[t * 3];
+			if (v[0] == to || v[1] == to || v[2] == to) continue;
+
+			glm::vec3 p[3], q[3];
+			for (int c = 0; c < 3; ++c) {
+				p[c] = verts[v[c]];
+				q[c] = v[c] == from ? verts[to] : p[c];
+			}
+			glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+			float lengths = glm::length(before) * glm::length(after);
+			if (lengths <= 0.0f || glm::dot(before, after) < MIN_NORMAL_DOT * lengths) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	auto snapshot = [&](double maxError) {
+		SimplifiedLevel level;
+		for (uint32_t t = 0; t < triCount; ++t) {
+			if (alive[t]) level.indices.insert(level.indices.end(), &tris[t * 3], &tris[t * 3 + 3]);
+		}
+		level.error = float(std::sqrt(maxError));
+		levels.push_back(std::move(level));
+	};
+
+	size_t remaining = triCount;
+	size_t nextTarget = 0;
+	double maxError = 0.0;
+
+	while (nextTarget < targetTriangles.size()) {
+		if (remaining <= targetTriangles[nextTarget]) {
+			snapshot(maxError);
+			nextTarget++;
+			continue;
+		}
+		if (queue.empty()) {
+			// Nothing left to collapse; keep what we have only if it is a
+			// real step down from the last level.
+			size_t previous = levels.empty() ? triCount : levels.back().indices.size() / 3;
+			if (remaining < previous * 9 / 10) {
+				snapshot(maxError);
+			}
+			break;
+		}
+
+		Collapse collapse = queue.top();
+		queue.pop();
+		if (removed[collapse.from] || removed[collapse.to]
+			|| version[collapse.from] != collapse.fromVersion || version[collapse.to] != collapse.toVersion
+			|| !keepsOrientation(collapse.from, collapse.to)) {
+			continue;
+		}
+
+		for (uint32_t t : vertexTris[collapse.from]) {
+			if (!alive[t]) continue;
+			unsigned int* v = &tris[t * 3];
+			if (v[0] == collapse.to || v[1] == collapse.to || v[2] == collapse.to) {
+				alive[t] = false;
+				remaining--;
+				continue;
+			}
+			for (int c = 0; c < 3; ++c) {
+				if (v[c] == collapse.from) v[c] = collapse.to;
+			}
+			vertexTris[collapse.to].push_back(t);
+		}
+		vertexTris[collapse.from].clear();
+		removed[collapse.from] = true;
+		quadrics[collapse.to].add(quadrics[collapse.from]);
+		version[collapse.to]++;
+		maxError = std::max(maxError, collapse.error);
+
+		// Re-queue the edges around the merged vertex with its new quadric.
+		auto& around = vertexTris[collapse.to];
+		around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return !alive[t]; }), around.end());
+		std::sort(around.begin(), around.end());
+		around.erase(std::unique(around.begin(), around.end()), around.end());
+		for (uint32_t t : around) {
+			for (int c = 0; c < 3; ++c) {
+				unsigned int w = tris[t * 3 + c];
+				if (w != collapse.to) consider(collapse.to, w);
+			}
+		}
+	}
+	return levels;
+}
+
+namespace {
+	// Scoring from Forsyth's "Linear-Speed Vertex Cache Optimisation". The
+	// cache modelled is an LRU of CACHE_SIZE vertices; larger than real FIFO
+	// caches, which the order still suits.
+	const int CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	float vertexScore(int cachePosition, uint32_t liveTriangles) {
+		if (liveTriangles == 0) {
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			// The last triangle's vertices are scored lower, so the next
+			// triangle does not simply reuse the same edge.
+			if (cachePosition < 3) {
+				score = LAST_TRIANGLE_SCORE;
+			}
+			else {
+				score = std::pow(1.0f - float(cachePosition - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+		}
+		// Finish off vertices with few triangles left, so they can leave the cache.
+		return score + VALENCE_BOOST_SCALE * std::pow(float(liveTriangles), -VALENCE_BOOST_POWER);
+	}
+
+	// Simulates a FIFO cache of cacheSize vertices over indices and calls
+	// missed(t, misses) for every triangle t with its number of misses.
+	template <typename F>
+	void simulateFIFO(const std::vector<unsigned int>& indices, size_t vertexCount, size_t cacheSize, F missed) {
+		// Total misses when each vertex was last loaded, 0 for never: a
+		// vertex is still cached if fewer than cacheSize loads came since.
+		std::vector<size_t> loadedAt(vertexCount, 0);
+		size_t misses = 0;
+		for (size_t t = 0; t < indices.size() / 3; ++t) {
+			int triangleMisses = 0;
+			for (int c = 0; c < 3; ++c) {
+				unsigned int v = indices[3 * t + c];
+				if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize) {
+					misses++;
+					loadedAt[v] = misses;
+					triangleMisses++;
+				}
+			}
+			missed(t, triangleMisses);
+		}
+	}
+}
+
+float MeshUtils::computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, size_t cacheSize) {
+	size_t triCount = indices.size() / 3;
+	if (triCount == 0) {
+		return 0.0f;
+	}
+
+	size_t misses = 0;
+	simulateFIFO(indices, vertexCount, cacheSize, [&](size_t, int m) { misses += m; });
+	return float(misses) / float(triCount);
+}
+
+void MeshUtils::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount) {
+	const size_t triCount = indices.size() / 3;
+	if (triCount == 0) {
+		return;
+	}
+
+	// The triangles around each vertex, back to back; the first live[v] of
+	// vertex v's are the ones not yet emitted.
+	std::vector<uint32_t> firstTri(vertexCount + 1, 0);
+	for (size_t i = 0; i < triCount * 3; ++i) {
+		firstTri[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; ++v) {
+		firstTri[v + 1] += firstTri[v];
+	}
+	std::vector<uint32_t> vertexTris(triCount * 3);
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (size_t t = 0; t < triCount; ++t) {
+		for (int c = 0; c < 3; ++c) {
+			unsigned int v = indices[3 * t + c];
+			vertexTris[firstTri[v] + live[v]++] = uint32_t(t);
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> scores(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		scores[v] = vertexScore(-1, live[v]);
+	}
+
+	std::vector<float> triScores(triCount);
+	size_t best = 0;
+	for (size_t t = 0; t < triCount; ++t) {
+		triScores[t] = scores[indices[3 * t]] + scores[indices[3 * t + 1]] + scores[indices[3 * t + 2]];
+		if (triScores[t] > triScores[best]) {
+			best = t;
+		}
+	}
+
+	const size_t NONE = SIZE_MAX;
+	std::vector<bool> emitted(triCount, false);
+	std::vector<unsigned int> out;
+	out.reserve(triCount * 3);
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> next;
+	size_t scan = 0;
+
+	while (out.size() < triCount * 3) {
+		if (best == NONE) {
+			// Nothing cached touches a live triangle: start afresh from the
+			// first one left, which keeps the pass linear.
+			while (emitted[scan]) {
+				scan++;
+			}
+			best = scan;
+		}
+
+		emitted[best] = true;
+		const unsigned int* tri = &indices[3 * best];
+		out.insert(out.end(), tri, tri + 3);
+
+		for (int c = 0; c < 3; ++c) {
+			unsigned int v = tri[c];
+			uint32_t* around = &vertexTris[firstTri[v]];
+			uint32_t* end = around + live[v];
+			std::iter_swap(std::find(around, end, uint32_t(best)), end - 1);
+			live[v]--;
+		}
+
+		// The triangle's vertices move to the front of the cache.
+		next.assign(tri, tri + 3);
+		for (unsigned int v : cache) {
+			if (v != tri[0] && v != tri[1] && v != tri[2]) {
+				next.push_back(v);
+			}
+		}
+		for (size_t i = CACHE_SIZE; i < next.size(); ++i) {
+			cachePosition[next[i]] = -1;
+			scores[next[i]] = vertexScore(-1, live[next[i]]);
+		}
+		next.resize(std::min(next.size(), size_t(CACHE_SIZE)));
+		cache.swap(next);
+
+		for (size_t i = 0; i < cache.size(); ++i) {
+			cachePosition[cache[i]] = int(i);
+			scores[cache[i]] = vertexScore(int(i), live[cache[i]]);
+		}
+
+		// Only triangles around cached vertices changed score, so the
+		// next triangle is picked from those.
+		best = NONE;
+		float bestScore = -1.0f;
+		for (unsigned int v : cache) {
+			for (uint32_t i = firstTri[v]; i < firstTri[v] + live[v]; ++i) {
+				uint32_t t = vertexTris[i];
+				triScores[t] = scores[indices[3 * t]] + scores[indices[3 * t + 1]] + scores[indices[3 * t + 2]];
+				if (triScores[t] > bestScore) {
+					bestScore = triScores[t];
+					best = t;
+				}
+			}
+		}
+	}
+
+	indices.swap(out);
+}
+
+void MeshUtils::optimizeOverdraw(const std::vector<glm::vec3>& verts, std::vector<unsigned int>& indices, size_t cacheSize) {
+	const size_t triCount = indices.size() / 3;
+	if (triCount < 2) {
+		return;
+	}
+
+	std::vector<size_t> clusterStarts;
+	simulateFIFO(indices, verts.size(), cacheSize, [&](size_t t, int misses) {
+		if (t == 0 || misses == 3) {
+			clusterStarts.push_back(t);
+		}
+	});
+	clusterStarts.push_back(triCount);
+	if (clusterStarts.size() <= 2) {
+		return;
+	}
+
+	struct Cluster {
+		size_t first;
+		size_t last;
+		glm::vec3 centroid;
+		glm::vec3 normal;
+		float sortKey;
+	};
+	std::vector<Cluster> clusters;
+
+	// Both centroids are area weighted.
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c + 1 < clusterStarts.size(); ++c) {
+		Cluster cluster{ clusterStarts[c], clusterStarts[c + 1], glm::vec3(0.0f), glm::vec3(0.0f), 0.0f };
+		float area = 0.0f;
+		for (size_t t = cluster.first; t < cluster.last; ++t) {
+			const glm::vec3& a = verts[indices[3 * t]];
+			const glm::vec3& b = verts[indices[3 * t + 1]];
+			const glm::vec3& d = verts[indices[3 * t + 2]];
+			glm::vec3 n = glm::cross(b - a, d - a);
+			float triArea = glm::length(n);
+			cluster.centroid += (a + b + d) / 3.0f * triArea;
+			cluster.normal += n;
+			area += triArea;
+		}
+		meshCentroid += cluster.centroid;
+		meshArea += area;
+		cluster.centroid = area > 0.0f ? cluster.centroid / area : verts[indices[3 * cluster.first]];
+		clusters.push_back(cluster);
+	}
+	if (meshArea <= 0.0f) {
+		return;
+	}
+	meshCentroid /= meshArea;
+
+	for (Cluster& cluster : clusters) {
+		float length = glm::length(cluster.normal);
+		cluster.sortKey = length > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / length) : 0.0f;
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+		return a.sortKey > b.sortKey;
+	});
+
+	std::vector<unsigned int> out;
+	out.reserve(indices.size());
+	for (const Cluster& cluster : clusters) {
+		out.insert(out.end(), indices.begin() + 3 * cluster.first, indices.begin() + 3 * cluster.last);
+	}
+
+	// A cluster's first triangle is all misses in the old order, but may
+	// still find some of its vertices cached after its new neighbour.
+	// Whatever happens, keep the new order only if it costs little.
+	float before = computeACMR(indices, verts.size(), cacheSize);
+	float after = computeACMR(out, verts.size(), cacheSize);
+	if (after <= before * MAX_OVERDRAW_ACMR_GROWTH) {
+		indices.swap(out);
+	}
+}
+
+std::vector<unsigned int> MeshUtils::optimizeVertexFetch(std::vector<unsigned int>& indices, size_t vertexCount) {
+	const unsigned int UNUSED = UINT_MAX;
+	std::vector<unsigned int> remap(vertexCount, UNUSED);
+	unsigned int next = 0;
+	for (unsigned int& index : indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+	for (unsigned int& target : remap) {
+		if (target == UNUSED) {
+			target = next++;
+		}
+	}
+	return remap;
+}
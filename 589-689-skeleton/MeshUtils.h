@@ -0,0 +1,84 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// CPU-side helpers for indexed triangle meshes: smooth normals, vertex welding,
+// closing open boundaries, simplification and reordering for the GPU's vertex
+// caches.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace MeshUtils {
+	// Area-weighted per-vertex normals. Each triangle adds its unnormalized
+	// cross product to its three corners, so larger faces count for more.
+	// Large meshes accumulate into per-chunk buffers on the shared ThreadPool.
+	std::vector<glm::vec3> computeVertexNormals(const std::vector<glm::vec3>& verts, const std::vector<unsigned int>& indices);
+
+	// Merges vertices closer than epsilon, rewrites indices to the survivors and
+	// drops triangles that collapse as a result.
+	void weldVertices(std::vector<glm::vec3>& verts, std::vector<unsigned int>& indices, float epsilon);
+
+	// Closes every boundary loop (edge used by exactly one triangle) with a fan
+	// around the loop's centroid. Returns the number of loops capped.
+	int capBoundaryLoops(std::vector<glm::vec3>& verts, std::vector<unsigned int>& indices);
+
+	struct SimplifiedLevel {
+		std::vector<unsigned int> indices;
+		// Root of the largest mean squared distance, to the planes it
+		// stood for, of any vertex merged so far: roughly how far the
+		// surface moved.
+		float error = 0.0f;
+	};
+
+	// Quadric error metric simplification. Edges are collapsed onto one of
+	// their own vertices, cheapest first, so every level still indexes verts
+	// and needs no new vertex data. Open boundaries are held in place and
+	// collapses that would flip a triangle are refused.
+	//
+	// Returns one level per target triangle count, which must be decreasing.
+	// Stops early, with fewer levels, once nothing more can be collapsed.
+	std::vector<SimplifiedLevel> simplify(const std::vector<glm::vec3>& verts, const std::vector<unsigned int>& indices,
+		const std::vector<size_t>& targetTriangles);
+
+	// Average cache miss ratio: post-transform vertex cache misses per
+	// triangle, simulating a FIFO cache of cacheSize vertices. 0.5 is the
+	// ideal for large regular grids and 3 the worst possible.
+	float computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, size_t cacheSize = 16);
+
+	// Reorders triangles so consecutive ones share vertices still in the
+	// post-transform cache (Forsyth's linear-speed optimisation). Vertices
+	// are not touched.
+	void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+	// Splits an optimizeVertexCache() order into clusters where the
+	// simulated cache has nothing left to reuse, and draws the clusters
+	// facing furthest out from the mesh's centre first, so they tend to hide
+	// the rest. Only those boundaries are used, so the ACMR should barely
+	// move; the new order is kept only if the ACMR, measured before and
+	// after, grows by at most 5%, and indices are left as they were
+	// otherwise.
+	void optimizeOverdraw(const std::vector<glm::vec3>& verts, std::vector<unsigned int>& indices, size_t cacheSize = 16);
+
+	// Renumbers vertices in the order indices first use them, so fetches
+	// walk the vertex buffers forwards. Unused vertices go last. Returns the
+	// new index of each old vertex, for remapVertices().
+	std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int>& indices, size_t vertexCount);
+
+	// Moves each element of a per-vertex array to its place in remap, which
+	// must have one entry per element.
+	template <typename T>
+	void remapVertices(std::vector<T>& data, const std::vector<unsigned int>& remap) {
+		std::vector<T> moved(data.size());
+		for (size_t v = 0; v < data.size(); ++v) {
+			moved[remap[v]] = data[v];
+		}
+		data.swap(moved);
+	}
+
+	// Writes positions, normals and faces as a Wavefront .obj file.
+	bool writeOBJ(const std::string& path, const std::vector<glm::vec3>& verts,
+		const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& indices);
+};
@@ -3,8 +3,13 @@
 #include <string>
 #include <vector>
 #include <glm/glm.hpp>
+#include "HandlePool.h"
 #include "PlantPart.h"
 
+using PartHandle = PoolHandle<PlantPart>;
+
+// A plant is a named list of handles into the PlantStore's part pool, so
+// copying one copies handles rather than part data.
 class Plant {
 public:
     Plant(const std::string& name)
@@ -26,26 +31,27 @@ public:
         modelMatrix = matrix;
     }
 
-    void addPart(const PlantPart& part) {
+    void addPart(PartHandle part) {
         parts.push_back(part);
     }
 
-    void removePart(int index) {
-        if (index >= 0 && index < parts.size()) {
+    // Returns the handle that was removed (invalid if index is out of range).
+    // Freeing the part itself is up to the caller.
+    PartHandle removePart(int index) {
+        PartHandle removed;
+        if (index >= 0 && index < static_cast<int>(parts.size())) {
+            removed = parts[index];
             parts.erase(parts.begin() + index);
         }
+        return removed;
     }
 
-    const std::vector<PlantPart>& getParts() const {
-        return parts;
-    }
-
-    std::vector<PlantPart>& getParts() {
+    const std::vector<PartHandle>& getParts() const {
         return parts;
     }
 
 private:
     std::string name;
-    std::vector<PlantPart> parts;
+    std::vector<PartHandle> parts;
     glm::mat4 modelMatrix;
-};
\ No newline at end of file
+};
@@ -0,0 +1,117 @@
+#include "PlantLodBuilder.h"
+
+#include "MeshUtils.h"
+#include "ThreadPool.h"
+
+#include <unordered_map>
+
+
+namespace {
+
+// Each level aims for half the triangles of the one before, down to this.
+const size_t MIN_LOD_TRIANGLES = 24;
+const size_t MAX_LODS = 5;
+
+}
+
+
+size_t PlantLodBuilder::submit(PlantStore& plants) {
+	if (batch) {
+		return 0;
+	}
+
+	auto newBatch = std::make_shared<Batch>();
+	std::unordered_map<const PlantPartMesh*, size_t> jobByMesh;
+
+	plants.forEachPart([&](PartHandle, PlantPart& part) {
+		const auto& mesh = part.getMesh();
+		// Dirty parts are about to get another mesh anyway.
+		if (mesh->lodsBuilt || mesh->surface.empty() || !part.isSurfaceGenerated()) {
+			return;
+		}
+		if (jobByMesh.count(mesh.get())) {
+			return;
+		}
+
+		jobByMesh[mesh.get()] = newBatch->jobs.size();
+		newBatch->jobs.push_back(Job{ mesh, part.getInputHash(), nullptr });
+	});
+
+	if (newBatch->jobs.empty()) {
+		return 0;
+	}
+
+	newBatch->remaining = newBatch->jobs.size();
+	newBatch->start = Clock::now();
+
+	ThreadPool& pool = ThreadPool::shared();
+	newBatch->futures.reserve(newBatch->jobs.size());
+	for (size_t i = 0; i < newBatch->jobs.size(); ++i) {
+		Batch* b = newBatch.get();
+		newBatch->futures.push_back(pool.submit([newBatch, b, i]() {
+			Job& job = b->jobs[i];
+			job.mesh = std::make_shared<PlantPartMesh>(*job.source);
+			buildChain(*job.mesh);
+
+			Clock::time_point now = Clock::now();
+			if (b->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				b->end = now;
+			}
+		}));
+	}
+
+	batch = std::move(newBatch);
+	return batch->jobs.size();
+}
+
+
+bool PlantLodBuilder::publish(PlantStore& plants) {
+	if (!batch || batch->remaining.load(std::memory_order_acquire) != 0) {
+		return false;
+	}
+
+	for (auto& f : batch->futures) {
+		f.get();
+	}
+
+	std::unordered_map<const PlantPartMesh*, const Job*> jobBySource;
+	for (const Job& job : batch->jobs) {
+		jobBySource[job.source.get()] = &job;
+		cache.insert(job.inputHash, job.mesh);
+	}
+
+	plants.forEachPart([&](PartHandle, PlantPart& part) {
+		auto it = jobBySource.find(part.getMesh().get());
+		if (it != jobBySource.end()) {
+			part.setMesh(it->second->mesh, it->second->inputHash);
+		}
+	});
+
+	lastBatchMs = std::chrono::duration<double, std::milli>(batch->end - batch->start).count();
+	lastBatchSize = batch->jobs.size();
+
+	batch.reset();
+	return true;
+}
+
+
+void PlantLodBuilder::buildChain(PlantPartMesh& mesh) {
+	mesh.lods.clear();
+	mesh.lodsBuilt = true;
+
+	std::vector<size_t> targets;
+	for (size_t t = mesh.indices.size() / 6; t >= MIN_LOD_TRIANGLES && targets.size() < MAX_LODS; t /= 2) {
+		targets.push_back(t);
+	}
+
+	for (MeshUtils::SimplifiedLevel& level : MeshUtils::simplify(mesh.surface, mesh.indices, targets)) {
+		// Collapses scatter the full mesh's order, so each level is
+		// reordered for the cache again. It shares the vertices, so their
+		// order stays as it is.
+		MeshUtils::optimizeVertexCache(level.indices, mesh.surface.size());
+		PlantPartMesh::Lod lod;
+		lod.indices.assign(level.indices, mesh.surface.size());
+		lod.error = level.error;
+		mesh.lods.push_back(std::move(lod));
+	}
+}
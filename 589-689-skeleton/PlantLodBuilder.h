@@ -0,0 +1,65 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Builds level-of-detail chains for generated plant part meshes on the shared
+// ThreadPool.
+//
+// Meshes are immutable, so a chain is built into a copy of the mesh. When the
+// batch is done, publish() swaps the copy into every part still using the
+// original and into the mesh cache, so later cache hits come with their chain.
+// Parts edited in the meantime have moved on to another mesh and are left
+// alone; their new mesh is picked up by the next batch.
+//------------------------------------------------------------------------------
+
+#include "PlantMeshCache.h"
+#include "PlantPart.h"
+#include "PlantStore.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+class PlantLodBuilder {
+
+public:
+	explicit PlantLodBuilder(PlantMeshCache& cache) : cache(cache) {}
+
+	// Starts a batch for every up-to-date mesh in plants without a chain,
+	// unless one is in flight. Returns the number of meshes submitted.
+	size_t submit(PlantStore& plants);
+
+	// Installs the finished batch, or returns false if it is still running.
+	bool publish(PlantStore& plants);
+
+	bool isBusy() const { return batch != nullptr; }
+
+	double getLastBatchMs() const { return lastBatchMs; }
+	size_t getLastBatchSize() const { return lastBatchSize; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Job {
+		std::shared_ptr<const PlantPartMesh> source;
+		uint64_t inputHash;
+		std::shared_ptr<PlantPartMesh> mesh;
+	};
+
+	struct Batch {
+		std::vector<Job> jobs;
+		std::vector<std::future<void>> futures;
+		std::atomic<size_t> remaining{ 0 };
+		Clock::time_point start;
+		Clock::time_point end;
+	};
+
+	static void buildChain(PlantPartMesh& mesh);
+
+	PlantMeshCache& cache;
+	std::shared_ptr<Batch> batch;
+
+	double lastBatchMs = 0.0;
+	size_t lastBatchSize = 0;
+};
@@ -0,0 +1,96 @@
+#include "PlantMeshBatcher.h"
+
+#include "ThreadPool.h"
+
+#include <unordered_map>
+
+
+size_t PlantMeshBatcher::submit(PlantStore& plants) {
+	if (batch) {
+		return 0;
+	}
+
+	auto newBatch = std::make_shared<Batch>();
+	std::unordered_map<uint64_t, size_t> jobByHash;
+
+	plants.forEachPart([&](PartHandle handle, PlantPart& part) {
+		if (part.isSurfaceGenerated()) {
+			return;
+		}
+
+		uint64_t hash = part.getInputHash();
+		if (auto cached = cache.find(hash)) {
+			part.setMesh(std::move(cached), hash);
+			return;
+		}
+
+		auto job = jobByHash.find(hash);
+		if (job != jobByHash.end()) {
+			newBatch->jobs[job->second].parts.push_back(handle);
+			return;
+		}
+
+		jobByHash[hash] = newBatch->jobs.size();
+		newBatch->jobs.push_back(Job{ { handle }, hash, part.getSweepInput(), nullptr });
+	});
+
+	if (newBatch->jobs.empty()) {
+		return 0;
+	}
+
+	newBatch->remaining = newBatch->jobs.size();
+	newBatch->start = Clock::now();
+
+	// Each job writes only its own mesh, so they need no locking.
+	ThreadPool& pool = ThreadPool::shared();
+	newBatch->futures.reserve(newBatch->jobs.size());
+	for (size_t i = 0; i < newBatch->jobs.size(); ++i) {
+		Batch* b = newBatch.get();
+		newBatch->futures.push_back(pool.submit([newBatch, b, i]() {
+			Job& job = b->jobs[i];
+			job.mesh = std::make_shared<PlantPartMesh>();
+			PlantPart::buildMesh(job.input, *job.mesh);
+
+			Clock::time_point now = Clock::now();
+			if (b->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				b->end = now;
+			}
+		}));
+	}
+
+	batch = std::move(newBatch);
+	return batch->jobs.size();
+}
+
+
+bool PlantMeshBatcher::publish(PlantStore& plants, bool wait) {
+	if (!batch) {
+		return false;
+	}
+
+	if (!wait && batch->remaining.load(std::memory_order_acquire) != 0) {
+		return false;
+	}
+
+	// Also makes every job's writes (including end) visible to this thread.
+	for (auto& f : batch->futures) {
+		f.get();
+	}
+
+	for (auto& job : batch->jobs) {
+		cache.insert(job.inputHash, job.mesh);
+
+		// Handles of parts deleted since submit() no longer resolve.
+		for (PartHandle handle : job.parts) {
+			if (PlantPart* part = plants.getPart(handle)) {
+				part->setMesh(job.mesh, job.inputHash);
+			}
+		}
+	}
+
+	lastBatchMs = std::chrono::duration<double, std::milli>(batch->end - batch->start).count();
+	lastBatchSize = batch->jobs.size();
+
+	batch.reset();
+	return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Regenerates plant part meshes in batches on the shared ThreadPool.
+//
+// submit() snapshots the inputs of every part whose surface is out of date and
+// builds their meshes in parallel. The parts themselves are not touched until
+// publish(), which installs the whole batch at once on the render thread, so a
+// frame never sees a half-updated plant.
+//
+// Parts whose input hash is already in the mesh cache are served from it at
+// submit time, and parts with identical inputs share one job and one mesh.
+//------------------------------------------------------------------------------
+
+#include "PlantPart.h"
+#include "PlantMeshCache.h"
+#include "PlantStore.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+class PlantMeshBatcher {
+
+public:
+	explicit PlantMeshBatcher(PlantMeshCache& cache) : cache(cache) {}
+
+	// Starts a batch for every dirty part in plants, unless one is in flight.
+	// Returns the number of meshes submitted for generation.
+	size_t submit(PlantStore& plants);
+
+	// Installs the finished batch into plants. Without wait, returns false
+	// immediately if the batch is still running. Parts that were deleted while
+	// it ran are skipped; parts edited meanwhile get the new mesh but stay
+	// dirty, so the next batch picks them up again.
+	bool publish(PlantStore& plants, bool wait = false);
+
+	bool isBusy() const { return batch != nullptr; }
+
+	// Wall time of the most recently published batch, from submit() until its
+	// last mesh was built.
+	double getLastBatchMs() const { return lastBatchMs; }
+	size_t getLastBatchSize() const { return lastBatchSize; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Job {
+		std::vector<PartHandle> parts;
+		uint64_t inputHash;
+		SweepInput input;
+		std::shared_ptr<PlantPartMesh> mesh;
+	};
+
+	// Shared with the workers so it outlives the batcher if the scene is torn
+	// down mid-batch.
+	struct Batch {
+		std::vector<Job> jobs;
+		std::vector<std::future<void>> futures;
+		std::atomic<size_t> remaining{ 0 };
+		Clock::time_point start;
+		Clock::time_point end;
+	};
+
+	PlantMeshCache& cache;
+	std::shared_ptr<Batch> batch;
+
+	double lastBatchMs = 0.0;
+	size_t lastBatchSize = 0;
+};
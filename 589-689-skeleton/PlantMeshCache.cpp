@@ -0,0 +1,38 @@
+#include "PlantMeshCache.h"
+
+
+std::shared_ptr<const PlantPartMesh> PlantMeshCache::find(uint64_t hash) {
+	auto it = entries.find(hash);
+	if (it == entries.end()) {
+		misses++;
+		return nullptr;
+	}
+
+	lru.splice(lru.begin(), lru, it->second.lruPosition);
+	hits++;
+	return it->second.mesh;
+}
+
+
+void PlantMeshCache::insert(uint64_t hash, std::shared_ptr<const PlantPartMesh> mesh) {
+	auto it = entries.find(hash);
+	if (it != entries.end()) {
+		it->second.mesh = std::move(mesh);
+		lru.splice(lru.begin(), lru, it->second.lruPosition);
+		return;
+	}
+
+	lru.push_front(hash);
+	entries.emplace(hash, Entry{ std::move(mesh), lru.begin() });
+
+	while (entries.size() > capacity && !lru.empty()) {
+		entries.erase(lru.back());
+		lru.pop_back();
+	}
+}
+
+
+void PlantMeshCache::clear() {
+	entries.clear();
+	lru.clear();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Bounded, least-recently-used cache of generated plant part meshes keyed by
+// the hash of their inputs (see PlantPart::getInputHash()). Parts with the same
+// inputs, e.g. in duplicated plants, share a single immutable mesh.
+//------------------------------------------------------------------------------
+
+#include "PlantPart.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+class PlantMeshCache {
+
+public:
+	explicit PlantMeshCache(size_t capacity = 512) : capacity(capacity) {}
+
+	// Returns the cached mesh for hash (marking it most recently used), or null.
+	std::shared_ptr<const PlantPartMesh> find(uint64_t hash);
+
+	// Adds or replaces the mesh for hash, evicting the least recently used
+	// entries beyond capacity. Evicted meshes live on in any part using them.
+	void insert(uint64_t hash, std::shared_ptr<const PlantPartMesh> mesh);
+
+	void clear();
+
+	size_t size() const { return entries.size(); }
+	size_t getCapacity() const { return capacity; }
+	size_t getHits() const { return hits; }
+	size_t getMisses() const { return misses; }
+
+private:
+	struct Entry {
+		std::shared_ptr<const PlantPartMesh> mesh;
+		std::list<uint64_t>::iterator lruPosition;
+	};
+
+	size_t capacity;
+	std::unordered_map<uint64_t, Entry> entries;
+	// Most recently used at the front.
+	std::list<uint64_t> lru;
+
+	size_t hits = 0;
+	size_t misses = 0;
+};
@@ -1,17 +1,197 @@
 #include "PlantPart.h"
 
+#include "Log.h"
+#include "MeshUtils.h"
+#include "Profiler.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PLANTPART_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+std::atomic<PlantPart::GenerationMode> PlantPart::generationMode{ PlantPart::GenerationMode::FAST };
+
+namespace {
+    // 64-bit FNV-1a.
+    const uint64_t FNV_OFFSET = 14695981039346656037ull;
+    const uint64_t FNV_PRIME = 1099511628211ull;
+
+    void hashBytes(uint64_t& hash, const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+    }
+
+    template <typename T>
+    void hashVector(uint64_t& hash, const std::vector<T>& values) {
+        // Including the length keeps adjacent arrays from aliasing each other.
+        size_t count = values.size();
+        hashBytes(hash, &count, sizeof(count));
+        hashBytes(hash, values.data(), values.size() * sizeof(T));
+    }
+
+    void hashPoints(uint64_t& hash, const PointsData& points) {
+        hashVector(hash, points.cpuGeom.verts);
+        hashVector(hash, points.weights);
+    }
+}
+
+const std::shared_ptr<const PlantPartMesh>& PlantPart::emptyMesh() {
+    static const std::shared_ptr<const PlantPartMesh> empty = std::make_shared<PlantPartMesh>();
+    return empty;
+}
+
+uint64_t PlantPart::computeInputHash() const {
+    uint64_t hash = FNV_OFFSET;
+
+    hashPoints(hash, geometry->leftControlPoints);
+    hashPoints(hash, geometry->rightControlPoints);
+    hashPoints(hash, geometry->crossSectionControlPoints);
+
+    hashVector(hash, geometry->leftCurve);
+    hashVector(hash, geometry->rightCurve);
+    hashVector(hash, geometry->crossSectionCurve);
+
+    float sampleStep = CURVE_SAMPLE_STEP;
+    hashBytes(hash, &sampleStep, sizeof(sampleStep));
+    hashBytes(hash, &baseColor, sizeof(baseColor));
+    hashBytes(hash, &generationModeAtHash, sizeof(generationModeAtHash));
+
+    // 0 is reserved for "no generated mesh".
+    return hash != 0 ? hash : 1;
+}
+
 void PlantPart::generatePlantPart() {
+    PROFILE_SCOPE("PlantPart::generatePlantPart");
+    auto generated = std::make_shared<PlantPartMesh>();
+    buildMesh(getSweepInput(), *generated);
+    setMesh(std::move(generated), getInputHash());
+}
+
+void PlantPart::buildMesh(const SweepInput& input, PlantPartMesh& out) {
+    PROFILE_SCOPE("PlantPart::buildMesh");
 
-    normals.clear();
-    indices.clear();
-    cols.clear();
-    surface.clear();
+    out.clear();
 
-    if (crossSectionCurve.size() == 0) {
+    if (input.crossSectionCurve.size() == 0) {
         return;
     }
 
-    std::vector<glm::dvec3> transformedCurve(crossSectionCurve.begin(), crossSectionCurve.end());
+    std::vector<glm::vec3>& surface = out.surface;
+    std::vector<unsigned int>& indices = out.indices;
+
+    int M = 0;
+    GenerationMode mode = generationMode;
+    if (mode == GenerationMode::REFERENCE) {
+        M = generateSurfaceReference(input, surface);
+    }
+    else if (mode == GenerationMode::FAST) {
+        M = generateSurfaceFast(input, surface);
+    }
+    else {
+        std::vector<glm::vec3> fastSurface;
+        generateSurfaceFast(input, fastSurface);
+        M = generateSurfaceReference(input, surface);
+        validateFastSurface(input, surface, fastSurface);
+    }
+
+    if (M > 0) {
+        int N = static_cast<int>(surface.size()) / M;
+        indices.reserve(size_t(N - 1) * M * 6);
+
+        for (int i = 0; i < N - 1; ++i) {
+            for (int j = 0; j < M; ++j) {
+                unsigned int v0 = i * M + j;
+                unsigned int v1 = i * M + (j + 1) % M;
+                unsigned int v2 = (i + 1) * M + j;
+                unsigned int v3 = (i + 1) * M + (j + 1) % M;
+
+                indices.push_back(v0);
+                indices.push_back(v1);
+                indices.push_back(v2);
+
+                indices.push_back(v2);
+                indices.push_back(v1);
+                indices.push_back(v3);
+            }
+        }
+
+        // One normal per vertex, so the array lines up with surface.
+        out.normals = MeshUtils::computeVertexNormals(surface, indices);
+
+        out.uvs.resize(surface.size());
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < M; ++j) {
+                out.uvs[i * M + j] = glm::vec2(float(j) / static_cast<float>(M), N > 1 ? float(i) / static_cast<float>(N - 1) : 0.0f);
+            }
+        }
+
+        // Rings are emitted one after another, so with wide profiles the
+        // cache has long lost the vertices a ring shares with the previous
+        // one. Reorder the triangles for reuse, unless a ring fits in the
+        // cache anyway, then renumber the vertices to match.
+        out.acmrBefore = MeshUtils::computeACMR(indices, surface.size());
+        std::vector<unsigned int> reordered = indices;
+        MeshUtils::optimizeVertexCache(reordered, surface.size());
+        if (MeshUtils::computeACMR(reordered, surface.size()) < out.acmrBefore) {
+            indices.swap(reordered);
+        }
+        std::vector<unsigned int> remap = MeshUtils::optimizeVertexFetch(indices, surface.size());
+        MeshUtils::remapVertices(surface, remap);
+        MeshUtils::remapVertices(out.normals, remap);
+        MeshUtils::remapVertices(out.uvs, remap);
+        out.acmrAfter = MeshUtils::computeACMR(indices, surface.size());
+    }
+
+    out.compactIndices.assign(indices, surface.size());
+    out.cols = std::vector<glm::vec3>(surface.size(), input.baseColor);
+
+    if (!surface.empty()) {
+        out.boundsMin = out.boundsMax = surface[0];
+        for (const glm::vec3& p : surface) {
+            out.boundsMin = glm::min(out.boundsMin, p);
+            out.boundsMax = glm::max(out.boundsMax, p);
+        }
+    }
+}
+
+void PlantPart::buildWatertightMesh(std::vector<glm::vec3>& verts, std::vector<unsigned int>& outIndices) const {
+    verts = mesh->surface;
+    outIndices = mesh->indices;
+
+    // Rings where the left and right curves meet collapse to a single point,
+    // so welding them turns the open tube ends into closed tips.
+    MeshUtils::weldVertices(verts, outIndices, WELD_EPSILON);
+    MeshUtils::capBoundaryLoops(verts, outIndices);
+}
+
+bool PlantPart::exportOBJ(const std::string& path, bool watertight) const {
+    if (mesh->surface.empty()) {
+        Log::warn("PlantPart {} has no surface to export", name);
+        return false;
+    }
+
+    if (!watertight) {
+        return MeshUtils::writeOBJ(path, mesh->surface, mesh->normals, mesh->indices);
+    }
+
+    std::vector<glm::vec3> verts;
+    std::vector<unsigned int> weldedIndices;
+    buildWatertightMesh(verts, weldedIndices);
+    return MeshUtils::writeOBJ(path, verts, MeshUtils::computeVertexNormals(verts, weldedIndices), weldedIndices);
+}
+
+// Double-precision reference: every step is its own dmat4 pass over the
+// profile, and each ring is built into a temporary strip before being copied.
+int PlantPart::generateSurfaceReference(const SweepInput& input, std::vector<glm::vec3>& out) {
+    out.clear();
+
+    std::vector<glm::dvec3> transformedCurve(input.crossSectionCurve.begin(), input.crossSectionCurve.end());
     glm::dvec3 startPoint = transformedCurve.front();
     glm::dvec3 endPoint = transformedCurve.back();
     glm::dvec3 midpoint = (startPoint + endPoint) * 0.5;
@@ -43,88 +223,200 @@ void PlantPart::generatePlantPart() {
     endPoint = transformedCurve.back();
 
     double length = glm::length(endPoint - startPoint);
-    if (length > 1e-4) {
-        double scaleFactor = 1.0 / length;
+    if (length <= 1e-4) {
+        return 0;
+    }
 
-        glm::dmat4 scaleMatrix = glm::scale(glm::dmat4(1.0), glm::dvec3(scaleFactor));
-        for (auto& point : transformedCurve) {
-            glm::dvec4 scaledPoint = scaleMatrix * glm::dvec4(point, 1.0);
-            point = glm::dvec3(scaledPoint);
-        }
+    double scaleFactor = 1.0 / length;
 
-        for (size_t i = transformedCurve.size() - 2; i > 0; --i) {
-            glm::dvec3 reflectedPoint = transformedCurve[i];
-            reflectedPoint.z = -reflectedPoint.z;
-            transformedCurve.push_back(reflectedPoint);
-        }
+    glm::dmat4 scaleMatrix = glm::scale(glm::dmat4(1.0), glm::dvec3(scaleFactor));
+    for (auto& point : transformedCurve) {
+        glm::dvec4 scaledPoint = scaleMatrix * glm::dvec4(point, 1.0);
+        point = glm::dvec3(scaledPoint);
+    }
 
-        std::vector<std::vector<glm::dvec3>> surfaceStrips;
+    for (size_t i = transformedCurve.size() - 2; i > 0; --i) {
+        glm::dvec3 reflectedPoint = transformedCurve[i];
+        reflectedPoint.z = -reflectedPoint.z;
+        transformedCurve.push_back(reflectedPoint);
+    }
 
-        for (int i = 0; i < leftCurve.size(); ++i) {
-            glm::dvec3 ql = leftCurve[i];
-            glm::dvec3 qr = rightCurve[i];
-            glm::dvec3 axis = qr - ql;
-            glm::dvec3 mid = (ql + qr) * 0.5;
+    std::vector<std::vector<glm::dvec3>> surfaceStrips;
 
-            glm::dvec3 axisDir = glm::normalize(axis);
-            double angle = acos(glm::dot(glm::dvec3(1.0f, 0.0, 0.0), axisDir));
+    for (size_t i = 0; i < input.leftCurve.size(); ++i) {
+        glm::dvec3 ql = input.leftCurve[i];
+        glm::dvec3 qr = input.rightCurve[i];
+        glm::dvec3 axis = qr - ql;
+        glm::dvec3 mid = (ql + qr) * 0.5;
 
-            glm::dmat4 transform = glm::translate(glm::dmat4(1.0), mid)
-                * glm::rotate(glm::dmat4(1.0), angle, glm::dvec3(0.0, 0.0, 1.0f))
-                * glm::scale(glm::dmat4(1.0), glm::dvec3(glm::length(axis)));
+        glm::dvec3 axisDir = glm::normalize(axis);
+        double angle = acos(glm::dot(glm::dvec3(1.0f, 0.0, 0.0), axisDir));
 
-            std::vector<glm::dvec3> strip;
+        glm::dmat4 transform = glm::translate(glm::dmat4(1.0), mid)
+            * glm::rotate(glm::dmat4(1.0), angle, glm::dvec3(0.0, 0.0, 1.0f))
+            * glm::scale(glm::dmat4(1.0), glm::dvec3(glm::length(axis)));
 
-            for (const auto& pt : transformedCurve) {
-                glm::dvec4 transformed = transform * glm::dvec4(pt, 1.0);
-                strip.push_back(glm::dvec3(transformed));
-            }
+        std::vector<glm::dvec3> strip;
 
-            surfaceStrips.push_back(strip);
+        for (const auto& pt : transformedCurve) {
+            glm::dvec4 transformed = transform * glm::dvec4(pt, 1.0);
+            strip.push_back(glm::dvec3(transformed));
         }
 
-        for (const auto& strip : surfaceStrips) {
-            for (const auto& point : strip) {
-                surface.push_back(glm::vec3(point));
-            }
+        surfaceStrips.push_back(strip);
+    }
+
+    for (const auto& strip : surfaceStrips) {
+        for (const auto& point : strip) {
+            out.push_back(glm::vec3(point));
         }
+    }
 
-        int N = surfaceStrips.size();
-        int M = transformedCurve.size();
+    return static_cast<int>(transformedCurve.size());
+}
 
-        for (int i = 0; i < N - 1; ++i) {
-            for (int j = 0; j < M; ++j) {
-                unsigned int v0 = i * M + j;
-                unsigned int v1 = i * M + (j + 1) % M;
-                unsigned int v2 = (i + 1) * M + j;
-                unsigned int v3 = (i + 1) * M + (j + 1) % M;
-        
-                indices.push_back(v0);
-                indices.push_back(v1);
-                indices.push_back(v2);
-        
-                indices.push_back(v2);
-                indices.push_back(v1);
-                indices.push_back(v3);
-        
-                glm::vec3 vec1 = surface[v1] - surface[v0];
-                glm::vec3 vec2 = surface[v2] - surface[v0];
-                glm::vec3 normal = glm::normalize(glm::cross(vec1, vec2));
+// Float fast path. The profile normalisation (translate, rotate, swizzle,
+// scale) is folded into one matrix, and each ring's translate * rotate * scale
+// is composed once and applied to the whole profile with SIMD, writing
+// straight into the preallocated output.
+bool PlantPart::computeProfileMatrix(const std::vector<glm::vec3>& crossSection, glm::mat4& out) {
+    if (crossSection.empty()) {
+        return false;
+    }
 
-                normals.push_back(normal);
-            }
-        }
+    glm::dvec3 startPoint = crossSection.front();
+    glm::dvec3 endPoint = crossSection.back();
+    glm::dvec3 midpoint = (startPoint + endPoint) * 0.5;
+
+    // Translation and rotation preserve length, so the scale can be taken
+    // from the untransformed end points.
+    double length = glm::length(endPoint - startPoint);
+    if (length <= 1e-4) {
+        return false;
+    }
+
+    glm::dvec3 direction = (endPoint - startPoint) / length;
+    double angleZ = acos(glm::clamp(direction.x, -1.0, 1.0));
+    if (direction.y > 0) {
+        angleZ = -angleZ;
+    }
+
+    // Swaps y and z, matching the reference's (x, z, y) reorder.
+    glm::dmat4 swizzle(
+        1.0, 0.0, 0.0, 0.0,
+        0.0, 0.0, 1.0, 0.0,
+        0.0, 1.0, 0.0, 0.0,
+        0.0, 0.0, 0.0, 1.0);
+
+    out = glm::mat4(
+        glm::scale(glm::dmat4(1.0), glm::dvec3(1.0 / length))
+        * swizzle
+        * glm::rotate(glm::dmat4(1.0), angleZ, glm::dvec3(0.0, 0.0, 1.0))
+        * glm::translate(glm::dmat4(1.0), -midpoint));
+    return true;
+}
+
+int PlantPart::generateSurfaceFast(const SweepInput& input, std::vector<glm::vec3>& out) {
+    out.clear();
+
+    glm::mat4 profileMatrix;
+    if (!computeProfileMatrix(input.crossSectionCurve, profileMatrix)) {
+        return 0;
+    }
+
+    const size_t curveSize = input.crossSectionCurve.size();
+    const size_t M = 2 * curveSize - 2;
+
+    std::vector<glm::vec4> profile(M);
+    for (size_t i = 0; i < curveSize; ++i) {
+        profile[i] = profileMatrix * glm::vec4(input.crossSectionCurve[i], 1.0f);
+    }
+    for (size_t i = 1; i + 1 < curveSize; ++i) {
+        glm::vec4 reflectedPoint = profile[curveSize - 1 - i];
+        reflectedPoint.z = -reflectedPoint.z;
+        profile[curveSize - 1 + i] = reflectedPoint;
+    }
 
-        for (int i = 0; i < transformedCurve.size(); ++i) {
-			normals.push_back(glm::vec3(0.0f, -1.0f, 0.0f));
+    const size_t N = std::min(input.leftCurve.size(), input.rightCurve.size());
+    out.resize(N * M);
+
+    for (size_t i = 0; i < N; ++i) {
+        glm::vec3 ql = input.leftCurve[i];
+        glm::vec3 qr = input.rightCurve[i];
+        glm::vec3 axis = qr - ql;
+        glm::vec3 mid = (ql + qr) * 0.5f;
+
+        // Unlike the reference, a zero-length axis (e.g. where the left and
+        // right curves meet at a tip) collapses the ring onto its midpoint
+        // instead of producing NaNs.
+        float axisLength = glm::length(axis);
+        float angle = axisLength > 0.0f ? std::acos(glm::clamp(axis.x / axisLength, -1.0f, 1.0f)) : 0.0f;
+        float c = std::cos(angle) * axisLength;
+        float s = std::sin(angle) * axisLength;
+
+        glm::vec3* ring = out.data() + i * M;
+
+#ifdef PLANTPART_USE_SSE
+        // Columns of translate(mid) * rotateZ(angle) * scale(axisLength).
+        const __m128 col0 = _mm_setr_ps(c, s, 0.0f, 0.0f);
+        const __m128 col1 = _mm_setr_ps(-s, c, 0.0f, 0.0f);
+        const __m128 col2 = _mm_setr_ps(0.0f, 0.0f, axisLength, 0.0f);
+        const __m128 col3 = _mm_setr_ps(mid.x, mid.y, mid.z, 1.0f);
+
+        alignas(16) float result[4];
+        for (size_t j = 0; j < M; ++j) {
+            const float* p = &profile[j].x;
+            __m128 r = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(p[0])), _mm_mul_ps(col1, _mm_set1_ps(p[1]))),
+                _mm_add_ps(_mm_mul_ps(col2, _mm_set1_ps(p[2])), col3));
+            _mm_store_ps(result, r);
+            ring[j] = glm::vec3(result[0], result[1], result[2]);
         }
-        
-        // Normalize all accumulated normals
-        for (auto& normal : normals) {
-            normal = glm::normalize(normal);
+#else
+        for (size_t j = 0; j < M; ++j) {
+            const glm::vec4& p = profile[j];
+            ring[j] = glm::vec3(
+                c * p.x - s * p.y + mid.x,
+                s * p.x + c * p.y + mid.y,
+                axisLength * p.z + mid.z);
         }
+#endif
+    }
+
+    return N > 0 ? static_cast<int>(M) : 0;
+}
+
+bool PlantPart::validateFastSurface(const SweepInput& input, const std::vector<glm::vec3>& reference, const std::vector<glm::vec3>& fast) {
+    if (reference.size() != fast.size()) {
+        Log::warn("PlantPart {}: fast path produced {} vertices, reference produced {}", input.name, fast.size(), reference.size());
+        return false;
+    }
+
+    glm::vec3 minBound(std::numeric_limits<float>::max());
+    glm::vec3 maxBound(std::numeric_limits<float>::lowest());
+    float maxError = 0.0f;
+    size_t skipped = 0;
+
+    for (size_t i = 0; i < reference.size(); ++i) {
+        // The reference emits NaNs for degenerate rings; those are not compared.
+        if (glm::any(glm::isnan(reference[i]))) {
+            ++skipped;
+            continue;
+        }
+        minBound = glm::min(minBound, reference[i]);
+        maxBound = glm::max(maxBound, reference[i]);
+
+        glm::vec3 diff = glm::abs(reference[i] - fast[i]);
+        maxError = std::max(maxError, std::max(diff.x, std::max(diff.y, diff.z)));
+    }
+
+    float extent = std::max(1.0f, glm::length(maxBound - minBound));
+    float tolerance = FAST_PATH_TOLERANCE * extent;
+    if (maxError > tolerance) {
+        Log::warn("PlantPart {}: fast path max error {} exceeds tolerance {}", input.name, maxError, tolerance);
+        return false;
     }
 
-    cols = std::vector<glm::vec3>(surface.size(), baseColor);
-    surfaceGenerated = true;
-}
\ No newline at end of file
+    Log::debug("PlantPart {}: fast path max error {} within tolerance {} ({} degenerate vertices skipped)", input.name, maxError, tolerance, skipped);
+    return true;
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <glm/glm.hpp>
@@ -8,15 +11,100 @@
 #include <iostream>
 #include "glm/gtc/type_ptr.hpp"
 
+// Generated sweep geometry. Every array except the indices is per vertex.
+struct PlantPartMesh {
+    std::vector<glm::vec3> surface;
+    std::vector<glm::vec3> cols;
+    std::vector<glm::vec3> normals;
+    // x runs around the profile and y along the sweep, both from 0 to 1.
+    std::vector<glm::vec2> uvs;
+    std::vector<unsigned int> indices;
+    CompactIndices compactIndices;
+    // Vertex cache misses per triangle (see MeshUtils::computeACMR()) of
+    // the ring-by-ring order the sweep produces and of the reordered one
+    // actually stored.
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+    // Local-space bounds of surface; both zero when it is empty.
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    // Simplified versions indexing the same vertices, finest first, each with
+    // roughly how far it strays from the full mesh. Added by PlantLodBuilder
+    // after generation; lodsBuilt tells a mesh too small to simplify from one
+    // that has not been looked at yet.
+    struct Lod {
+        CompactIndices indices;
+        float error = 0.0f;
+    };
+    std::vector<Lod> lods;
+    bool lodsBuilt = false;
+
+    void clear() {
+        surface.clear();
+        cols.clear();
+        normals.clear();
+        uvs.clear();
+        indices.clear();
+        compactIndices.clear();
+        acmrBefore = acmrAfter = 0.0f;
+        boundsMin = boundsMax = glm::vec3(0.0f);
+        lods.clear();
+        lodsBuilt = false;
+    }
+};
+
+// A part's editable curve data. Copies of a part share one instance until
+// either of them is edited (see PlantPart::editGeometry()).
+struct PlantPartGeometry {
+    PointsData leftControlPoints;
+    PointsData rightControlPoints;
+    PointsData crossSectionControlPoints;
+
+    std::vector<glm::vec3> leftCurve;
+    std::vector<glm::vec3> rightCurve;
+    std::vector<glm::vec3> crossSectionCurve;
+};
+
+// Everything mesh generation reads from a part. It is copied out of the part
+// so that meshes can be built on worker threads while the part is edited.
+struct SweepInput {
+    std::string name;
+    std::vector<glm::vec3> leftCurve;
+    std::vector<glm::vec3> rightCurve;
+    std::vector<glm::vec3> crossSectionCurve;
+    glm::vec3 baseColor;
+};
+
 class PlantPart {
 public:
+    // How generatePlantPart() builds the sweep surface. VALIDATE runs both
+    // paths, keeps the reference output and logs the largest deviation.
+    enum class GenerationMode {
+        REFERENCE,
+        FAST,
+        VALIDATE,
+    };
+
+    // Largest per-component difference allowed between the fast and reference
+    // paths, relative to the mesh's bounding box diagonal (or 1, if smaller).
+    static constexpr float FAST_PATH_TOLERANCE = 1e-4f;
+
+    // Vertices closer than this are merged by buildWatertightMesh().
+    static constexpr float WELD_EPSILON = 1e-5f;
+
+    // Parameter step used when sampling the part's B-spline curves.
+    static constexpr float CURVE_SAMPLE_STEP = 0.02f;
+
     PlantPart(const std::string& name)
         : name(name)
         , scale(1.0f, 1.0f, 1.0f)
         , translation(0.0f, 0.0f, 0.0f)
         , rotation(0.0f, 0.0f, 0.0f)
 		, baseColor(0.0f, 0.0f, 0.0f)
-        , needsUpdate(false) {}
+        , needsUpdate(false)
+        , geometry(std::make_shared<PlantPartGeometry>())
+        , mesh(emptyMesh()) {}
 
     // Getters
     const std::string& getName() const {
@@ -36,6 +124,11 @@ public:
     }
 
     glm::vec3& getBaseColor() {
+        inputsTouched = true;
+        return baseColor;
+    }
+
+    const glm::vec3& getBaseColor() const {
         return baseColor;
     }
 
@@ -53,43 +146,72 @@ public:
     }
 
     const std::vector<glm::vec3>& getSurface() const {
-        return surface;
+        return mesh->surface;
     }
 
     const std::vector<unsigned int>& getIndices() const {
-        return indices;
+        return mesh->indices;
+    }
+
+    const CompactIndices& getCompactIndices() const {
+        return mesh->compactIndices;
     }
 
     const std::vector<glm::vec3>& getNormals() const {
-        return normals;
+        return mesh->normals;
     }
 
     const std::vector<glm::vec3>& getCols() const {
-        return cols;
+        return mesh->cols;
+    }
+
+    // Meshes are immutable once built, so parts with identical inputs can share one.
+    const std::shared_ptr<const PlantPartMesh>& getMesh() const {
+        return mesh;
     }
 
+    // The non-const control point getters hand out references that may be
+    // edited, so they detach shared geometry and mark the input hash for
+    // recomputation. Use the const overloads for read-only access.
     PointsData& getLeftControlPoints() {
-        return leftControlPoints;
+        return editGeometry().leftControlPoints;
     }
 
     PointsData& getRightControlPoints() {
-        return rightControlPoints;
+        return editGeometry().rightControlPoints;
     }
 
     PointsData& getCrossSectionControlPoints() {
-        return crossSectionControlPoints;
+        return editGeometry().crossSectionControlPoints;
+    }
+
+    const PointsData& getLeftControlPoints() const {
+        return geometry->leftControlPoints;
+    }
+
+    const PointsData& getRightControlPoints() const {
+        return geometry->rightControlPoints;
+    }
+
+    const PointsData& getCrossSectionControlPoints() const {
+        return geometry->crossSectionControlPoints;
     }
 
     const std::vector<glm::vec3>& getLeftCurve() const {
-        return leftCurve;
+        return geometry->leftCurve;
     }
 
     const std::vector<glm::vec3>& getRightCurve() const {
-        return rightCurve;
+        return geometry->rightCurve;
     }
 
     const std::vector<glm::vec3>& getCrossSectionCurve() const {
-        return crossSectionCurve;
+        return geometry->crossSectionCurve;
+    }
+
+    // True while this part shares its curve data with a copy of itself.
+    bool isGeometryShared() const {
+        return geometry.use_count() > 1;
     }
 
     // Setters
@@ -102,68 +224,131 @@ public:
     }
 
     void setSurface(const std::vector<glm::vec3>& newSurface) {
-        surface = newSurface;
+        auto edited = std::make_shared<PlantPartMesh>(*mesh);
+        edited->surface = newSurface;
+        mesh = std::move(edited);
+        meshHash = 0;
     }
 
     void setLeftCurve(const std::vector<glm::vec3>& curve) {
-        leftCurve = curve;
+        editGeometry().leftCurve = curve;
     }
 
     void setRightCurve(const std::vector<glm::vec3>& curve) {
-        rightCurve = curve;
+        editGeometry().rightCurve = curve;
     }
 
     void setNormal(const std::vector<glm::vec3>& newNormal) {
-        normals = newNormal;
+        auto edited = std::make_shared<PlantPartMesh>(*mesh);
+        edited->normals = newNormal;
+        mesh = std::move(edited);
+        meshHash = 0;
     }
 
     void setCrossSectionCurve(const std::vector<glm::vec3>& curve) {
-        crossSectionCurve = curve;
+        editGeometry().crossSectionCurve = curve;
+    }
+
+    // Installs a mesh built from inputs whose hash was inputHash. If the part
+    // has been edited since, it stays out of date.
+    void setMesh(std::shared_ptr<const PlantPartMesh> newMesh, uint64_t inputHash) {
+        mesh = newMesh ? std::move(newMesh) : emptyMesh();
+        meshHash = inputHash;
     }
 
     // Miscellaneous
     void clear() {
-        leftControlPoints.clear();
-        rightControlPoints.clear();
-        crossSectionControlPoints.clear();
-        leftCurve.clear();
-        rightCurve.clear();
-        crossSectionCurve.clear();
-        surface.clear();
+        // Replacing rather than editing leaves any copies' geometry alone.
+        geometry = std::make_shared<PlantPartGeometry>();
+        mesh = emptyMesh();
+        meshHash = 0;
+        inputsTouched = true;
     }
 
+	// True when the current mesh was built from the part's current inputs.
 	bool isSurfaceGenerated() {
-		return surfaceGenerated;
+		return meshHash != 0 && meshHash == getInputHash();
 	}
 
-	void setSurfaceGenerated(bool generated) {
-		surfaceGenerated = generated;
+	// Hash of everything that affects the generated mesh: control points,
+	// weights, sampled curves, the curve sample step, the base colour and the
+	// generation mode. Recomputed only after the inputs may have changed.
+	uint64_t getInputHash() {
+		GenerationMode mode = generationMode;
+		if (inputsTouched || generationModeAtHash != mode) {
+			generationModeAtHash = mode;
+			inputHash = computeInputHash();
+			inputsTouched = false;
+		}
+		return inputHash;
 	}
 
     void generatePlantPart();
 
-private:
-    std::string name;
+    SweepInput getSweepInput() const {
+        return SweepInput{ name, geometry->leftCurve, geometry->rightCurve, geometry->crossSectionCurve, baseColor };
+    }
 
-    PointsData leftControlPoints;
-    PointsData rightControlPoints;
-    PointsData crossSectionControlPoints;
+    // Builds the sweep surface described by input. Touches no part state, so
+    // it is safe to call from worker threads.
+    static void buildMesh(const SweepInput& input, PlantPartMesh& out);
 
+    // The matrix the sweep applies to the cross-section samples to normalise
+    // them into a unit profile. Returns false if the curve's end points
+    // coincide, in which case no surface is generated.
+    static bool computeProfileMatrix(const std::vector<glm::vec3>& crossSection, glm::mat4& out);
 
-    std::vector<glm::vec3> leftCurve;
-    std::vector<glm::vec3> rightCurve;
-    std::vector<glm::vec3> crossSectionCurve;
+    // Welds coincident vertices and caps any remaining open ends, producing a
+    // closed mesh for export. The rendered surface is left untouched.
+    void buildWatertightMesh(std::vector<glm::vec3>& verts, std::vector<unsigned int>& outIndices) const;
+    bool exportOBJ(const std::string& path, bool watertight) const;
+
+    static GenerationMode getGenerationMode() {
+        return generationMode;
+    }
+
+    // Parts rebuild in the new mode as their hashes change; set from the
+    // UI's sweep generation combo.
+    static void setGenerationMode(GenerationMode mode) {
+        generationMode = mode;
+    }
+
+private:
+    // Atomic, since mesh builds on worker threads read it.
+    static std::atomic<GenerationMode> generationMode;
+
+    static const std::shared_ptr<const PlantPartMesh>& emptyMesh();
+    uint64_t computeInputHash() const;
+
+    // Both return the number of points per ring (0 if nothing was generated).
+    static int generateSurfaceReference(const SweepInput& input, std::vector<glm::vec3>& out);
+    static int generateSurfaceFast(const SweepInput& input, std::vector<glm::vec3>& out);
+    static bool validateFastSurface(const SweepInput& input, const std::vector<glm::vec3>& reference, const std::vector<glm::vec3>& fast);
+
+    // Gives write access to the curve data, first copying it if another part
+    // still shares it.
+    PlantPartGeometry& editGeometry() {
+        if (geometry.use_count() > 1) {
+            geometry = std::make_shared<PlantPartGeometry>(*geometry);
+        }
+        inputsTouched = true;
+        return *geometry;
+    }
+
+    std::string name;
 
     bool needsUpdate;
-    std::vector<glm::vec3> surface;
-    std::vector<glm::vec3> cols;
-    std::vector<glm::vec3> normals;
-	std::vector<unsigned int> indices;
+    std::shared_ptr<PlantPartGeometry> geometry;
+    std::shared_ptr<const PlantPartMesh> mesh;
 
     glm::vec3 scale;
     glm::vec3 translation;
 	glm::vec3 rotation;
     glm::vec3 baseColor;
 
-    bool surfaceGenerated = false;
+    // Hash of the inputs mesh was built from (0 if it is not a generated mesh).
+    uint64_t meshHash = 0;
+    uint64_t inputHash = 0;
+    GenerationMode generationModeAtHash = GenerationMode::FAST;
+    bool inputsTouched = true;
 };
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "PlantPartGPUCache.h"
+
+#include <cstring>
+#include <utility>
+
+
+namespace {
+
+// Returns the [first, last) span of elements that differ between two arrays
+// of equal length; first == last when they are identical.
+template <typename T>
+std::pair<size_t, size_t> changedRange(const std::vector<T>& before, const std::vector<T>& after) {
+	size_t first = 0;
+	while (first < after.size() && before[first] == after[first]) {
+		first++;
+	}
+
+	size_t last = after.size();
+	while (last > first && before[last - 1] == after[last - 1]) {
+		last--;
+	}
+	return { first, last };
+}
+
+
+PackedVertices packMesh(const PlantPartMesh& mesh) {
+	return PackedVertices::pack(mesh.surface, mesh.normals, mesh.uvs, mesh.cols, PackedVertices::Options());
+}
+
+
+bool sameLayout(const PackedVertices& a, const PackedVertices& b, const CompactIndices& aIndices, const CompactIndices& bIndices) {
+	return a.layout == b.layout
+		&& a.count == b.count
+		&& a.decode == b.decode
+		&& aIndices.type == bIndices.type
+		&& aIndices.count() == bIndices.count();
+}
+
+}
+
+
+PackedGeometry* PlantPartGPUCache::acquire(PartHandle handle, const PlantPart& part) {
+	const auto& mesh = part.getMesh();
+	if (mesh->surface.empty()) {
+		return nullptr;
+	}
+
+	const PlantPartMesh*& current = partMeshes[keyOf(handle)];
+	auto it = entries.find(mesh.get());
+	if (it != entries.end()) {
+		// Another part already made this mesh resident.
+		if (current != mesh.get()) {
+			it->second->users++;
+			release(current);
+			current = mesh.get();
+		}
+		it->second->geometry.bind();
+		it->second->geometry.applyConstants();
+		return &it->second->geometry;
+	}
+
+	// Reuse the part's old entry if nothing else draws its mesh, so that an
+	// edit only uploads what changed.
+	std::unique_ptr<Entry> slot;
+	if (current && entries.at(current)->users == 1) {
+		auto old = entries.find(current);
+		slot = std::move(old->second);
+		entries.erase(old);
+	}
+	else {
+		release(current);
+		slot = std::make_unique<Entry>();
+		slot->users = 1;
+	}
+	current = mesh.get();
+	Entry& entry = *slot;
+	entries.emplace(mesh.get(), std::move(slot));
+
+	// Binding first also keeps index uploads from landing in another VAO.
+	entry.geometry.bind();
+
+	PackedVertices packed = packMesh(*mesh);
+	if (entry.uploaded && sameLayout(entry.packed, packed, entry.uploaded->compactIndices, mesh->compactIndices)) {
+		uploadChanged(entry, *mesh, std::move(packed));
+	}
+	else {
+		uploadAll(entry, *mesh, std::move(packed));
+	}
+	if (!mesh->lods.empty() || !entry.lodOffsets.empty()) {
+		uploadLods(entry, *mesh);
+	}
+	entry.uploaded = mesh;
+
+	entry.geometry.applyConstants();
+	return &entry.geometry;
+}
+
+
+PlantPartGPUCache::Entry* PlantPartGPUCache::entryOf(PartHandle handle) const {
+	auto it = partMeshes.find(keyOf(handle));
+	return it != partMeshes.end() ? entries.at(it->second).get() : nullptr;
+}
+
+
+const PlantPartGPUCache::Entry* PlantPartGPUCache::find(PartHandle handle) const {
+	return entryOf(handle);
+}
+
+
+bool PlantPartGPUCache::bindLod(PartHandle handle, size_t lod, size_t& offset) {
+	Entry* entry = entryOf(handle);
+	if (!entry || lod >= entry->lodOffsets.size()) {
+		return false;
+	}
+
+	entry->lodIndices.bind();
+	offset = entry->lodOffsets[lod];
+	return true;
+}
+
+
+void PlantPartGPUCache::collect(PlantStore& plants) {
+	for (auto it = partMeshes.begin(); it != partMeshes.end();) {
+		PartHandle handle{ uint32_t(it->first >> 32), uint32_t(it->first) };
+		if (!plants.getPart(handle)) {
+			release(it->second);
+			it = partMeshes.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+
+void PlantPartGPUCache::release(const PlantPartMesh* mesh) {
+	if (!mesh) {
+		return;
+	}
+	auto it = entries.find(mesh);
+	if (--it->second->users == 0) {
+		entries.erase(it);
+	}
+}
+
+
+void PlantPartGPUCache::beginFrame() {
+	frameUploads = 0;
+	frameBytes = 0;
+}
+
+
+void PlantPartGPUCache::uploadAll(Entry& entry, const PlantPartMesh& mesh, PackedVertices packed) {
+	entry.geometry.upload(packed, mesh.compactIndices);
+	countUpload(entry, packed.bytes.size());
+	countUpload(entry, mesh.compactIndices.sizeInBytes());
+	entry.packed = std::move(packed);
+}
+
+
+void PlantPartGPUCache::uploadChanged(Entry& entry, const PlantPartMesh& mesh, PackedVertices packed) {
+	const PlantPartMesh& before = *entry.uploaded;
+
+	// Diffed a whole vertex at a time, since that is the unit uploaded.
+	size_t stride = size_t(packed.layout.getStride());
+	size_t first = 0;
+	while (first < packed.count && std::memcmp(&entry.packed.bytes[first * stride], &packed.bytes[first * stride], stride) == 0) {
+		first++;
+	}
+	size_t last = packed.count;
+	while (last > first && std::memcmp(&entry.packed.bytes[(last - 1) * stride], &packed.bytes[(last - 1) * stride], stride) == 0) {
+		last--;
+	}
+	if (first < last) {
+		entry.geometry.updateVertices(packed, first, last - first);
+		countUpload(entry, stride * (last - first));
+	}
+
+	auto indices = mesh.compactIndices.type == GL_UNSIGNED_SHORT
+		? changedRange(before.compactIndices.shortIndices, mesh.compactIndices.shortIndices)
+		: changedRange(before.compactIndices.intIndices, mesh.compactIndices.intIndices);
+	if (indices.first < indices.second) {
+		entry.geometry.updateIndices(mesh.compactIndices, indices.first, indices.second - indices.first);
+		size_t indexSize = mesh.compactIndices.sizeInBytes() / mesh.compactIndices.count();
+		countUpload(entry, indexSize * (indices.second - indices.first));
+	}
+
+	entry.packed = std::move(packed);
+}
+
+
+void PlantPartGPUCache::uploadLods(Entry& entry, const PlantPartMesh& mesh) {
+	entry.lodOffsets.clear();
+	if (mesh.lods.empty()) {
+		return;
+	}
+
+	std::vector<unsigned char> bytes;
+	for (const PlantPartMesh::Lod& lod : mesh.lods) {
+		entry.lodOffsets.push_back(bytes.size());
+		const unsigned char* data = static_cast<const unsigned char*>(lod.indices.data());
+		bytes.insert(bytes.end(), data, data + lod.indices.sizeInBytes());
+	}
+
+	entry.lodIndices.uploadData(bytes.size(), bytes.data(), GL_STATIC_DRAW);
+	entry.geometry.bindIndices();
+	countUpload(entry, bytes.size());
+}
+
+
+void PlantPartGPUCache::countUpload(Entry& entry, size_t bytes) {
+	entry.uploads++;
+	entry.bytesUploaded += bytes;
+	frameUploads++;
+	frameBytes += bytes;
+	totalBytes += bytes;
+}
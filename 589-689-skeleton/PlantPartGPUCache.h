@@ -0,0 +1,102 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// GPU copies of plant part meshes that persist across frames.
+//
+// Entries are keyed by mesh, not by part: parts built from the same inputs
+// share one immutable PlantPartMesh (see PlantMeshBatcher), so duplicated
+// plants upload each of their meshes once. A mesh gets its own VAO and buffer
+// the first time a part using it is drawn, with its vertices packed into one
+// compact interleaved buffer (see PackedVertices), and is freed once no part
+// uses it.
+//
+// After that the buffers are only written when a part's mesh is replaced;
+// meshes are immutable, so a different mesh pointer is the only way that can
+// happen. If no other part was using the old mesh and the new one packs to
+// the same layout and bounds, the entry moves to the new mesh and only the
+// changed span of vertices is re-uploaded with glBufferSubData. A mesh's LOD
+// levels share its vertices and only add an index buffer.
+//
+// Packed positions are relative to the mesh's bounds, so draws must multiply
+// the geometry's getDecode() onto their model matrix.
+//------------------------------------------------------------------------------
+
+#include "Geometry.h"
+#include "PlantPart.h"
+#include "PlantStore.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+class PlantPartGPUCache {
+
+public:
+	struct Entry {
+		PackedGeometry geometry;
+		// The mesh currently in the buffers, and its packed vertices, kept to
+		// diff against the next one.
+		std::shared_ptr<const PlantPartMesh> uploaded;
+		PackedVertices packed;
+		// Parts whose current mesh this is.
+		size_t users = 0;
+		// The mesh's LOD index lists back to back, level k starting
+		// lodOffsets[k] bytes in. Binding it replaces the VAO's index buffer
+		// until PackedGeometry::bindIndices().
+		ElementBuffer lodIndices;
+		std::vector<size_t> lodOffsets;
+		size_t uploads = 0;
+		size_t bytesUploaded = 0;
+	};
+
+	// Makes the part's current mesh resident and returns its geometry, bound
+	// and with its constant attributes set, ready to draw. Returns null if the
+	// part has no surface.
+	PackedGeometry* acquire(PartHandle handle, const PlantPart& part);
+
+	// The entry of the mesh the part was last drawn with; null if it has
+	// never been drawn.
+	const Entry* find(PartHandle handle) const;
+
+	// Binds the index buffer holding LOD level lod (0 = the first simplified
+	// level) of an acquired part to its VAO and sets offset to where the
+	// level starts. Returns false if the uploaded mesh has no such level.
+	bool bindLod(PartHandle handle, size_t lod, size_t& offset);
+
+	// Forgets parts that no longer exist in plants, freeing the buffers of
+	// meshes only they used.
+	void collect(PlantStore& plants);
+
+	// Resets the per-frame upload counters.
+	void beginFrame();
+
+	// Meshes resident, each possibly shared by several parts.
+	size_t size() const { return entries.size(); }
+	size_t getFrameUploads() const { return frameUploads; }
+	size_t getFrameBytes() const { return frameBytes; }
+	size_t getTotalBytes() const { return totalBytes; }
+
+private:
+	static uint64_t keyOf(PartHandle handle) {
+		return (uint64_t(handle.index) << 32) | handle.generation;
+	}
+
+	Entry* entryOf(PartHandle handle) const;
+	// Drops a part's use of the entry for mesh, freeing it if that was the last.
+	void release(const PlantPartMesh* mesh);
+
+	void uploadAll(Entry& entry, const PlantPartMesh& mesh, PackedVertices packed);
+	void uploadChanged(Entry& entry, const PlantPartMesh& mesh, PackedVertices packed);
+	void uploadLods(Entry& entry, const PlantPartMesh& mesh);
+	void countUpload(Entry& entry, size_t bytes);
+
+	// Held by pointer since PackedGeometry owns GL handles. Each entry keeps
+	// its mesh alive, so the key stays unique while it exists.
+	std::unordered_map<const PlantPartMesh*, std::unique_ptr<Entry>> entries;
+	// The mesh each part was last drawn with, keyed by keyOf().
+	std::unordered_map<uint64_t, const PlantPartMesh*> partMeshes;
+
+	size_t frameUploads = 0;
+	size_t frameBytes = 0;
+	size_t totalBytes = 0;
+};
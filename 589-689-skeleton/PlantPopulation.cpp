@@ -0,0 +1,656 @@
+#include "PlantPopulation.h"
+
+#include "Log.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+
+
+namespace {
+
+// The farthest instanced.vert sways the top of a copy of stiffness 1, as a
+// multiple of WindSettings::strength times the copy's height.
+const float MAX_SWAY = 1.15f;
+
+}
+
+
+void PlantPopulation::setPlacements(PlantHandle plant, std::vector<PlantPlacement> placements, float slopeAlignment) {
+	auto& group = groups[keyOf(plant)];
+	if (!group) {
+		group = std::make_unique<Group>();
+		group->plant = plant;
+	}
+
+	group->placements = std::move(placements);
+	group->slopeAlignment = slopeAlignment;
+	layoutDirty |= group->instances.size() != group->placements.size();
+	group->instances.resize(group->placements.size());
+	group->hash.clear();
+	for (uint32_t i = 0; i < group->placements.size(); ++i) {
+		const PlantPlacement& placement = group->placements[i];
+		group->instances[i] = makeInstance(placement, slopeAlignment);
+		group->hash.insert(i, glm::vec2(placement.position.x, placement.position.z));
+	}
+
+	group->dirty = true;
+	group->patched.clear();
+	group->boundsDirty = true;
+	structureDirty = true;
+}
+
+
+void PlantPopulation::setWind(const WindSettings& wind) {
+	float reach = windSettings.enabled ? windSettings.strength : 0.0f;
+	float newReach = wind.enabled ? wind.strength : 0.0f;
+	windSettings = wind;
+	if (newReach != reach) {
+		for (auto& entry : groups) {
+			entry.second->boundsDirty = true;
+		}
+	}
+}
+
+
+const std::vector<PlantInstance>* PlantPopulation::find(PlantHandle plant) const {
+	auto it = groups.find(keyOf(plant));
+	return it != groups.end() ? &it->second->instances : nullptr;
+}
+
+
+void PlantPopulation::remove(PlantHandle plant) {
+	if (groups.erase(keyOf(plant))) {
+		structureDirty = true;
+		layoutDirty = true;
+	}
+}
+
+
+void PlantPopulation::collect(PlantStore& plants) {
+	for (auto it = groups.begin(); it != groups.end();) {
+		if (!plants.getPlant(it->second->plant)) {
+			it = groups.erase(it);
+			structureDirty = true;
+			layoutDirty = true;
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+
+size_t PlantPopulation::resnap(const Surface& surface, glm::vec2 low, glm::vec2 high) {
+	size_t count = 0;
+	for (auto& entry : groups) {
+		Group& group = *entry.second;
+		group.hash.query(low, high, [&](uint32_t i) {
+			PlantPlacement& placement = group.placements[i];
+			if (!surface.heightAt(placement.position.x, placement.position.z, placement.position.y)) {
+				return;
+			}
+			surface.normalAt(placement.position.x, placement.position.z, placement.normal);
+
+			group.instances[i] = makeInstance(placement, group.slopeAlignment);
+			if (!group.boundsDirty) {
+				group.moved.push_back(i);
+			}
+			if (group.moved.size() > group.instances.size()) {
+				group.boundsDirty = true;
+				group.moved.clear();
+			}
+			if (!group.dirty) {
+				group.patched.push_back(i);
+			}
+			// Past this point a full upload is cheaper than tracking slots.
+			if (group.patched.size() > group.instances.size()) {
+				group.dirty = true;
+				group.patched.clear();
+			}
+			count++;
+		});
+	}
+	return count;
+}
+
+
+void PlantPopulation::cull(PlantStore& plants, const View& view, bool culling, const ImpostorSettings& impostors,
+	const LodSettings& lods, const DepthRaster* occluders) {
+	auto start = std::chrono::steady_clock::now();
+	cullStats = CullStats();
+	impostorSettings = impostors;
+	impostorSettings.fadeWidth = std::max(impostorSettings.fadeWidth, 1e-3f);
+
+	for (auto& entry : groups) {
+		Group& group = *entry.second;
+		if (plants.getPlant(group.plant)) {
+			structureDirty |= syncParts(group, plants);
+		}
+
+		for (PartDraw& part : group.parts) {
+			for (LevelDraw& level : part.levels) {
+				level.visible.clear();
+			}
+		}
+		for (uint32_t i : group.impostorVisible) {
+			group.impostorMarked[i] = 0;
+		}
+		group.impostorVisible.clear();
+		group.impostorMarked.resize(group.instances.size(), 0);
+	}
+
+	// Copies past fadeStart get an impostor, and keep their mesh until the
+	// end of the cross-fade band. The distance matches the shaders'.
+	float fadeStart = impostorSettings.enabled ? impostorSettings.distance : FLT_MAX;
+	float fadeEnd = impostorSettings.enabled ? fadeStart + impostorSettings.fadeWidth : FLT_MAX;
+	auto accept = [&](Group& group, uint32_t part, uint32_t instance) {
+		const glm::mat4& transform = group.instances[instance].transform;
+		float distance = glm::distance(view.cameraPos, glm::vec3(transform[3]));
+		PartDraw& draw = group.parts[part];
+		if (distance < fadeEnd && !draw.levels.empty()) {
+			// The coarsest level whose error stays under the pixel limit.
+			size_t level = 0;
+			if (lods.enabled && distance > 0.0f) {
+				float pixelsPerUnit = view.pixelsPerUnit * draw.localScale * glm::length(glm::vec3(transform[0])) / distance;
+				for (size_t k = draw.levels.size() - 1; k > 0; --k) {
+					if (draw.mesh->lods[k - 1].error * pixelsPerUnit <= lods.pixelError) {
+						level = k;
+						break;
+					}
+				}
+			}
+			draw.levels[level].visible.push_back(instance);
+			cullStats.kept++;
+			if (level > 0) {
+				cullStats.simplified++;
+			}
+		}
+		if (distance >= fadeStart && !group.impostorMarked[instance]) {
+			group.impostorMarked[instance] = 1;
+			group.impostorVisible.push_back(instance);
+			cullStats.impostors++;
+		}
+	};
+
+	if (!culling) {
+		for (auto& entry : groups) {
+			Group& group = *entry.second;
+			for (uint32_t p = 0; p < group.parts.size(); ++p) {
+				for (uint32_t i = 0; i < group.instances.size(); ++i) {
+					accept(group, p, i);
+				}
+			}
+			cullStats.total += group.parts.size() * group.instances.size();
+		}
+		cullStats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return;
+	}
+
+	if (structureDirty) {
+		// Sorted by handle so the tree does not depend on hash map order.
+		std::vector<std::pair<uint64_t, Group*>> sorted;
+		for (auto& entry : groups) {
+			sorted.emplace_back(entry.first, entry.second.get());
+		}
+		std::sort(sorted.begin(), sorted.end());
+
+		leaves.clear();
+		for (auto& entry : sorted) {
+			Group& group = *entry.second;
+			group.leafStart = leaves.size();
+			for (uint32_t p = 0; p < group.parts.size(); ++p) {
+				for (uint32_t i = 0; i < group.instances.size(); ++i) {
+					leaves.push_back(Leaf{ &group, p, i });
+				}
+			}
+			group.boundsDirty = false;
+			group.moved.clear();
+		}
+
+		leafBoxes.resize(leaves.size());
+		for (size_t l = 0; l < leaves.size(); ++l) {
+			leafBoxes[l] = leafBounds(*leaves[l].group, leaves[l].part, leaves[l].instance);
+		}
+		bvh.build(leafBoxes);
+		structureDirty = false;
+	}
+	else {
+		bool refit = false;
+		for (auto& entry : groups) {
+			Group& group = *entry.second;
+			if (group.boundsDirty) {
+				size_t l = group.leafStart;
+				for (uint32_t p = 0; p < group.parts.size(); ++p) {
+					for (uint32_t i = 0; i < group.instances.size(); ++i) {
+						leafBoxes[l++] = leafBounds(group, p, i);
+					}
+				}
+			}
+			else if (!group.moved.empty()) {
+				// Re-snapping under a brush only touches a few copies.
+				for (uint32_t p = 0; p < group.parts.size(); ++p) {
+					for (uint32_t i : group.moved) {
+						leafBoxes[group.leafStart + p * group.instances.size() + i] = leafBounds(group, p, i);
+					}
+				}
+			}
+			else {
+				continue;
+			}
+			group.boundsDirty = false;
+			group.moved.clear();
+			refit = true;
+		}
+		if (refit) {
+			bvh.refit(leafBoxes);
+		}
+	}
+
+	Frustum frustum(view.viewProjection);
+	bvh.traverse(
+		[&](const AABB& bounds, uint32_t count) {
+			// Parts without a mesh yet have empty boxes.
+			if (bounds.isEmpty()) {
+				return BVH::CULLED;
+			}
+			Frustum::Result result = frustum.test(bounds);
+			if (result == Frustum::OUTSIDE) {
+				cullStats.frustumCulled += count;
+				return BVH::CULLED;
+			}
+			if (occluders && occluders->isOccluded(bounds)) {
+				cullStats.occlusionCulled += count;
+				return BVH::CULLED;
+			}
+			// A box that is not hidden may still hold plants that are, so
+			// with occluders every node down to the leaves is tested.
+			return result == Frustum::INSIDE && !occluders ? BVH::VISIBLE : BVH::PARTIAL;
+		},
+		[&](uint32_t l) {
+			const Leaf& leaf = leaves[l];
+			accept(*leaf.group, leaf.part, leaf.instance);
+		});
+
+	cullStats.total = leaves.size();
+	cullStats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+void PlantPopulation::draw(PlantStore& plants, PlantPartGPUCache& meshes, ShaderProgram& shader, float time) {
+	lastDrawCalls = 0;
+	lastInstancesDrawn = 0;
+	lastUploadBytes = 0;
+	lastTrianglesDrawn = 0;
+
+	glUniform1i(shader.uniform("instances"), 1);
+	glUniform1f(shader.uniform("fadeStart"), impostorSettings.enabled ? impostorSettings.distance : FLT_MAX);
+	glUniform1f(shader.uniform("fadeWidth"), impostorSettings.fadeWidth);
+	glUniform1f(shader.uniform("time"), time);
+	glUniform2fv(shader.uniform("windDirection"), 1, &windSettings.direction[0]);
+	glUniform1f(shader.uniform("windStrength"), windSettings.enabled ? windSettings.strength : 0.0f);
+	glUniform1f(shader.uniform("windFrequency"), windSettings.frequency);
+	GLint heightLoc = shader.uniform("plantHeight");
+
+	lastUploadBytes += upload();
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+
+	// Gather the kept copies of every plant by what they are drawn with.
+	for (size_t b = 0; b < batchCount; ++b) {
+		batches[b].instances.clear();
+	}
+	batchCount = 0;
+	firstBatch.clear();
+	for (auto& entry : groups) {
+		Group& group = *entry.second;
+		if (!plants.getPlant(group.plant) || group.instances.empty()) {
+			continue;
+		}
+
+		for (const PartDraw& draw : group.parts) {
+			if (!plants.getPart(draw.part) || !draw.mesh || draw.mesh->surface.empty()) {
+				continue;
+			}
+
+			for (size_t l = 0; l < draw.levels.size(); ++l) {
+				const std::vector<uint32_t>& visible = draw.levels[l].visible;
+				if (visible.empty()) {
+					continue;
+				}
+
+				auto first = firstBatch.emplace(draw.mesh.get(), SIZE_MAX).first;
+				size_t b = first->second;
+				while (b != SIZE_MAX && !(batches[b].level == l && batches[b].height == group.height && batches[b].draw->local == draw.local)) {
+					b = batches[b].next;
+				}
+				if (b == SIZE_MAX) {
+					b = batchCount++;
+					if (batches.size() < batchCount) {
+						batches.emplace_back();
+					}
+					Batch& batch = batches[b];
+					batch.part = draw.part;
+					batch.draw = &draw;
+					batch.level = l;
+					batch.height = group.height;
+					batch.next = first->second;
+					first->second = b;
+				}
+
+				std::vector<uint32_t>& instances = batches[b].instances;
+				uint32_t base = uint32_t(group.instanceBase);
+				for (uint32_t i : visible) {
+					instances.push_back(base + i);
+				}
+			}
+		}
+	}
+
+	if (batchBuffers.size() < batchCount) {
+		batchBuffers.resize(batchCount);
+	}
+	for (size_t b = 0; b < batchCount; ++b) {
+		Batch& batch = batches[b];
+		BatchBuffer& buffer = batchBuffers[b];
+		const PlantPart* part = plants.getPart(batch.part);
+		PackedGeometry* geometry = meshes.acquire(batch.part, *part);
+		if (!geometry) {
+			continue;
+		}
+
+		shader.setModel(batch.draw->local * geometry->getDecode());
+		glUniform1f(heightLoc, batch.height);
+
+		// acquire() left the mesh's VAO bound, so the attribute below is
+		// recorded in it.
+		glBindBuffer(GL_ARRAY_BUFFER, buffer.buffer);
+		if (batch.instances != buffer.uploaded) {
+			glBufferData(GL_ARRAY_BUFFER, sizeof(uint32_t) * batch.instances.size(), batch.instances.data(), GL_STREAM_DRAW);
+			buffer.uploaded = batch.instances;
+			lastUploadBytes += sizeof(uint32_t) * batch.instances.size();
+		}
+		glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, 0, (void*)0);
+		glEnableVertexAttribArray(5);
+		glVertexAttribDivisor(5, 1);
+
+		// Falls back to the full mesh if the level is not resident.
+		const CompactIndices* indices = &part->getCompactIndices();
+		size_t offset = 0;
+		bool lodBound = batch.level > 0 && meshes.bindLod(batch.part, batch.level - 1, offset);
+		if (lodBound) {
+			indices = &batch.draw->mesh->lods[batch.level - 1].indices;
+		}
+
+		glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)indices->count(), indices->type, (void*)offset, (GLsizei)batch.instances.size());
+
+		lastDrawCalls++;
+		lastInstancesDrawn += batch.instances.size();
+		lastTrianglesDrawn += indices->count() / 3 * batch.instances.size();
+
+		if (lodBound) {
+			geometry->bindIndices();
+		}
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+}
+
+
+void PlantPopulation::bakeImpostors(PlantStore& plants, PlantPartGPUCache& meshes, ShaderProgram& bakeShader) {
+	for (auto& entry : groups) {
+		Group& group = *entry.second;
+		if (group.impostorVisible.empty() || !group.impostorStale || !plants.getPlant(group.plant)) {
+			continue;
+		}
+
+		AABB bounds;
+		for (const PartDraw& draw : group.parts) {
+			bounds.expand(draw.localBounds);
+		}
+		if (bounds.isEmpty()) {
+			continue;
+		}
+
+		if (!group.atlas) {
+			group.atlas = std::make_unique<ImpostorAtlas>();
+		}
+
+		group.atlas->bake(bounds, bakeShader, [&]() {
+			for (const PartDraw& draw : group.parts) {
+				const PlantPart* part = plants.getPart(draw.part);
+				PackedGeometry* geometry = part ? meshes.acquire(draw.part, *part) : nullptr;
+				if (!geometry) {
+					continue;
+				}
+				bakeShader.setModel(draw.local * geometry->getDecode());
+				const CompactIndices& indices = part->getCompactIndices();
+				glDrawElements(GL_TRIANGLES, (GLsizei)indices.count(), indices.type, 0);
+			}
+		});
+
+		group.impostorStale = false;
+		impostorBakes++;
+	}
+}
+
+
+void PlantPopulation::drawImpostors(PlantStore& plants, ShaderProgram& shader) {
+	lastImpostorsDrawn = 0;
+	if (!impostorQuads) {
+		impostorQuads = std::make_unique<VertexArray>();
+	}
+	impostorQuads->bind();
+
+	glUniform1i(shader.uniform("instances"), 1);
+	glUniform1i(shader.uniform("colorAtlas"), 2);
+	glUniform1i(shader.uniform("normalAtlas"), 3);
+	glUniform1i(shader.uniform("frames"), ImpostorAtlas::FRAMES);
+	glUniform1f(shader.uniform("fadeStart"), impostorSettings.distance);
+	glUniform1f(shader.uniform("fadeWidth"), impostorSettings.fadeWidth);
+	GLint centerLoc = shader.uniform("center");
+	GLint radiusLoc = shader.uniform("radius");
+
+	// The render queue may run this before draw().
+	lastUploadBytes += upload();
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+
+	for (auto& entry : groups) {
+		Group& group = *entry.second;
+		if (group.impostorVisible.empty() || !group.atlas || !plants.getPlant(group.plant)) {
+			continue;
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, group.impostorIndexBuffer);
+		if (group.impostorVisible != group.impostorUploaded || group.instanceBase != group.impostorUploadedBase) {
+			impostorIndices.clear();
+			for (uint32_t i : group.impostorVisible) {
+				impostorIndices.push_back(uint32_t(group.instanceBase) + i);
+			}
+			glBufferData(GL_ARRAY_BUFFER, sizeof(uint32_t) * impostorIndices.size(), impostorIndices.data(), GL_STREAM_DRAW);
+			group.impostorUploaded = group.impostorVisible;
+			group.impostorUploadedBase = group.instanceBase;
+			lastUploadBytes += sizeof(uint32_t) * impostorIndices.size();
+		}
+		glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, 0, (void*)0);
+		glEnableVertexAttribArray(5);
+		glVertexAttribDivisor(5, 1);
+
+		glActiveTexture(GL_TEXTURE2);
+		group.atlas->getColor().bind();
+		glActiveTexture(GL_TEXTURE3);
+		group.atlas->getNormal().bind();
+
+		glm::vec3 center = group.atlas->getCenter();
+		glUniform3fv(centerLoc, 1, &center[0]);
+		glUniform1f(radiusLoc, group.atlas->getRadius());
+
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)group.impostorVisible.size());
+		lastImpostorsDrawn += group.impostorVisible.size();
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+}
+
+
+size_t PlantPopulation::instanceCount() const {
+	size_t count = 0;
+	for (auto& entry : groups) {
+		count += entry.second->instances.size();
+	}
+	return count;
+}
+
+
+PlantInstance PlantPopulation::makeInstance(const PlantPlacement& placement, float slopeAlignment) {
+	PlantInstance instance;
+	instance.transform = glm::translate(glm::mat4(1.0f), placement.position);
+
+	// Lean from upright towards the terrain normal.
+	glm::vec3 up(0.0f, 1.0f, 0.0f);
+	glm::vec3 lean = glm::normalize(glm::mix(up, placement.normal, slopeAlignment));
+	glm::vec3 axis = glm::cross(up, lean);
+	float sinAngle = glm::length(axis);
+	if (sinAngle > 1e-6f) {
+		instance.transform = glm::rotate(instance.transform, std::atan2(sinAngle, glm::dot(up, lean)), axis / sinAngle);
+	}
+
+	instance.transform = glm::rotate(instance.transform, placement.yaw, up);
+	instance.transform = glm::scale(instance.transform, glm::vec3(placement.scale));
+	instance.tint = glm::vec4(placement.tint, 1.0f);
+	instance.wind = glm::vec4(placement.windPhase, placement.stiffness, 0.0f, 0.0f);
+	return instance;
+}
+
+
+bool PlantPopulation::syncParts(Group& group, PlantStore& plants) {
+	const Plant* plant = plants.getPlant(group.plant);
+	const std::vector<PartHandle>& handles = plant->getParts();
+
+	bool changed = handles.size() != group.parts.size();
+	for (size_t i = 0; i < handles.size() && !changed; ++i) {
+		changed = handles[i] != group.parts[i].part;
+	}
+	if (changed) {
+		group.impostorStale = true;
+		group.parts.clear();
+		group.parts.resize(handles.size());
+		for (size_t i = 0; i < handles.size(); ++i) {
+			group.parts[i].part = handles[i];
+		}
+	}
+
+	for (PartDraw& draw : group.parts) {
+		const PlantPart* part = plants.getPart(draw.part);
+		if (!part) {
+			continue;
+		}
+
+		glm::mat4 local = plant->getModelMatrix() * part->getPartTransformMatrix();
+		if (part->getMesh() != draw.mesh || local != draw.local) {
+			draw.mesh = part->getMesh();
+			draw.local = local;
+			draw.localScale = std::max({ glm::length(glm::vec3(local[0])), glm::length(glm::vec3(local[1])), glm::length(glm::vec3(local[2])) });
+			draw.levels.resize(draw.mesh->lods.size() + 1);
+			draw.localBounds = draw.mesh->surface.empty() ? AABB() : AABB{ draw.mesh->boundsMin, draw.mesh->boundsMax }.transformed(local);
+			group.boundsDirty = true;
+			group.impostorStale = true;
+		}
+	}
+
+	group.height = 0.0f;
+	for (const PartDraw& draw : group.parts) {
+		if (!draw.localBounds.isEmpty()) {
+			group.height = std::max(group.height, draw.localBounds.max.y);
+		}
+	}
+	return changed;
+}
+
+
+AABB PlantPopulation::leafBounds(const Group& group, uint32_t part, uint32_t instance) const {
+	const PlantInstance& copy = group.instances[instance];
+	AABB box = group.parts[part].localBounds.transformed(copy.transform);
+	if (box.isEmpty() || !windSettings.enabled) {
+		return box;
+	}
+
+	// Sway is horizontal, in whichever direction the wind blows.
+	float scale = glm::length(glm::vec3(copy.transform[1]));
+	float pad = MAX_SWAY * windSettings.strength * group.height * scale / copy.wind.y;
+	box.min -= glm::vec3(pad, 0.0f, pad);
+	box.max += glm::vec3(pad, 0.0f, pad);
+	return box;
+}
+
+
+size_t PlantPopulation::upload() {
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	if (layoutDirty) {
+		staging.clear();
+		for (auto& entry : groups) {
+			Group& group = *entry.second;
+			group.instanceBase = staging.size();
+			staging.insert(staging.end(), group.instances.begin(), group.instances.end());
+			group.dirty = false;
+			group.patched.clear();
+		}
+		glBufferData(GL_ARRAY_BUFFER, sizeof(PlantInstance) * staging.size(), staging.data(), GL_DYNAMIC_DRAW);
+		layoutDirty = false;
+
+		// The texture keeps referring to the buffer across reallocations.
+		if (!textureAttached) {
+			glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceBuffer);
+			textureAttached = true;
+		}
+
+		GLint maxTexels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+		if (staging.size() * 6 > size_t(maxTexels)) {
+			Log::error("{} plant copies exceed this GPU's buffer texture limit of {} texels", staging.size(), maxTexels);
+		}
+		return sizeof(PlantInstance) * staging.size();
+	}
+
+	// Upload runs of patched slots, bridging small gaps to save calls.
+	const uint32_t MAX_GAP = 8;
+	size_t bytes = 0;
+	for (auto& entry : groups) {
+		Group& group = *entry.second;
+		if (group.dirty) {
+			glBufferSubData(GL_ARRAY_BUFFER, sizeof(PlantInstance) * group.instanceBase, sizeof(PlantInstance) * group.instances.size(), group.instances.data());
+			bytes += sizeof(PlantInstance) * group.instances.size();
+			group.dirty = false;
+			group.patched.clear();
+			continue;
+		}
+		if (group.patched.empty()) {
+			continue;
+		}
+
+		std::sort(group.patched.begin(), group.patched.end());
+		group.patched.erase(std::unique(group.patched.begin(), group.patched.end()), group.patched.end());
+
+		size_t runStart = 0;
+		for (size_t i = 1; i <= group.patched.size(); ++i) {
+			if (i < group.patched.size() && group.patched[i] - group.patched[i - 1] <= MAX_GAP) {
+				continue;
+			}
+
+			uint32_t first = group.patched[runStart];
+			uint32_t count = group.patched[i - 1] - first + 1;
+			glBufferSubData(GL_ARRAY_BUFFER, sizeof(PlantInstance) * (group.instanceBase + first), sizeof(PlantInstance) * count, group.instances.data() + first);
+			bytes += sizeof(PlantInstance) * count;
+			runStart = i;
+		}
+		group.patched.clear();
+	}
+	return bytes;
+}
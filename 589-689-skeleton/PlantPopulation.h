@@ -0,0 +1,309 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Copies of plants placed across the landscape, drawn with instancing.
+//
+// Every population keeps its per-copy transforms and tints in one shared
+// buffer, each plant's copies in a range of their own, read by the instanced
+// shader through a buffer texture. Drawing gathers the copies of each part
+// that survived culling by the mesh they use, so that plants sharing a mesh
+// (duplicates, or parts built from the same inputs) are drawn together: each
+// list of instance indices is fed to the shader as a per-instance attribute,
+// bound to the mesh's resident copy (see PlantPartGPUCache), and drawn with
+// one glDrawElementsInstanced. The number of draw calls depends on the unique
+// meshes, not on how many plants or copies there are.
+//
+// Copies further away than the impostor distance are drawn instead as single
+// camera-facing quads textured from an octahedral atlas of the plant (see
+// ImpostorAtlas), baked again whenever the plant's parts change. Over a band
+// past that distance both are drawn, each discarding a complementary dither
+// pattern, so copies cross-fade rather than pop.
+//
+// Nearer copies pick, per part, the coarsest level of the mesh's LOD chain (see
+// PlantLodBuilder) whose error projects to no more than a set number of
+// pixels, and are drawn with one call per level in use.
+//
+// Meshes sway in the wind entirely in instanced.vert: the whole copy bends
+// with its height in the plant, and each part flutters along its sweep, timed
+// by per-copy phases and stiffnesses stored with the instance data. Nothing is
+// uploaded per frame for it; culling boxes are padded by the farthest a copy
+// can sway.
+//
+// Culling runs over a BVH with one box per part per copy. Placements are also
+// kept in a spatial hash, so that when the terrain changes only the copies
+// standing on the changed region are re-snapped, and only their slots in the
+// instance buffer are re-uploaded.
+//------------------------------------------------------------------------------
+
+#include "BVH.h"
+#include "DepthRaster.h"
+#include "GLHandles.h"
+#include "ImpostorAtlas.h"
+#include "PlantPartGPUCache.h"
+#include "PlantStore.h"
+#include "ShaderProgram.h"
+#include "SpatialHash.h"
+#include "Surface.h"
+#include "VertexArray.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Per-instance data as laid out in the instance buffer: six RGBA32F texels.
+struct PlantInstance {
+	glm::mat4 transform = glm::mat4(1.0f);
+	// w is unused.
+	glm::vec4 tint = glm::vec4(1.0f);
+	// x is the wind phase and y the stiffness; zw are unused.
+	glm::vec4 wind = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+};
+
+// Where and how a copy stands; its PlantInstance is derived from this.
+struct PlantPlacement {
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 normal = glm::vec3(0.0f, 1.0f, 0.0f);
+	float yaw = 0.0f;
+	float scale = 1.0f;
+	glm::vec3 tint = glm::vec3(1.0f);
+	// Offsets the copy's sway in time, in radians.
+	float windPhase = 0.0f;
+	// Divides how far the copy sways; must be positive.
+	float stiffness = 1.0f;
+};
+
+
+class PlantPopulation {
+
+public:
+	// Counts of part copies, i.e. one per part per instance.
+	struct CullStats {
+		size_t total = 0;
+		size_t frustumCulled = 0;
+		size_t occlusionCulled = 0;
+		size_t kept = 0;
+		// Kept part copies drawn from a simplified level.
+		size_t simplified = 0;
+		// Whole copies drawn as impostors.
+		size_t impostors = 0;
+		double ms = 0.0;
+	};
+
+	// The camera for one frame. pixelsPerUnit is how many pixels tall
+	// something one unit tall appears from one unit away.
+	struct View {
+		glm::mat4 viewProjection;
+		glm::vec3 cameraPos;
+		float pixelsPerUnit;
+	};
+
+	struct LodSettings {
+		bool enabled = true;
+		// Largest projected error, in pixels, a level may have to be used.
+		float pixelError = 1.0f;
+	};
+
+	struct ImpostorSettings {
+		bool enabled = true;
+		// Camera distance, to each copy's origin, where the cross-fade starts.
+		float distance = 8.0f;
+		float fadeWidth = 2.0f;
+	};
+
+	struct WindSettings {
+		bool enabled = true;
+		// Unit direction in the XZ plane.
+		glm::vec2 direction = glm::vec2(1.0f, 0.0f);
+		// How far the top of a copy of stiffness 1 sways at most, as a
+		// fraction of its height.
+		float strength = 0.08f;
+		// Radians per second of the main sway.
+		float frequency = 1.5f;
+	};
+
+	// Replaces the plant's population. slopeAlignment is how far copies lean
+	// from upright towards the terrain normal, from 0 to 1.
+	void setPlacements(PlantHandle plant, std::vector<PlantPlacement> placements, float slopeAlignment = 0.0f);
+
+	// Null if the plant has no population.
+	const std::vector<PlantInstance>* find(PlantHandle plant) const;
+
+	void remove(PlantHandle plant);
+
+	// Drops the populations of plants that no longer exist.
+	void collect(PlantStore& plants);
+
+	// Moves every copy within the XZ box [low, high] back onto surface.
+	// Returns the number of copies re-snapped.
+	size_t resnap(const Surface& surface, glm::vec2 low, glm::vec2 high);
+
+	// Picks the part copies and impostors to draw this frame. Without culling
+	// every copy is kept; otherwise copies outside the frustum are dropped, and
+	// so are those behind occluders if given. Rebuilds or refits the BVH first
+	// as needed. Either way copies are then split between meshes and
+	// impostors by their distance from the camera, and meshes get their LOD.
+	void cull(PlantStore& plants, const View& view, bool culling, const ImpostorSettings& impostors,
+		const LodSettings& lods, const DepthRaster* occluders);
+
+	// Takes effect from the next cull(), which pads the culling boxes to
+	// cover the sway.
+	void setWind(const WindSettings& wind);
+	const WindSettings& getWind() const { return windSettings; }
+
+	// Draws the meshes the last cull() kept with shader, which must be in use
+	// with V, P and cameraPos set. M is set per part to the plant's model
+	// matrix times the part's. time, in seconds, drives the wind.
+	void draw(PlantStore& plants, PlantPartGPUCache& meshes, ShaderProgram& shader, float time);
+
+	// Re-renders the atlases of plants that need impostors this frame and
+	// changed since they were last baked. Must not run between use() of a
+	// shader and a draw that relies on it.
+	void bakeImpostors(PlantStore& plants, PlantPartGPUCache& meshes, ShaderProgram& bakeShader);
+
+	// Draws the impostors the last cull() kept with shader, which must be in
+	// use with V, P, cameraPos and the lighting uniforms set.
+	void drawImpostors(PlantStore& plants, ShaderProgram& shader);
+
+	size_t instanceCount() const;
+	const CullStats& getCullStats() const { return cullStats; }
+	size_t getLastDrawCalls() const { return lastDrawCalls; }
+	size_t getLastInstancesDrawn() const { return lastInstancesDrawn; }
+	size_t getLastTrianglesDrawn() const { return lastTrianglesDrawn; }
+	size_t getLastImpostorsDrawn() const { return lastImpostorsDrawn; }
+	size_t getImpostorBakes() const { return impostorBakes; }
+	// Bytes of instance data and index lists uploaded by the last draw().
+	size_t getLastUploadBytes() const { return lastUploadBytes; }
+
+private:
+	struct LevelDraw {
+		// Copies kept by the last cull().
+		std::vector<uint32_t> visible;
+	};
+
+	struct PartDraw {
+		PartHandle part;
+		// Plant space, i.e. after the plant's and the part's transforms.
+		glm::mat4 local = glm::mat4(1.0f);
+		// Largest scale in local, for projecting LOD errors.
+		float localScale = 1.0f;
+		AABB localBounds;
+		std::shared_ptr<const PlantPartMesh> mesh;
+
+		// Level 0 is the full mesh and level k is mesh->lods[k - 1].
+		std::vector<LevelDraw> levels;
+	};
+
+	struct Group {
+		PlantHandle plant;
+		std::vector<PlantPlacement> placements;
+		std::vector<PlantInstance> instances;
+		float slopeAlignment = 0.0f;
+		SpatialHash hash;
+		std::vector<PartDraw> parts;
+		// Top of the parts' bounds in plant space, which the sway scales with.
+		float height = 0.0f;
+
+		// Where the copies start in the instance buffer.
+		size_t instanceBase = 0;
+		// The group's whole range needs uploading, or just the patched slots.
+		bool dirty = true;
+		std::vector<uint32_t> patched;
+
+		// This group's boxes are leaves[leafStart, leafStart + parts * instances).
+		size_t leafStart = 0;
+		// Every box needs recomputing, or just those of the moved copies.
+		bool boundsDirty = true;
+		std::vector<uint32_t> moved;
+
+		// Copies drawn as impostors, like PartDraw::visible. impostorMarked
+		// stops a copy being listed once per part.
+		std::vector<uint32_t> impostorVisible;
+		std::vector<uint32_t> impostorUploaded;
+		size_t impostorUploadedBase = 0;
+		std::vector<uint8_t> impostorMarked;
+		VertexBufferHandle impostorIndexBuffer;
+		std::unique_ptr<ImpostorAtlas> atlas;
+		bool impostorStale = true;
+	};
+
+	// One instanced draw: a level of a mesh, with the same part transform
+	// and plant height, for every plant that uses it.
+	struct Batch {
+		// Any of the parts drawn, to make the mesh resident through.
+		PartHandle part;
+		const PartDraw* draw = nullptr;
+		size_t level = 0;
+		float height = 0.0f;
+		// Indices into the instance buffer.
+		std::vector<uint32_t> instances;
+		// The next batch of the same mesh, or SIZE_MAX.
+		size_t next = SIZE_MAX;
+	};
+
+	// Keeps a batch's index list on the GPU while it does not change.
+	struct BatchBuffer {
+		VertexBufferHandle buffer;
+		std::vector<uint32_t> uploaded;
+	};
+
+	struct Leaf {
+		Group* group;
+		uint32_t part;
+		uint32_t instance;
+	};
+
+	static uint64_t keyOf(PlantHandle handle) {
+		return (uint64_t(handle.index) << 32) | handle.generation;
+	}
+
+	static PlantInstance makeInstance(const PlantPlacement& placement, float slopeAlignment);
+
+	// Matches group.parts to the plant's current parts. Returns true if the
+	// list of parts changed, and flags the group's bounds if any moved.
+	bool syncParts(Group& group, PlantStore& plants);
+	AABB leafBounds(const Group& group, uint32_t part, uint32_t instance) const;
+
+	// Uploads whatever changed in the instances since the last draw.
+	size_t upload();
+
+	std::unordered_map<uint64_t, std::unique_ptr<Group>> groups;
+
+	// Every group's instances, back to back. Laid out again whenever groups
+	// come, go or change size.
+	VertexBufferHandle instanceBuffer;
+	TextureHandle instanceTexture;
+	bool textureAttached = false;
+	bool layoutDirty = true;
+	std::vector<PlantInstance> staging;
+
+	// Rebuilt by every draw(); the first batchCount are in use, and batch i
+	// draws from batchBuffers[i].
+	std::vector<Batch> batches;
+	size_t batchCount = 0;
+	std::unordered_map<const PlantPartMesh*, size_t> firstBatch;
+	std::vector<BatchBuffer> batchBuffers;
+	std::vector<uint32_t> impostorIndices;
+
+	// Culling state. The leaves are rebuilt whenever groups or their parts
+	// come or go, and only refit otherwise.
+	bool structureDirty = true;
+	std::vector<Leaf> leaves;
+	std::vector<AABB> leafBoxes;
+	BVH bvh;
+	CullStats cullStats;
+
+	ImpostorSettings impostorSettings;
+	WindSettings windSettings;
+	// Attribute-less quads for impostors; made on first use.
+	std::unique_ptr<VertexArray> impostorQuads;
+	size_t impostorBakes = 0;
+
+	size_t lastDrawCalls = 0;
+	size_t lastInstancesDrawn = 0;
+	size_t lastImpostorsDrawn = 0;
+	size_t lastTrianglesDrawn = 0;
+	size_t lastUploadBytes = 0;
+};
@@ -0,0 +1,63 @@
+#include "PlantStore.h"
+
+#include <algorithm>
+
+
+PlantHandle PlantStore::createPlant(const std::string& name) {
+	PlantHandle plant = plants.emplace(name);
+	order.push_back(plant);
+	return plant;
+}
+
+
+PlantHandle PlantStore::duplicatePlant(PlantHandle source, const std::string& name) {
+	Plant* original = plants.get(source);
+	if (!original) {
+		return PlantHandle();
+	}
+
+	// Pool slots never move, so original stays valid across these emplaces.
+	PlantHandle copy = createPlant(name);
+	Plant* plant = plants.get(copy);
+	plant->setModelMatrix(original->getModelMatrix());
+
+	for (PartHandle part : original->getParts()) {
+		if (const PlantPart* originalPart = parts.get(part)) {
+			plant->addPart(parts.emplace(*originalPart));
+		}
+	}
+	return copy;
+}
+
+
+void PlantStore::removePlant(PlantHandle plant) {
+	Plant* p = plants.get(plant);
+	if (!p) {
+		return;
+	}
+
+	for (PartHandle part : p->getParts()) {
+		parts.remove(part);
+	}
+	plants.remove(plant);
+	order.erase(std::remove(order.begin(), order.end(), plant), order.end());
+}
+
+
+PartHandle PlantStore::createPart(PlantHandle plant, const std::string& name) {
+	Plant* p = plants.get(plant);
+	if (!p) {
+		return PartHandle();
+	}
+
+	PartHandle part = parts.emplace(name);
+	p->addPart(part);
+	return part;
+}
+
+
+void PlantStore::removePart(PlantHandle plant, int index) {
+	if (Plant* p = plants.get(plant)) {
+		parts.remove(p->removePart(index));
+	}
+}
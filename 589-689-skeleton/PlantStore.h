@@ -0,0 +1,60 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Owns every plant and plant part in the scene.
+//
+// Both live in HandlePools, so they never move once created and deleting one
+// does not shift the rest. Parts keep their curve data and meshes behind
+// shared pointers, so duplicating a plant copies little more than names,
+// transforms and handles until one of the copies is edited.
+//------------------------------------------------------------------------------
+
+#include "HandlePool.h"
+#include "Plant.h"
+#include "PlantPart.h"
+
+#include <string>
+#include <vector>
+
+using PlantHandle = PoolHandle<Plant>;
+
+class PlantStore {
+
+public:
+	PlantHandle createPlant(const std::string& name);
+
+	// Copies source and each of its parts under a new name. The copies share
+	// curve data and meshes with the originals until either side is edited.
+	PlantHandle duplicatePlant(PlantHandle source, const std::string& name);
+
+	// Removes the plant along with its parts.
+	void removePlant(PlantHandle plant);
+
+	PartHandle createPart(PlantHandle plant, const std::string& name);
+	void removePart(PlantHandle plant, int index);
+
+	Plant* getPlant(PlantHandle plant) { return plants.get(plant); }
+	PlantPart* getPart(PartHandle part) { return parts.get(part); }
+
+	// Plants in the order they were added, for listing in the UI. Only this
+	// list of handles shifts when a plant is removed.
+	const std::vector<PlantHandle>& getPlantOrder() const { return order; }
+	size_t plantCount() const { return order.size(); }
+	size_t partCount() const { return parts.size(); }
+
+	// Handle of the index-th plant in getPlantOrder(), or an invalid handle.
+	PlantHandle plantAt(int index) const {
+		return index >= 0 && index < (int)order.size() ? order[index] : PlantHandle();
+	}
+
+	// Calls fn(handle, part) for every part of every plant.
+	template <typename F>
+	void forEachPart(F&& fn) {
+		parts.forEach(std::forward<F>(fn));
+	}
+
+private:
+	HandlePool<Plant> plants;
+	HandlePool<PlantPart> parts;
+	std::vector<PlantHandle> order;
+};
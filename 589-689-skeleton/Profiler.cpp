@@ -0,0 +1,234 @@
+#include "Profiler.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+const Clock::time_point EPOCH = Clock::now();
+
+// Relaxed atomics, so that readers copying a slot the owner is overwriting is
+// not a data race; the fences around begun and head tell them it happened.
+struct Slot {
+	std::atomic<const char*> name{ nullptr };
+	std::atomic<uint64_t> start{ 0 };
+	std::atomic<uint64_t> end{ 0 };
+	std::atomic<uint32_t> depth{ 0 };
+};
+
+struct ThreadBuffer {
+	uint32_t id = 0;
+	// Guarded by the registry's mutex.
+	std::string name;
+	std::unique_ptr<Slot[]> slots{ new Slot[Profiler::RING_SIZE] };
+	// Events the owner has started writing, and finished writing.
+	std::atomic<uint64_t> begun{ 0 };
+	std::atomic<uint64_t> head{ 0 };
+	// Open zones; only touched by the owner.
+	uint32_t depth = 0;
+};
+
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+// Never destroyed, so that worker threads still running during static
+// destruction can record safely.
+Registry& registry() {
+	static Registry* instance = new Registry();
+	return *instance;
+}
+
+ThreadBuffer& threadBuffer() {
+	thread_local ThreadBuffer* buffer = nullptr;
+	if (!buffer) {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		auto created = std::make_unique<ThreadBuffer>();
+		created->id = uint32_t(r.buffers.size());
+		created->name = fmt::format("Thread {}", created->id);
+		buffer = created.get();
+		r.buffers.push_back(std::move(created));
+	}
+	return *buffer;
+}
+
+void record(ThreadBuffer& buffer, const char* name, uint64_t start, uint64_t end, uint32_t depth) {
+	uint64_t index = buffer.head.load(std::memory_order_relaxed);
+	buffer.begun.store(index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	Slot& slot = buffer.slots[index & (Profiler::RING_SIZE - 1)];
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.start.store(start, std::memory_order_relaxed);
+	slot.end.store(end, std::memory_order_relaxed);
+	slot.depth.store(depth, std::memory_order_relaxed);
+
+	buffer.head.store(index + 1, std::memory_order_release);
+}
+
+// Newest first, stopping at the first event that ended before since or has
+// been overwritten.
+void copyEvents(const ThreadBuffer& buffer, uint64_t since, std::vector<Profiler::Event>& out) {
+	uint64_t head = buffer.head.load(std::memory_order_acquire);
+	uint64_t oldest = head > Profiler::RING_SIZE ? head - Profiler::RING_SIZE : 0;
+	for (uint64_t i = head; i-- > oldest;) {
+		const Slot& slot = buffer.slots[i & (Profiler::RING_SIZE - 1)];
+		Profiler::Event event;
+		event.name = slot.name.load(std::memory_order_relaxed);
+		event.start = slot.start.load(std::memory_order_relaxed);
+		event.end = slot.end.load(std::memory_order_relaxed);
+		event.depth = slot.depth.load(std::memory_order_relaxed);
+
+		// If the owner has begun writing the event that reuses this slot,
+		// what was just read may be a mix of the two.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (buffer.begun.load(std::memory_order_relaxed) > i + Profiler::RING_SIZE) {
+			break;
+		}
+		if (event.end < since) {
+			break;
+		}
+		out.push_back(event);
+	}
+}
+
+// Frame starts, written and read on the thread that marks frames.
+uint64_t frames[Profiler::FRAME_HISTORY] = {};
+size_t framesMarked = 0;
+
+void writeEscaped(std::ostream& out, const char* text) {
+	for (const char* c = text; *c; ++c) {
+		if (*c == '"' || *c == '\\') out << '\\' << *c;
+		else if ((unsigned char)*c < 0x20) out << ' ';
+		else out << *c;
+	}
+}
+
+}
+
+
+uint64_t Profiler::now() {
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - EPOCH).count());
+}
+
+
+void Profiler::setThreadName(const std::string& name) {
+	ThreadBuffer& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(registry().mutex);
+	buffer.name = name;
+}
+
+
+void Profiler::markFrame() {
+	frames[framesMarked % FRAME_HISTORY] = now();
+	framesMarked++;
+}
+
+
+uint64_t Profiler::frameStart(size_t framesAgo) {
+	if (framesAgo >= framesMarked || framesAgo >= FRAME_HISTORY) {
+		return 0;
+	}
+	return frames[(framesMarked - 1 - framesAgo) % FRAME_HISTORY];
+}
+
+
+size_t Profiler::frameCount() {
+	return framesMarked;
+}
+
+
+std::vector<Profiler::ThreadEvents> Profiler::collect(uint64_t since) {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+
+	std::vector<ThreadEvents> result;
+	result.reserve(r.buffers.size());
+	for (const auto& buffer : r.buffers) {
+		ThreadEvents thread;
+		thread.id = buffer->id;
+		thread.name = buffer->name;
+		copyEvents(*buffer, since, thread.events);
+		std::reverse(thread.events.begin(), thread.events.end());
+		result.push_back(std::move(thread));
+	}
+	return result;
+}
+
+
+bool Profiler::exportChromeTrace(const std::string& path) {
+	std::vector<ThreadEvents> threads = collect();
+
+	std::ofstream file(path);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto separate = [&]() {
+		if (!first) file << ",\n";
+		first = false;
+	};
+
+	size_t events = 0;
+	for (const ThreadEvents& thread : threads) {
+		separate();
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread.id << ",\"args\":{\"name\":\"";
+		writeEscaped(file, thread.name.c_str());
+		file << "\"}}";
+
+		for (const Event& event : thread.events) {
+			separate();
+			file << "{\"name\":\"";
+			writeEscaped(file, event.name);
+			file << fmt::format("\",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":0,\"tid\":{}}}",
+				static_cast<double>(event.start) / 1000.0, static_cast<double>(event.end - event.start) / 1000.0, thread.id);
+			events++;
+		}
+	}
+
+	for (size_t i = std::min(framesMarked, FRAME_HISTORY); i-- > 0;) {
+		separate();
+		file << fmt::format("{{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"ts\":{:.3f},\"pid\":0,\"tid\":0}}", static_cast<double>(frameStart(i)) / 1000.0);
+	}
+	file << "\n]}\n";
+
+	if (!file) {
+		Log::error("PROFILER could not write {}", path);
+		return false;
+	}
+	Log::info("PROFILER wrote {} zones from {} threads to {}", events, threads.size(), path);
+	return true;
+}
+
+
+bool Profiler::isCompiledIn() {
+#ifdef ENABLE_PROFILING
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+Profiler::Zone::Zone(const char* name_)
+	: name(name_)
+{
+	threadBuffer().depth++;
+	start = now();
+}
+
+
+Profiler::Zone::~Zone() {
+	uint64_t end = now();
+	ThreadBuffer& buffer = threadBuffer();
+	buffer.depth--;
+	record(buffer, name, start, end, buffer.depth);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Scoped CPU timing zones, for seeing where frame time goes on the main thread
+// and the workers.
+//
+//     void Surface::generateSurface() {
+//         PROFILE_SCOPE("Surface::generateSurface");
+//         ...
+//     }
+//
+// A zone is recorded when its scope ends: name, start, end and how deeply it
+// is nested in other zones on the same thread. Each thread records into a
+// ring buffer of its own, so recording takes no locks and never allocates
+// once the thread's first zone has registered its buffer. Readers on other
+// threads copy events out while they are being written and throw away any
+// that were overwritten meanwhile. Only the last RING_SIZE zones per thread
+// are kept.
+//
+// PROFILE_FRAME() marks the start of a frame, so the flame view can show the
+// last few. Names must be string literals or otherwise outlive the profiler.
+//
+// The macros only record when ENABLE_PROFILING is defined (the CMake option
+// of the same name, on by default); otherwise they compile to nothing and the
+// functions below have no events to report.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Profiler {
+
+	// Zones kept per thread; a power of two.
+	const size_t RING_SIZE = 1 << 14;
+	// Frame starts kept.
+	const size_t FRAME_HISTORY = 256;
+
+	struct Event {
+		const char* name;
+		// Nanoseconds since the profiler started.
+		uint64_t start;
+		uint64_t end;
+		// 0 for zones not inside another on their thread.
+		uint32_t depth;
+	};
+
+	struct ThreadEvents {
+		uint32_t id;
+		std::string name;
+		// In the order they ended.
+		std::vector<Event> events;
+	};
+
+	// Nanoseconds since the profiler started.
+	uint64_t now();
+
+	// Names the calling thread in the flame view and exported traces.
+	void setThreadName(const std::string& name);
+
+	void markFrame();
+	// When the frame framesAgo frames before the current one started; 0 if
+	// not that many frames have been marked. Only valid on the thread that
+	// marks frames.
+	uint64_t frameStart(size_t framesAgo);
+	size_t frameCount();
+
+	// Every thread's zones that ended at or after since.
+	std::vector<ThreadEvents> collect(uint64_t since = 0);
+
+	// Writes all recorded zones and frame marks in the Chrome trace event
+	// format, for chrome://tracing or https://ui.perfetto.dev. Returns false,
+	// having logged why, if the file could not be written.
+	bool exportChromeTrace(const std::string& path);
+
+	// Whether the macros record anything in this build.
+	bool isCompiledIn();
+
+	// What PROFILE_SCOPE() declares.
+	class Zone {
+	public:
+		explicit Zone(const char* name);
+		~Zone();
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		const char* name;
+		uint64_t start;
+	};
+}
+
+#ifdef ENABLE_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ::Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME() ::Profiler::markFrame()
+#define PROFILE_THREAD(name) ::Profiler::setThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
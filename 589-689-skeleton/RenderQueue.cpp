@@ -0,0 +1,80 @@
+#include "RenderQueue.h"
+
+#include "GLState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+
+namespace {
+
+// Point sizes and line widths are keyed in steps of 1/QUANTUM, up to 127/QUANTUM.
+const float QUANTUM = 4.0f;
+
+uint64_t quantize(float value) {
+	return uint64_t(std::min(std::max(std::round(value * QUANTUM), 0.0f), 127.0f));
+}
+
+uint64_t polygonModeBits(GLenum mode) {
+	switch (mode) {
+	case GL_POINT: return 0;
+	case GL_LINE: return 1;
+	default: return 2;
+	}
+}
+
+}
+
+
+void RenderQueue::submit(const State& state, uint32_t mesh, std::function<void()> draw) {
+	items.push_back(Item{ makeKey(state, mesh), state, pass, std::move(draw) });
+}
+
+
+void RenderQueue::execute() {
+	order.resize(items.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		return items[a].key < items[b].key;
+	});
+
+	lastDraws = items.size();
+	lastProgramChanges = 0;
+	const ShaderProgram* previous = nullptr;
+	int timedPass = -1;
+	for (size_t i : order) {
+		const Item& item = items[i];
+		if (profiler && item.pass != timedPass) {
+			if (item.pass >= 0) profiler->begin(item.pass);
+			else profiler->end();
+			timedPass = item.pass;
+		}
+		GLState::bindFramebuffer(item.state.framebuffer ? item.state.framebuffer : target);
+		if (item.state.program) {
+			item.state.program->use();
+			lastProgramChanges += item.state.program != previous;
+			previous = item.state.program;
+		}
+		GLState::polygonMode(item.state.polygonMode);
+		GLState::pointSize(item.state.pointSize);
+		GLState::lineWidth(item.state.lineWidth);
+		item.draw();
+	}
+	if (profiler && timedPass >= 0) {
+		profiler->end();
+	}
+	items.clear();
+}
+
+
+uint64_t RenderQueue::makeKey(const State& state, uint32_t mesh) {
+	uint64_t material = (polygonModeBits(state.polygonMode) << 14) | (quantize(state.pointSize) << 7) | quantize(state.lineWidth);
+	uint64_t program = state.program ? GLuint(*state.program) : 0;
+	return (uint64_t(state.framebuffer & 0xFF) << 56)
+		| ((program & 0xFFFF) << 40)
+		| ((material & 0xFFFF) << 24)
+		| (mesh & 0xFFFFFF);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The frame's draws, collected and then run in the order that changes the
+// least state.
+//
+// Each submission carries the state it needs (framebuffer, program and the
+// fixed-function "material" state) and a callback that sets its uniforms,
+// binds its geometry and draws. execute() sorts the submissions by a 64-bit
+// key,
+//
+//     bits 63-56  framebuffer
+//          55-40  program
+//          39-24  material: polygon mode, point size, line width
+//          23-0   mesh
+//
+// and applies each one's state through GLState, which drops whatever is
+// already set. Submissions with equal keys keep their order.
+//
+// A framebuffer of 0 means the queue's target, which is the window unless
+// setTarget() says otherwise (the headless mode draws into its own).
+//
+// Submissions can be tagged with the GPU profiler pass they belong to (see
+// setPass()); execute() then starts the pass's timer whenever the sorted
+// order moves on to a draw of a different pass.
+//
+// Draws are only reordered among themselves, so anything that must happen
+// before them (culling, offscreen bakes) is done while submitting.
+//------------------------------------------------------------------------------
+
+#include "GPUProfiler.h"
+#include "ShaderProgram.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class RenderQueue {
+
+public:
+	struct State {
+		ShaderProgram* program = nullptr;
+		GLuint framebuffer = 0;
+		GLenum polygonMode = GL_FILL;
+		float pointSize = 1.0f;
+		float lineWidth = 1.0f;
+	};
+
+	// mesh identifies the geometry draw binds, so draws of the same mesh are
+	// run together; 0 for geometry of its own or several meshes. draw runs
+	// with state's program in use.
+	void submit(const State& state, uint32_t mesh, std::function<void()> draw);
+
+	// Runs and clears the queue.
+	void execute();
+
+	// Where draws with framebuffer 0 go.
+	void setTarget(GLuint framebuffer) { target = framebuffer; }
+	GLuint getTarget() const { return target; }
+
+	// Later submissions belong to profiler's pass; -1 for none.
+	void setProfiler(GPUProfiler* profiler_) { profiler = profiler_; }
+	void setPass(int pass_) { pass = pass_; }
+
+	static uint64_t makeKey(const State& state, uint32_t mesh);
+
+	size_t getLastDraws() const { return lastDraws; }
+	// Program changes among the last execute()'s draws once sorted.
+	size_t getLastProgramChanges() const { return lastProgramChanges; }
+
+private:
+	struct Item {
+		uint64_t key;
+		State state;
+		int pass;
+		std::function<void()> draw;
+	};
+
+	std::vector<Item> items;
+	// Kept to avoid reallocating every frame.
+	std::vector<size_t> order;
+	GLuint target = 0;
+	GPUProfiler* profiler = nullptr;
+	int pass = -1;
+
+	size_t lastDraws = 0;
+	size_t lastProgramChanges = 0;
+};
@@ -0,0 +1,236 @@
+#include "Scatter.h"
+
+#include "Log.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+
+namespace {
+
+// Tiles are this many grid cells wide. Must be at least 3: a point's neighbour
+// search reaches two cells out, and same-phase tiles are one tile apart.
+const int TILE_CELLS = 32;
+
+// Refuse grids beyond this many cells rather than exhaust memory on a tiny radius.
+const size_t MAX_GRID_CELLS = size_t(1) << 26;
+
+
+uint64_t splitMix(uint64_t x) {
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+float unitFloat(uint64_t bits) {
+	return float(bits >> 40) / float(1 << 24);
+}
+
+
+struct Grid {
+	glm::vec2 origin;
+	float cellSize;
+	float radius;
+	int cols;
+	int rows;
+	// One point per cell at most; x is NaN in empty cells.
+	std::vector<glm::vec2> cells;
+
+	bool inBounds(int col, int row) const { return col >= 0 && col < cols && row >= 0 && row < rows; }
+	bool isEmpty(int col, int row) const { return std::isnan(cells[size_t(row) * cols + col].x); }
+
+	bool hasNeighbour(glm::vec2 p) const {
+		int col = int((p.x - origin.x) / cellSize);
+		int row = int((p.y - origin.y) / cellSize);
+		float r2 = radius * radius;
+
+		for (int r = std::max(row - 2, 0); r <= std::min(row + 2, rows - 1); ++r) {
+			for (int c = std::max(col - 2, 0); c <= std::min(col + 2, cols - 1); ++c) {
+				glm::vec2 q = cells[size_t(r) * cols + c];
+				if (!std::isnan(q.x)) {
+					glm::vec2 d = q - p;
+					if (glm::dot(d, d) < r2) {
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+};
+
+
+struct Tile {
+	int col0, row0, col1, row1;
+};
+
+
+// Grows Bridson's algorithm inside one tile, writing into grid cells of that
+// tile only. Every empty cell is tried as a seed in order, so the tile ends up
+// fully covered even where earlier tiles' points border it.
+void fillTile(Grid& grid, const Tile& tile, int candidates, uint64_t seed, std::vector<glm::vec2>& out) {
+	std::mt19937 rng(uint32_t(seed ^ (seed >> 32)));
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	glm::vec2 low = grid.origin + grid.cellSize * glm::vec2(tile.col0, tile.row0);
+	glm::vec2 high = grid.origin + grid.cellSize * glm::vec2(tile.col1, tile.row1);
+	glm::vec2 domainHigh = grid.origin + grid.cellSize * glm::vec2(grid.cols, grid.rows);
+	high = glm::min(high, domainHigh);
+
+	auto tryInsert = [&](glm::vec2 p) {
+		if (p.x < low.x || p.y < low.y || p.x >= high.x || p.y >= high.y) {
+			return false;
+		}
+		int col = std::min(int((p.x - grid.origin.x) / grid.cellSize), tile.col1 - 1);
+		int row = std::min(int((p.y - grid.origin.y) / grid.cellSize), tile.row1 - 1);
+		if (!grid.isEmpty(col, row) || grid.hasNeighbour(p)) {
+			return false;
+		}
+		grid.cells[size_t(row) * grid.cols + col] = p;
+		out.push_back(p);
+		return true;
+	};
+
+	std::vector<glm::vec2> active;
+	for (int row = tile.row0; row < tile.row1; ++row) {
+		for (int col = tile.col0; col < tile.col1; ++col) {
+			if (!grid.isEmpty(col, row)) {
+				continue;
+			}
+
+			glm::vec2 start = grid.origin + grid.cellSize * glm::vec2(static_cast<float>(col) + unit(rng), static_cast<float>(row) + unit(rng));
+			if (!tryInsert(start)) {
+				continue;
+			}
+
+			active.push_back(start);
+			while (!active.empty()) {
+				size_t index = std::uniform_int_distribution<size_t>(0, active.size() - 1)(rng);
+				glm::vec2 centre = active[index];
+
+				bool placed = false;
+				for (int k = 0; k < candidates && !placed; ++k) {
+					float angle = unit(rng) * 6.28318530718f;
+					float distance = grid.radius * (1.0f + unit(rng));
+					glm::vec2 candidate = centre + distance * glm::vec2(std::cos(angle), std::sin(angle));
+					if (tryInsert(candidate)) {
+						active.push_back(candidate);
+						placed = true;
+					}
+				}
+
+				if (!placed) {
+					active[index] = active.back();
+					active.pop_back();
+				}
+			}
+		}
+	}
+}
+
+}
+
+
+float Scatter::density(const Settings& settings, float height, const glm::vec3& normal) {
+	float d = 1.0f;
+
+	if (height < settings.minHeight) {
+		d *= settings.heightFalloff > 0.0f ? std::max(0.0f, 1.0f - (settings.minHeight - height) / settings.heightFalloff) : 0.0f;
+	}
+	else if (height > settings.maxHeight) {
+		d *= settings.heightFalloff > 0.0f ? std::max(0.0f, 1.0f - (height - settings.maxHeight) / settings.heightFalloff) : 0.0f;
+	}
+
+	float slope = glm::degrees(std::acos(glm::clamp(normal.y, -1.0f, 1.0f)));
+	if (slope > settings.maxSlope) {
+		d = 0.0f;
+	}
+	else if (settings.slopeFalloff > 0.0f && slope > settings.maxSlope - settings.slopeFalloff) {
+		d *= (settings.maxSlope - slope) / settings.slopeFalloff;
+	}
+	return d;
+}
+
+
+std::vector<Scatter::Point> Scatter::poissonDisk(const Surface& surface, const Settings& settings) {
+	glm::vec2 low = surface.getMinXZ();
+	glm::vec2 high = surface.getMaxXZ();
+	if (settings.radius <= 0.0f || high.x <= low.x || high.y <= low.y) {
+		return {};
+	}
+
+	Grid grid;
+	grid.origin = low;
+	grid.radius = settings.radius;
+	grid.cellSize = settings.radius / std::sqrt(2.0f);
+	grid.cols = std::max(1, int(std::ceil((high.x - low.x) / grid.cellSize)));
+	grid.rows = std::max(1, int(std::ceil((high.y - low.y) / grid.cellSize)));
+
+	if (size_t(grid.cols) * grid.rows > MAX_GRID_CELLS) {
+		Log::error("Scatter radius {} is too small for the landscape", settings.radius);
+		return {};
+	}
+	grid.cells.assign(size_t(grid.cols) * grid.rows, glm::vec2(std::numeric_limits<float>::quiet_NaN()));
+
+	int tileCols = (grid.cols + TILE_CELLS - 1) / TILE_CELLS;
+	int tileRows = (grid.rows + TILE_CELLS - 1) / TILE_CELLS;
+	std::vector<Tile> tiles;
+	for (int ty = 0; ty < tileRows; ++ty) {
+		for (int tx = 0; tx < tileCols; ++tx) {
+			tiles.push_back(Tile{ tx * TILE_CELLS, ty * TILE_CELLS,
+				std::min((tx + 1) * TILE_CELLS, grid.cols), std::min((ty + 1) * TILE_CELLS, grid.rows) });
+		}
+	}
+
+	std::vector<std::vector<glm::vec2>> tilePoints(tiles.size());
+	for (int phase = 0; phase < 4; ++phase) {
+		std::vector<size_t> phaseTiles;
+		for (int ty = phase >> 1; ty < tileRows; ty += 2) {
+			for (int tx = phase & 1; tx < tileCols; tx += 2) {
+				phaseTiles.push_back(size_t(ty) * tileCols + tx);
+			}
+		}
+
+		ThreadPool::shared().parallelFor(phaseTiles.size(), 1, [&](size_t begin, size_t end, size_t) {
+			for (size_t i = begin; i < end; ++i) {
+				size_t t = phaseTiles[i];
+				fillTile(grid, tiles[t], settings.candidates, splitMix(settings.seed ^ splitMix(t)), tilePoints[t]);
+			}
+		});
+	}
+
+	// Lift onto the surface and thin by the density mask, tile by tile so the
+	// output order does not depend on scheduling.
+	std::vector<std::vector<Point>> kept(tiles.size());
+	ThreadPool::shared().parallelFor(tiles.size(), 1, [&](size_t begin, size_t end, size_t) {
+		for (size_t t = begin; t < end; ++t) {
+			for (size_t i = 0; i < tilePoints[t].size(); ++i) {
+				glm::vec2 p = tilePoints[t][i];
+				Point point;
+				float height;
+				if (!surface.heightAt(p.x, p.y, height) || !surface.normalAt(p.x, p.y, point.normal)) {
+					continue;
+				}
+
+				uint64_t bits = splitMix(settings.seed ^ splitMix((uint64_t(t) << 32) | i));
+				if (unitFloat(bits) >= density(settings, height, point.normal)) {
+					continue;
+				}
+
+				point.position = glm::vec3(p.x, height, p.y);
+				point.random = unitFloat(splitMix(bits));
+				kept[t].push_back(point);
+			}
+		}
+	});
+
+	std::vector<Point> points;
+	for (auto& tile : kept) {
+		points.insert(points.end(), tile.begin(), tile.end());
+	}
+	return points;
+}
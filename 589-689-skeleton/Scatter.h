@@ -0,0 +1,59 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Poisson-disk placement of points over the landscape.
+//
+// Points are grown with Bridson's algorithm on a background grid of cells
+// radius / sqrt(2) wide, so each cell holds at most one point. The domain is
+// split into square tiles processed in four checkerboard phases on the shared
+// ThreadPool: tiles in the same phase are at least one tile apart, and a tile
+// only ever reads points from tiles of earlier phases. Each tile seeds its own
+// random generator, so a given seed always yields the same points regardless
+// of thread count or scheduling.
+//
+// The result is then thinned by a density mask built from terrain height and
+// slope.
+//------------------------------------------------------------------------------
+
+#include "Surface.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace Scatter {
+	struct Settings {
+		// Minimum distance between points.
+		float radius = 0.1f;
+		// Candidates tried around each active point before it is retired.
+		int candidates = 30;
+		uint32_t seed = 1;
+
+		// Density is 1 inside [minHeight, maxHeight] and fades to 0 over
+		// heightFalloff beyond either end.
+		float minHeight = -1000.0f;
+		float maxHeight = 1000.0f;
+		float heightFalloff = 0.0f;
+
+		// Density fades from 1 to 0 as slope goes from maxSlope - slopeFalloff
+		// to maxSlope (degrees from horizontal).
+		float maxSlope = 90.0f;
+		float slopeFalloff = 0.0f;
+	};
+
+	struct Point {
+		glm::vec3 position;
+		glm::vec3 normal;
+		// Uniform in [0, 1), fixed per point for a given seed. Useful for
+		// picking a plant or varying the instance deterministically.
+		float random;
+	};
+
+	// Poisson-disk points over surface that survive its density mask, in a
+	// deterministic order.
+	std::vector<Point> poissonDisk(const Surface& surface, const Settings& settings);
+
+	// Density mask value at a surface point with the given normal.
+	float density(const Settings& settings, float height, const glm::vec3& normal);
+};
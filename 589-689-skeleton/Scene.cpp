@@ -1,5 +1,28 @@
 #include "Scene.h"
 # include "Noise.h"
+#include "GLState.h"
+#include "Profiler.h"
+
+namespace {
+
+// RenderQueue mesh ids of the geometry the scene draws; parts follow on from
+// FIRST_PART_MESH by handle index.
+const uint32_t TERRAIN_MESH = 1;
+const uint32_t STATIC_BATCH_MESH = 2;
+const uint32_t FIRST_PART_MESH = 3;
+
+// How long the main loop waits for events when idle, and while meshes or LOD
+// chains are being built in the background, in seconds.
+const double IDLE_TIMEOUT = 0.25;
+const double BUSY_TIMEOUT = 1.0 / 60.0;
+// How often a focused text field is redrawn so its caret blinks.
+const double CARET_BLINK_INTERVAL = 0.3;
+
+// Where the CPU profile window saves Chrome traces, relative to the working
+// directory.
+const char* TRACE_PATH = "profile.json";
+
+}
 
 // Fix the issue by properly initializing the `pickerTex` object using its constructor instead of calling it like a function.
 void Scene::initializeGpuPicking() {
@@ -42,16 +65,32 @@ void Scene::setShader(ShaderType type)
 void Scene::initialize() {
 
 	initializeLandscape();
+	overlayGeom.setStream(&overlayStream);
+
+	gpuPasses.clear = gpuProfiler.registerPass("Clear");
+	gpuPasses.picking = gpuProfiler.registerPass("Picking");
+	gpuPasses.terrain = gpuProfiler.registerPass("Terrain");
+	gpuPasses.population = gpuProfiler.registerPass("Population");
+	gpuPasses.staticBatch = gpuProfiler.registerPass("Static batch");
+	gpuPasses.controlPoints = gpuProfiler.registerPass("Control points");
+	gpuPasses.preview = gpuProfiler.registerPass("Plant preview");
+	gpuPasses.curves = gpuProfiler.registerPass("Curves");
+	gpuPasses.axes = gpuProfiler.registerPass("Axes");
+	gpuPasses.imgui = gpuProfiler.registerPass("ImGui");
+	renderQueue.setProfiler(&gpuProfiler);
 
 	shaders.at("default")->use();
 	cb->updateShadingUniforms(lightPos, lightCol, diffuseCol, ambientStrength, false);
+	shaders.at("instanced")->use();
+	cb->updateShadingUniforms(*shaders.at("instanced"), lightPos, lightCol, diffuseCol, ambientStrength, false);
+	shaders.at("impostor")->use();
+	cb->updateShadingUniforms(*shaders.at("impostor"), lightPos, lightCol, diffuseCol, ambientStrength, false);
+	shaders.at("sweep")->use();
+	cb->updateShadingUniforms(*shaders.at("sweep"), lightPos, lightCol, diffuseCol, ambientStrength, false);
 
 	// Create an orange object
-	Plant plant("Plant");
-	PlantPart part("PlantPart");
-
-	plant.addPart(part);
-	plants.push_back(plant);
+	PlantHandle plant = plants.createPlant("Plant");
+	plants.createPart(plant, "PlantPart");
 }
 
 void Scene::initializeLandscape() {
@@ -60,27 +99,28 @@ void Scene::initializeLandscape() {
 }
 
 void Scene::handleGPUPickingLandscape() {
+	PROFILE_SCOPE("Scene::handleGPUPickingLandscape");
 
 	if (!showControlPoints) {
 		return;
 	}
 
-	glEnable(GL_LINE_SMOOTH);
-	glEnable(GL_FRAMEBUFFER_SRGB);
-	glEnable(GL_DEPTH_TEST);
-	glDisable(GL_DITHER);
+	gpuProfiler.begin(gpuPasses.picking);
+	GLState::setEnabled(GL_LINE_SMOOTH, true);
+	GLState::setEnabled(GL_FRAMEBUFFER_SRGB, true);
+	GLState::setEnabled(GL_DEPTH_TEST, true);
+	GLState::setEnabled(GL_DITHER, false);
 
 	glm::ivec2 pickPos = cb->getMousePos();
 	pickPos.y = window.getHeight() - pickPos.y;
 
-	GPU_Geometry gpuGeom;
 	std::vector<std::vector<glm::vec3>> cp = landscape.getControlGrid();
 
 	std::vector<glm::vec3> flattenedControlPoints;
 	for (const auto& row : cp) {
 		flattenedControlPoints.insert(flattenedControlPoints.end(), row.begin(), row.end());
 	}
-	gpuGeom.setVerts(flattenedControlPoints);
+	overlayGeom.setVerts(flattenedControlPoints);
 
 	// We'll draw each point one at a time
 	for (int i = 0; i < flattenedControlPoints.size(); ++i) {
@@ -88,23 +128,23 @@ void Scene::handleGPUPickingLandscape() {
 		glClearBufferiv(GL_COLOR, 0, pickerClearValue);
 		glClear(GL_DEPTH_BUFFER_BIT);
 
-		glEnable(GL_SCISSOR_TEST);
+		GLState::setEnabled(GL_SCISSOR_TEST, true);
 		glScissor(pickPos.x, pickPos.y, 1, 1);
 
 		shaders.at("picker")->use();
 		cb->viewPipelinePicker();
 
-		gpuGeom.bind();
+		overlayGeom.bind();
 
-		glPointSize(15);
+		GLState::pointSize(15.0f);
 		glDrawArrays(GL_POINTS, i, 1);
 
 		GLint pickTexCPU[1];
 		pickerTex.bind();
 		glReadPixels(pickPos.x, pickPos.y, 1, 1, GL_RED_INTEGER, GL_INT, pickTexCPU);
 
-		pickerFB.unbind();
-		glDisable(GL_SCISSOR_TEST);
+		GLState::bindFramebuffer(renderTarget);
+		GLState::setEnabled(GL_SCISSOR_TEST, false);
 
 		if (pickTexCPU[0] == 1) {
 			controlPointIndex = i;
@@ -112,10 +152,12 @@ void Scene::handleGPUPickingLandscape() {
 			break;
 		}
 	}
-	glEnable(GL_DITHER);
+	GLState::setEnabled(GL_DITHER, true);
+	gpuProfiler.end();
 }
 
 void Scene::drawImGui() {
+	PROFILE_SCOPE("Scene::drawImGui");
 	// Three functions that must be called each new frame.
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -134,6 +176,36 @@ void Scene::drawImGui() {
 
 	// Framerate display, in case you need to debug performance.
 	ImGui::Text("Average %.1f ms/frame (%.1f fps)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+	// Summed from each pass's last measurement, a few frames behind.
+	double gpuMs = 0.0;
+	for (size_t i = 0; i < gpuProfiler.passCount(); ++i) {
+		gpuMs += gpuProfiler.stats(int(i)).last;
+	}
+	ImGui::Text("GPU %.2f ms/frame", gpuMs);
+	ImGui::SameLine();
+	ImGui::Checkbox("GPU passes", &showGPUProfiler);
+	ImGui::SameLine();
+	ImGui::Checkbox("CPU zones", &showProfiler);
+	ImGui::Text("Last mesh batch: %zu parts in %.2f ms", meshBatcher.getLastBatchSize(), meshBatcher.getLastBatchMs());
+	// Validate builds both sweep paths and logs how far the fast one strays.
+	const char* generationModes[] = { "Reference", "Fast", "Validate" };
+	int generationMode = int(PlantPart::getGenerationMode());
+	if (ImGui::Combo("Sweep generation", &generationMode, generationModes, IM_ARRAYSIZE(generationModes))) {
+		PlantPart::setGenerationMode(PlantPart::GenerationMode(generationMode));
+	}
+	ImGui::Text("Last LOD batch: %zu meshes in %.2f ms", lodBuilder.getLastBatchSize(), lodBuilder.getLastBatchMs());
+	ImGui::Text("Mesh cache: %zu/%zu (%zu hits, %zu misses)", meshCache.size(), meshCache.getCapacity(), meshCache.getHits(), meshCache.getMisses());
+	ImGui::Text("GPU uploads: %zu this frame (%zu bytes)", gpuMeshes.getFrameUploads(), gpuMeshes.getFrameBytes());
+	ImGui::Text("GPU sweep uploads: %zu bytes this frame", gpuSweep.getFrameBytes());
+	ImGui::Text("Camera block uploads: %zu", cb->getFrameUploads());
+	ImGui::Text("Overlay stream (%s): %zu bytes this frame, %zu waits, %zu overflows", StreamBuffer::modeName(overlayStream.getMode()),
+		overlayStream.getFrameBytes(), overlayStream.getWaits(), overlayStream.getOverflows());
+	const GLState::Counts& glCounts = GLState::getLastFrameCounts();
+	ImGui::Text("Render queue: %zu draws, %zu program changes", renderQueue.getLastDraws(), renderQueue.getLastProgramChanges());
+	ImGui::Text("GL state: %zu calls issued, %zu redundant dropped", glCounts.issued, glCounts.redundant);
+	ImGui::Checkbox("Redraw only on change", &onDemandRendering);
+	ImGui::Text("%zu frames drawn, %zu idle updates skipped", framesDrawn, updatesSkipped);
+	ImGui::Checkbox("GPU residency", &showGPUResidency);
 
 	ImGui::Dummy(ImVec2(0.0f, 5.0f));
 	ImGui::Checkbox("3D Axes", &show3DAxes);
@@ -169,22 +241,329 @@ void Scene::drawImGui() {
 
 		ImGui::Dummy(ImVec2(0.0f, 2.0f));
 		ImGui::Checkbox("Show control points", &showControlPoints);
+
+		drawPopulationImGui();
 	}
 	else if (comboSelection == 1) {
 		drawEditingImGui();
 	}
 		
 	ImGui::End();
+
+	if (showGPUResidency) {
+		drawGPUResidencyImGui();
+	}
+
+	if (showGPUProfiler) {
+		drawGPUProfilerImGui();
+	}
+	if (showProfiler) {
+		drawProfilerImGui();
+	}
+
 	ImGui::Render();
 	
+	gpuProfiler.begin(gpuPasses.imgui);
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	gpuProfiler.end();
+}
+
+void Scene::drawGPUResidencyImGui() {
+	ImGui::Begin("GPU Residency", &showGPUResidency);
+	ImGui::Text("%zu meshes resident for %zu parts, %.1f KB uploaded in total", gpuMeshes.size(), plants.partCount(), static_cast<double>(gpuMeshes.getTotalBytes()) / 1024.0);
+
+	if (ImGui::BeginTable("##residency", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Part");
+		ImGui::TableSetupColumn("Resident");
+		ImGui::TableSetupColumn("Vertices");
+		ImGui::TableSetupColumn("Uploads");
+		ImGui::TableSetupColumn("KB uploaded");
+		ImGui::TableSetupColumn("ACMR");
+		ImGui::TableHeadersRow();
+
+		for (PlantHandle plantHandle : plants.getPlantOrder()) {
+			const Plant& plant = *plants.getPlant(plantHandle);
+			for (PartHandle handle : plant.getParts()) {
+				const PlantPart& part = *plants.getPart(handle);
+				const PlantPartGPUCache::Entry* entry = gpuMeshes.find(handle);
+				// Resident but stale until the part is next drawn.
+				bool current = entry && entry->uploaded == part.getMesh();
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s / %s", plant.getName().c_str(), part.getName().c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", !entry ? "no" : current ? "yes" : "stale");
+				ImGui::TableNextColumn();
+				ImGui::Text("%zu", entry ? entry->uploaded->surface.size() : 0);
+				ImGui::TableNextColumn();
+				ImGui::Text("%zu", entry ? entry->uploads : 0);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f", entry ? static_cast<double>(entry->bytesUploaded) / 1024.0 : 0.0);
+				ImGui::TableNextColumn();
+				// Before and after the part's indices were reordered.
+				ImGui::Text("%.2f -> %.2f", part.getMesh()->acmrBefore, part.getMesh()->acmrAfter);
+			}
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
+
+void Scene::drawGPUProfilerImGui() {
+	ImGui::Begin("GPU Passes", &showGPUProfiler);
+	bool enabled = gpuProfiler.isEnabled();
+	if (ImGui::Checkbox("Time passes", &enabled)) {
+		gpuProfiler.setEnabled(enabled);
+	}
+	ImGui::Text("Over each pass's last %d measured frames; %zu frames skipped waiting on the GPU", GPUProfiler::HISTORY, gpuProfiler.getSkippedFrames());
+
+	if (ImGui::BeginTable("##gpuPasses", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Pass");
+		ImGui::TableSetupColumn("Last ms");
+		ImGui::TableSetupColumn("Mean");
+		ImGui::TableSetupColumn("Median");
+		ImGui::TableSetupColumn("95th %");
+		ImGui::TableSetupColumn("Max");
+		ImGui::TableHeadersRow();
+
+		for (size_t i = 0; i < gpuProfiler.passCount(); ++i) {
+			GPUProfiler::Stats stats = gpuProfiler.stats(int(i));
+			if (stats.samples == 0) {
+				continue;
+			}
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", gpuProfiler.passName(int(i)).c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", stats.last);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", stats.mean);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", stats.median);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", stats.p95);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", stats.max);
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
+
+void Scene::drawProfilerImGui() {
+	ImGui::Begin("CPU Profile", &showProfiler);
+	if (!Profiler::isCompiledIn()) {
+		ImGui::Text("Built without ENABLE_PROFILING, so no zones are recorded.");
+		ImGui::End();
+		return;
+	}
+
+	ImGui::SliderInt("Frames", &profilerFrames, 1, 30);
+	ImGui::SameLine();
+	if (ImGui::Button("Save Chrome trace")) {
+		traceStatus = Profiler::exportChromeTrace(TRACE_PATH) ? std::string("Saved ") + TRACE_PATH : "Could not save the trace";
+	}
+	if (!traceStatus.empty()) {
+		ImGui::SameLine();
+		ImGui::Text("%s", traceStatus.c_str());
+	}
+
+	// The last profilerFrames complete frames; this one is still being drawn.
+	uint64_t end = Profiler::frameStart(0);
+	uint64_t begin = Profiler::frameStart(size_t(profilerFrames));
+	if (begin == 0 || end <= begin) {
+		ImGui::Text("Waiting for %d frames", profilerFrames);
+		ImGui::End();
+		return;
+	}
+	ImGui::Text("%.2f ms over %d frames", static_cast<double>(end - begin) / 1e6, profilerFrames);
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+	const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+	const double scale = width / double(end - begin);
+	const ImU32 frameLine = ImGui::GetColorU32(ImGuiCol_TextDisabled);
+
+	for (const Profiler::ThreadEvents& thread : Profiler::collect(begin)) {
+		uint32_t depth = 0;
+		bool any = false;
+		for (const Profiler::Event& event : thread.events) {
+			if (event.start < end) {
+				depth = std::max(depth, event.depth);
+				any = true;
+			}
+		}
+		if (!any) {
+			continue;
+		}
+
+		ImGui::Text("%s (%u)", thread.name.c_str(), thread.id);
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		ImGui::PushID(int(thread.id));
+		ImGui::InvisibleButton("##zones", ImVec2(width, static_cast<float>(depth + 1) * rowHeight));
+		ImGui::PopID();
+		bool hovered = ImGui::IsItemHovered();
+		ImVec2 mouse = ImGui::GetIO().MousePos;
+
+		for (int i = 1; i < profilerFrames; ++i) {
+			float x = origin.x + float(static_cast<double>(Profiler::frameStart(size_t(i)) - begin) * scale);
+			drawList->AddLine(ImVec2(x, origin.y), ImVec2(x, origin.y + static_cast<float>(depth + 1) * rowHeight), frameLine);
+		}
+
+		for (const Profiler::Event& event : thread.events) {
+			if (event.start >= end) {
+				continue;
+			}
+			float x0 = origin.x + float(static_cast<double>(std::max(event.start, begin) - begin) * scale);
+			float x1 = origin.x + float(static_cast<double>(std::min(event.end, end) - begin) * scale);
+			x1 = std::max(x1, x0 + 1.0f);
+			float y0 = origin.y + static_cast<float>(event.depth) * rowHeight;
+			float y1 = y0 + rowHeight - 1.0f;
+
+			float hue = float(std::hash<const void*>()(event.name) % 360) / 360.0f;
+			drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), ImColor::HSV(hue, 0.45f, 0.75f));
+			if (x1 - x0 > 20.0f) {
+				drawList->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+				drawList->AddText(ImVec2(x0 + 2.0f, y0), IM_COL32_BLACK, event.name);
+				drawList->PopClipRect();
+			}
+			if (hovered && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1) {
+				ImGui::SetTooltip("%s\n%.3f ms", event.name, static_cast<double>(event.end - event.start) / 1e6);
+			}
+		}
+	}
+	ImGui::End();
+}
+
+void Scene::drawPopulationImGui() {
+	ImGui::Dummy(ImVec2(0.0f, 10.0f));
+	ImGui::Text("Plant Population");
+
+	// Points are shared out evenly between the ticked plants.
+	for (int i = 0; i < static_cast<int>(plants.plantCount()); ++i) {
+		PlantHandle handle = plants.plantAt(i);
+		auto chosen = std::find(scatterPlants.begin(), scatterPlants.end(), handle);
+		bool include = chosen != scatterPlants.end();
+		if (ImGui::Checkbox((plants.getPlant(handle)->getName() + "##scatter").c_str(), &include)) {
+			if (include) scatterPlants.push_back(handle);
+			else scatterPlants.erase(chosen);
+		}
+	}
+
+	ImGui::SliderFloat("Spacing", &scatterSettings.radius, 0.02f, 2.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+	ImGui::DragFloatRange2("Height range", &scatterSettings.minHeight, &scatterSettings.maxHeight, 0.05f, -50.0f, 50.0f);
+	ImGui::SliderFloat("Height falloff", &scatterSettings.heightFalloff, 0.0f, 5.0f);
+	ImGui::SliderFloat("Max slope", &scatterSettings.maxSlope, 0.0f, 90.0f);
+	ImGui::SliderFloat("Slope falloff", &scatterSettings.slopeFalloff, 0.0f, 45.0f);
+	ImGui::SliderFloat("Align to slope", &scatterSlopeAlignment, 0.0f, 1.0f);
+	ImGui::InputScalar("Seed", ImGuiDataType_U32, &scatterSettings.seed);
+
+	if (ImGui::Button("Scatter")) {
+		scatterPopulation();
+		staticBatch.clear();
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Clear Population")) {
+		for (PlantHandle handle : plants.getPlantOrder()) {
+			population.remove(handle);
+		}
+		staticBatch.clear();
+	}
+
+	ImGui::Text("Last scatter: %zu points in %.1f ms", lastScatterCount, lastScatterMs);
+	ImGui::Text("%zu instances in %zu draw calls", population.getLastInstancesDrawn(), population.getLastDrawCalls());
+	ImGui::Text("Last re-snap: %zu instances, %zu bytes uploaded", lastResnapCount, population.getLastUploadBytes());
+
+	ImGui::Checkbox("Frustum culling", &cullingEnabled);
+	ImGui::SameLine();
+	ImGui::Checkbox("Occlusion culling", &occlusionCulling);
+	const PlantPopulation::CullStats& stats = population.getCullStats();
+	ImGui::Text("Parts: %zu of %zu kept in %.2f ms", stats.kept, stats.total, stats.ms);
+	ImGui::Text("Culled: %zu by frustum, %zu by terrain", stats.frustumCulled, stats.occlusionCulled);
+	ImGui::Text("Terrain: %zu of %zu chunks drawn", terrainChunksDrawn, landscape.getChunks().size());
+	bool heightMapTerrain = landscape.getRenderMode() == Surface::RenderMode::HEIGHT_MAP;
+	if (ImGui::Checkbox("Terrain from height map", &heightMapTerrain)) {
+		landscape.setRenderMode(heightMapTerrain ? Surface::RenderMode::HEIGHT_MAP : Surface::RenderMode::TRIANGLES);
+	}
+	ImGui::Text("Last terrain upload: %zu bytes", landscape.getLastUploadBytes());
+
+	ImGui::Checkbox("LODs", &lodSettings.enabled);
+	ImGui::SliderFloat("LOD pixel error", &lodSettings.pixelError, 0.1f, 8.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+	ImGui::Text("%zu of %zu parts simplified, %zu triangles", stats.simplified, stats.kept, population.getLastTrianglesDrawn());
+
+	ImGui::Checkbox("Impostors", &impostorSettings.enabled);
+	ImGui::SliderFloat("Impostor distance", &impostorSettings.distance, 1.0f, 50.0f);
+	ImGui::SliderFloat("Cross-fade width", &impostorSettings.fadeWidth, 0.0f, 10.0f);
+	ImGui::Text("%zu impostors drawn, %zu atlas bakes", population.getLastImpostorsDrawn(), population.getImpostorBakes());
+
+	// Merges plants and terrain into a few buffers; edits undo it.
+	if (ImGui::Button("Bake static scene")) {
+		staticBatch.bake(plants, population, landscape);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Clear bake")) {
+		staticBatch.clear();
+	}
+	if (staticBatch.isBaked()) {
+		const StaticBatch::Stats& baked = staticBatch.getStats();
+		ImGui::Text("Baked: %zu triangles in %zu cells, %.1f MB, %.1f ms", baked.triangles, baked.cells, static_cast<double>(baked.bytes) / (1024.0 * 1024.0), baked.ms);
+		ImGui::Text("%zu cell ranges drawn in 2 draw calls", staticCellsDrawn);
+	}
+
+	ImGui::Checkbox("Wind", &windSettings.enabled);
+	ImGui::SliderAngle("Wind direction", &windAngle, -180.0f, 180.0f);
+	ImGui::SliderFloat("Wind strength", &windSettings.strength, 0.0f, 0.5f);
+	ImGui::SliderFloat("Wind frequency", &windSettings.frequency, 0.1f, 6.0f);
+	windSettings.direction = glm::vec2(std::cos(windAngle), std::sin(windAngle));
+}
+
+void Scene::scatterPopulation() {
+	std::vector<PlantHandle> targets;
+	for (PlantHandle handle : scatterPlants) {
+		if (plants.getPlant(handle)) targets.push_back(handle);
+	}
+	if (targets.empty()) {
+		std::cout << "Select at least one plant to scatter" << std::endl;
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<Scatter::Point> points = Scatter::poissonDisk(landscape, scatterSettings);
+	lastScatterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	lastScatterCount = points.size();
+
+	std::vector<std::vector<PlantPlacement>> placements(targets.size());
+
+	// Derived from each point's own random value, so a seed always gives the
+	// same population.
+	for (const Scatter::Point& point : points) {
+		float r = point.random * static_cast<float>(targets.size());
+		size_t target = std::min(size_t(r), targets.size() - 1);
+		float variation = r - static_cast<float>(target);
+
+		PlantPlacement placement;
+		placement.position = point.position;
+		placement.normal = point.normal;
+		placement.yaw = variation * glm::two_pi<float>();
+		placement.scale = 0.8f + 0.4f * glm::fract(variation * 7.0f);
+		placement.tint = glm::vec3(0.85f) + 0.3f * glm::fract(variation * glm::vec3(13.0f, 17.0f, 19.0f));
+		placement.windPhase = glm::fract(variation * 23.0f) * glm::two_pi<float>();
+		placement.stiffness = 0.75f + 0.5f * glm::fract(variation * 29.0f);
+		placements[target].push_back(placement);
+	}
+
+	for (size_t i = 0; i < targets.size(); ++i) {
+		population.setPlacements(targets[i], std::move(placements[i]), scatterSlopeAlignment);
+	}
 }
 
 void Scene::drawEditingImGui() {
-	if (ImGui::BeginCombo("Plants", selectedPlantIndex >= 0 ? plants[selectedPlantIndex].getName().c_str() : "Select a Plant")) {
-		for (int i = 0; i < plants.size(); ++i) {
+	Plant* currentPlant = getSelectedPlant();
+	if (ImGui::BeginCombo("Plants", currentPlant ? currentPlant->getName().c_str() : "Select a Plant")) {
+		for (int i = 0; i < static_cast<int>(plants.plantCount()); ++i) {
 			bool isSelected = (selectedPlantIndex == i);
-			if (ImGui::Selectable(plants[i].getName().c_str(), isSelected)) {
+			if (ImGui::Selectable(plants.getPlant(plants.plantAt(i))->getName().c_str(), isSelected)) {
 				selectedPlantIndex = i;
 				selectedPartIndex = -1;
 			}
@@ -195,22 +574,45 @@ void Scene::drawEditingImGui() {
 		ImGui::EndCombo();
 	}
 	if (ImGui::Button("Delete Plant")) {
-		if (!plants.empty() && selectedPlantIndex < plants.size()) {
-			plants.erase(plants.begin() + selectedPlantIndex);
-			if (selectedPlantIndex >= plants.size()) {
+		if (currentPlant) {
+			plants.removePlant(plants.plantAt(selectedPlantIndex));
+			if (selectedPlantIndex >= static_cast<int>(plants.plantCount())) {
 				selectedPlantIndex = -1;
 			}
 			selectedPartIndex = -1;
 		}
 	}
+	ImGui::SameLine();
+	// The copy shares curves and meshes with the original until either is edited.
+	if (ImGui::Button("Duplicate Plant")) {
+		if (currentPlant) {
+			std::string name = currentPlant->getName() + " copy";
+			for (int i = 2; ; ++i) {
+				bool taken = false;
+				for (PlantHandle handle : plants.getPlantOrder()) {
+					taken = taken || plants.getPlant(handle)->getName() == name;
+				}
+				if (!taken) break;
+				name = currentPlant->getName() + " copy " + std::to_string(i);
+			}
+
+			plants.duplicatePlant(plants.plantAt(selectedPlantIndex), name);
+			selectedPlantIndex = (int)plants.plantCount() - 1;
+			selectedPartIndex = -1;
+			previewingPlant = false;
+			previewingPart = false;
+		}
+	}
 
 	ImGui::Dummy(ImVec2(0.0f, 10.0f));
-	if (selectedPlantIndex >= 0) {
-		const auto& selectedPlant = plants[selectedPlantIndex];
-		if (ImGui::BeginCombo("Parts", selectedPartIndex >= 0 ? selectedPlant.getParts()[selectedPartIndex].getName().c_str() : "Select a Part")) {
+	currentPlant = getSelectedPlant();
+	if (currentPlant) {
+		const auto& selectedPlant = *currentPlant;
+		PlantPart* currentPart = getSelectedPart();
+		if (ImGui::BeginCombo("Parts", currentPart ? currentPart->getName().c_str() : "Select a Part")) {
 			for (int i = 0; i < selectedPlant.getParts().size(); ++i) {
 				bool isSelected = (selectedPartIndex == i);
-				if (ImGui::Selectable(selectedPlant.getParts()[i].getName().c_str(), isSelected)) {
+				if (ImGui::Selectable(plants.getPart(selectedPlant.getParts()[i])->getName().c_str(), isSelected)) {
 					selectedPartIndex = i;
 				}
 				if (isSelected) {
@@ -221,13 +623,9 @@ void Scene::drawEditingImGui() {
 		}
 
 		if (ImGui::Button("Delete Part")) {
-			if (!plants.empty() && selectedPlantIndex < plants.size()) {
-				auto& parts = plants[selectedPlantIndex].getParts();
-
-				if (!parts.empty() && selectedPartIndex < parts.size()) {
-					plants[selectedPlantIndex].removePart(selectedPartIndex);
-					selectedPartIndex = -1;
-				}
+			if (currentPart) {
+				plants.removePart(plants.plantAt(selectedPlantIndex), selectedPartIndex);
+				selectedPartIndex = -1;
 			}
 		}
 
@@ -237,8 +635,8 @@ void Scene::drawEditingImGui() {
 		if (ImGui::Button("Add New Plant")) {
 			if (strlen(plantName) > 0) {
 
-				for (auto& plant : plants) {
-					if (plant.getName() == plantName) {
+				for (PlantHandle handle : plants.getPlantOrder()) {
+					if (plants.getPlant(handle)->getName() == plantName) {
 						std::cout << "Another plant with the same name already exists" << std::endl;
 						return;
 					}
@@ -250,8 +648,7 @@ void Scene::drawEditingImGui() {
 				selectedPlantIndex = -1;
 				selectedPartIndex = -1;
 
-				Plant newPlant(plantName);
-				plants.push_back(newPlant);
+				plants.createPlant(plantName);
 			}
 		}
 
@@ -259,11 +656,9 @@ void Scene::drawEditingImGui() {
 		static char partName[64] = "";
 		ImGui::InputText("Part Name", partName, sizeof(partName));
 		if (ImGui::Button("Add New Part")) {
-			if (strlen(partName) > 0 && selectedPlantIndex < plants.size()) {
-				auto& parts = plants[selectedPlantIndex].getParts();
-
-				for (auto& part : parts) {
-					if (part.getName() == partName) {
+			if (strlen(partName) > 0) {
+				for (PartHandle handle : selectedPlant.getParts()) {
+					if (plants.getPart(handle)->getName() == partName) {
 						std::cout << "Another part with the same name already exists" << std::endl;
 						return;
 					}
@@ -272,17 +667,17 @@ void Scene::drawEditingImGui() {
 				previewingPlant = false;
 				previewingPart = false;
 
-				PlantPart newPart(partName);
-				plants[selectedPlantIndex].addPart(newPart);
+				plants.createPart(plants.plantAt(selectedPlantIndex), partName);
 			}
 		}
 	}
 
-	if (selectedPlantIndex >= 0 && selectedPartIndex >= 0 && !previewingPlant && !previewingPart) {
+	if (getSelectedPart() && !previewingPlant && !previewingPart) {
 		
-		auto& selectedPart = plants[selectedPlantIndex].getParts()[selectedPartIndex];
-
-		selectedPart.setSurfaceGenerated(false);
+		auto& selectedPart = *getSelectedPart();
+		// Control points are read through this so that only actual edits
+		// detach the part's geometry from a duplicate it is shared with.
+		const PlantPart& viewedPart = selectedPart;
 
 		ImGui::Dummy(ImVec2(0.0f, 10.0f));
 		ImGui::Text("-------------------------------");
@@ -300,7 +695,7 @@ void Scene::drawEditingImGui() {
 		if (showLeftCurve && !previewingPart && !previewingPlant) {
 			int index = -1;
 
-			PointsData& leftControlPoints = selectedPart.getLeftControlPoints();
+			const PointsData& leftControlPoints = viewedPart.getLeftControlPoints();
 
 			for (int i = 0; i < leftControlPoints.selected.size(); ++i) {
 				if (leftControlPoints.selected.at(i)) {
@@ -313,33 +708,35 @@ void Scene::drawEditingImGui() {
 				bool weightChanged = ImGui::SliderFloat("Weight", &weight, 0.0f, 20.0f);
 
 				if (weightChanged) {
-					leftControlPoints.weights.at(index) = weight;
-					std::vector<glm::vec3> leftCurve = updateBSpline(leftControlPoints);
+					PointsData& edited = selectedPart.getLeftControlPoints();
+					edited.weights.at(index) = weight;
+					std::vector<glm::vec3> leftCurve = updateBSpline(edited);
 					selectedPart.setLeftCurve(leftCurve);
 				}
 			}
 
 			if (leftControlPoints.needsUpdate) {
-				selectedPart.setLeftCurve(updateBSpline(leftControlPoints));
-				leftControlPoints.needsUpdate = false;
+				PointsData& edited = selectedPart.getLeftControlPoints();
+				selectedPart.setLeftCurve(updateBSpline(edited));
+				edited.needsUpdate = false;
 			}
 
-			handleEditingControlPointUpdate(leftControlPoints);
+			if (cb->isLeftMouseDown() || cb->isRightMouseDown()) {
+				handleEditingControlPointUpdate(selectedPart.getLeftControlPoints());
+			}
+			else {
+				controlPointIndex = -1;
+			}
 
 			showRightCurve = false;
 			showCrossSection = false;
-
-			GPU_Geometry gpuGeom;
-			gpuGeom.setVerts(leftControlPoints.cpuGeom.verts);
-			gpuGeom.setCols(leftControlPoints.cpuGeom.cols);
-			gpuGeom.bind();
 		}
 
 		ImGui::Checkbox("Right Curve", &showRightCurve);
 		if (showRightCurve && !previewingPart && !previewingPlant) {
 			int index = -1;
 
-			PointsData& rightControlPoints = selectedPart.getRightControlPoints();
+			const PointsData& rightControlPoints = viewedPart.getRightControlPoints();
 
 			for (int i = 0; i < rightControlPoints.selected.size(); ++i) {
 				if (rightControlPoints.selected.at(i)) {
@@ -352,37 +749,39 @@ void Scene::drawEditingImGui() {
 				bool weightChanged = ImGui::SliderFloat("Weight", &weight, 0.0f, 20.0f);
 
 				if (weightChanged) {
-					rightControlPoints.weights.at(index) = weight;
-					std::vector<glm::vec3> rightCurve = updateBSpline(rightControlPoints);
+					PointsData& edited = selectedPart.getRightControlPoints();
+					edited.weights.at(index) = weight;
+					std::vector<glm::vec3> rightCurve = updateBSpline(edited);
 					selectedPart.setRightCurve(rightCurve);
 				}
 			}
 
 			if (rightControlPoints.needsUpdate) {
-				selectedPart.setRightCurve(updateBSpline(rightControlPoints));
-				rightControlPoints.needsUpdate = false;
+				PointsData& edited = selectedPart.getRightControlPoints();
+				selectedPart.setRightCurve(updateBSpline(edited));
+				edited.needsUpdate = false;
 			}
 
 			if (cb->isLeftMouseDown()) {
 
 			}
 
-			handleEditingControlPointUpdate(rightControlPoints);
+			if (cb->isLeftMouseDown() || cb->isRightMouseDown()) {
+				handleEditingControlPointUpdate(selectedPart.getRightControlPoints());
+			}
+			else {
+				controlPointIndex = -1;
+			}
 
 			showLeftCurve = false;
 			showCrossSection = false;
-
-			GPU_Geometry gpuGeom;
-			gpuGeom.setVerts(rightControlPoints.cpuGeom.verts);
-			gpuGeom.setCols(rightControlPoints.cpuGeom.cols);
-			gpuGeom.bind();
 		}
 
 		ImGui::Checkbox("Cross Section", &showCrossSection);
 		if (showCrossSection && !previewingPart && !previewingPlant) {
 			int index = -1;
 
-			PointsData& crossSectionControlPoints = selectedPart.getCrossSectionControlPoints();
+			const PointsData& crossSectionControlPoints = viewedPart.getCrossSectionControlPoints();
 
 			for (int i = 0; i < crossSectionControlPoints.selected.size(); ++i) {
 				if (crossSectionControlPoints.selected.at(i)) {
@@ -395,26 +794,28 @@ void Scene::drawEditingImGui() {
 				bool weightChanged = ImGui::SliderFloat("Weight", &weight, 0.0f, 20.0f);
 
 				if (weightChanged) {
-					crossSectionControlPoints.weights.at(index) = weight;
-					std::vector<glm::vec3> crossSectionCurve = updateBSpline(crossSectionControlPoints);
+					PointsData& edited = selectedPart.getCrossSectionControlPoints();
+					edited.weights.at(index) = weight;
+					std::vector<glm::vec3> crossSectionCurve = updateBSpline(edited);
 					selectedPart.setCrossSectionCurve(crossSectionCurve);
 				}
 			}
 
 			if (crossSectionControlPoints.needsUpdate) {
-				selectedPart.setCrossSectionCurve(updateBSpline(crossSectionControlPoints));
-				crossSectionControlPoints.needsUpdate = false;
+				PointsData& edited = selectedPart.getCrossSectionControlPoints();
+				selectedPart.setCrossSectionCurve(updateBSpline(edited));
+				edited.needsUpdate = false;
 			}
 
-			handleEditingControlPointUpdate(crossSectionControlPoints);
+			if (cb->isLeftMouseDown() || cb->isRightMouseDown()) {
+				handleEditingControlPointUpdate(selectedPart.getCrossSectionControlPoints());
+			}
+			else {
+				controlPointIndex = -1;
+			}
 
 			showLeftCurve = false;
 			showRightCurve = false;
-
-			GPU_Geometry gpuGeom;
-			gpuGeom.setVerts(crossSectionControlPoints.cpuGeom.verts);
-			gpuGeom.setCols(crossSectionControlPoints.cpuGeom.cols);
-			gpuGeom.bind();
 		}
 
 
@@ -425,6 +826,7 @@ void Scene::drawEditingImGui() {
 		ImGui::DragFloat3("Rotation (degrees)", glm::value_ptr(selectedPart.getRotation()), 0.1f, -180.0f, 180.0f);
 
 		ImGui::ColorEdit3("Base Color", glm::value_ptr(selectedPart.getBaseColor()));
+		ImGui::Checkbox("Sweep previews on the GPU", &gpuSweepPreview);
 
 		if (ImGui::Button("Preview Part")) {
 			if (selectedPart.getLeftCurve().empty() || selectedPart.getRightCurve().empty() || selectedPart.getCrossSectionCurve().empty()) {
@@ -448,7 +850,7 @@ void Scene::drawEditingImGui() {
 
 		if (ImGui::Button("Preview Plant")) {
 
-			for (auto& part : plants[selectedPlantIndex].getParts()) {
+			for ([[maybe_unused]] PartHandle part : getSelectedPlant()->getParts()) {
 				if (selectedPart.getLeftCurve().empty() || selectedPart.getRightCurve().empty() || selectedPart.getCrossSectionCurve().empty()) {
 					std::cout << "Error: All three curves (left, right, cross-section) must be set before calculating the surface." << std::endl;
 					return;
@@ -468,8 +870,8 @@ void Scene::drawEditingImGui() {
 		}
 	}
 
-	if (selectedPlantIndex >= 0 && selectedPartIndex >= 0) {
-		auto& plant = plants[selectedPlantIndex];
+	if (getSelectedPart()) {
+		auto& plant = *getSelectedPlant();
 
 		if (previewingPart) {
 			if (ImGui::Button("Edit Surface")) {
@@ -477,6 +879,12 @@ void Scene::drawEditingImGui() {
 				previewingPart = false;
 				previewingPlant = false;
 			}
+
+			// Welded and capped, so the exported part is a closed mesh.
+			if (ImGui::Button("Export Part (OBJ)")) {
+				auto& part = *getSelectedPart();
+				part.exportOBJ(plant.getName() + "_" + part.getName() + ".obj", true);
+			}
 		}
 		else if (previewingPlant) {
 			if (ImGui::Button("Edit Surface")) {
@@ -544,8 +952,9 @@ void Scene::handleEditingControlPointUpdate(PointsData& cp) {
 		}
 	}
 	else if (cb->isLeftMouseDown()) {
-		assert(selectedPartIndex >= 0 && selectedPlantIndex >= 0);
-		auto& selectedPart = plants[selectedPlantIndex].getParts()[selectedPartIndex];
+		PlantPart* part = getSelectedPart();
+		assert(part);
+		auto& selectedPart = *part;
 
 		if (showLeftCurve) {
 			selectedPart.getLeftControlPoints().cpuGeom.verts.at(controlPointIndex) += 2.45f * cb->getDragOffset();
@@ -571,7 +980,7 @@ std::vector<glm::vec3> Scene::updateBSpline(PointsData& controlPoints) {
 	if (size > 1) {
 		int k = size == 2 ? 2 : 3;
 		int m = size - 1;
-		float uStep = 0.02f;
+		float uStep = PlantPart::CURVE_SAMPLE_STEP;
 
 		std::vector<double> knotSequence = getKnotSequence(k, m);
 
@@ -638,6 +1047,29 @@ glm::vec3 Scene::E_delta_1(const std::vector<glm::vec3>& ctrlPts, const std::vec
 }
 
 void Scene::updateScene() {
+	PROFILE_FRAME();
+	PROFILE_SCOPE("Scene::updateScene");
+	GLState::beginFrame();
+	overlayStream.beginFrame();
+	gpuProfiler.beginFrame();
+
+	// Install meshes finished since last frame, then start on anything edited
+	// since. Results land in a later frame instead of stalling this one.
+	if (meshBatcher.publish(plants)) {
+		requestRedraw(1);
+	}
+	meshBatcher.submit(plants);
+	// LOD chains follow in the background for meshes that lack one.
+	if (lodBuilder.publish(plants)) {
+		requestRedraw(1);
+	}
+	lodBuilder.submit(plants);
+	gpuMeshes.collect(plants);
+	gpuSweep.collect(plants);
+	population.collect(plants);
+	gpuMeshes.beginFrame();
+	gpuSweep.beginFrame();
+
 	if (!cb->isLeftMouseDown()) {
 		controlPointIndex = -1;
 	}
@@ -645,6 +1077,12 @@ void Scene::updateScene() {
 	if (lightingChange) {
 		shaders.at("default")->use();
 		cb->updateShadingUniforms(lightPos, lightCol, diffuseCol, ambientStrength, false);
+		shaders.at("instanced")->use();
+		cb->updateShadingUniforms(*shaders.at("instanced"), lightPos, lightCol, diffuseCol, ambientStrength, false);
+		shaders.at("impostor")->use();
+		cb->updateShadingUniforms(*shaders.at("impostor"), lightPos, lightCol, diffuseCol, ambientStrength, false);
+		shaders.at("sweep")->use();
+		cb->updateShadingUniforms(*shaders.at("sweep"), lightPos, lightCol, diffuseCol, ambientStrength, false);
 	}
 
 	if (modeChanged) {
@@ -652,6 +1090,13 @@ void Scene::updateScene() {
 		modeChanged = false;
 	}
 
+	// Picking below and everything drawn this frame read the camera from here.
+	cb->beginFrame();
+	if (cb->getFrameUploads() != lastCameraUploads) {
+		lastCameraUploads = cb->getFrameUploads();
+		requestRedraw(1);
+	}
+
 	if (comboSelection == 0) {
 		cb->setIs3D(true);
 		updateLandscapeState();
@@ -660,6 +1105,67 @@ void Scene::updateScene() {
 		if (previewingPlant || previewingPart) cb->setIs3D(true);
 		else cb->setIs3D(false);
 	}
+
+	// Only plants standing on the part of the terrain that changed move.
+	glm::vec2 dirtyLow, dirtyHigh;
+	if (landscape.takeDirtyRegion(dirtyLow, dirtyHigh)) {
+		lastResnapCount = population.resnap(landscape, dirtyLow, dirtyHigh);
+		staticBatch.clear();
+		requestRedraw(1);
+	}
+
+	if (staticBatch.isBaked() && staticBatch.isStale(plants)) {
+		Log::info("Plants changed since the static bake; drawing them live again");
+		staticBatch.clear();
+		requestRedraw(1);
+	}
+}
+
+void Scene::requestRedraw(int frames) {
+	redrawFrames = std::max(redrawFrames, frames);
+}
+
+bool Scene::needsRedraw() {
+	if (!onDemandRendering || redrawFrames > 0) {
+		return true;
+	}
+	// A held button keeps brushing or dragging even while the mouse is still.
+	if (cb->isLeftMouseDown()) {
+		return true;
+	}
+	// The wind animates the live population.
+	if (comboSelection == 0 && windSettings.enabled && !staticBatch.isBaked() && population.instanceCount() > 0) {
+		return true;
+	}
+	if (ImGui::GetIO().WantTextInput && glfwGetTime() - lastDrawTime >= CARET_BLINK_INTERVAL) {
+		return true;
+	}
+	updatesSkipped++;
+	return false;
+}
+
+double Scene::getIdleTimeout() const {
+	return hasBackgroundWork() ? BUSY_TIMEOUT : IDLE_TIMEOUT;
+}
+
+bool Scene::hasBackgroundWork() const {
+	return meshBatcher.isBusy() || lodBuilder.isBusy();
+}
+
+void Scene::setRenderTarget(GLuint framebuffer) {
+	renderTarget = framebuffer;
+	renderQueue.setTarget(framebuffer);
+	requestRedraw(1);
+}
+
+void Scene::setMode(int mode) {
+	if (mode < 0 || mode >= int(sizeof(options) / sizeof(options[0]))) {
+		Log::error("SCENE has no mode {}", mode);
+		throw std::runtime_error("Invalid scene mode!");
+	}
+	modeChanged |= mode != comboSelection;
+	comboSelection = mode;
+	requestRedraw(1);
 }
 
 void Scene::updateLandscapeState() {
@@ -676,151 +1182,193 @@ void Scene::updateLandscapeState() {
 }
 
 void Scene::draw() {
-	glEnable(GL_LINE_SMOOTH);
+	PROFILE_SCOPE("Scene::draw");
+	redrawFrames = std::max(redrawFrames - 1, 0);
+	lastDrawTime = glfwGetTime();
+	framesDrawn++;
+
+	GLState::bindFramebuffer(renderTarget);
+	GLState::setEnabled(GL_LINE_SMOOTH, true);
 	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	gpuProfiler.begin(gpuPasses.clear);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_DEPTH_TEST);
+	gpuProfiler.end();
+	GLState::setEnabled(GL_DEPTH_TEST, true);
 
 	// draw rest of the scene
-	glEnable(GL_FRAMEBUFFER_SRGB);
-	glPolygonMode(GL_FRONT_AND_BACK, (simpleWireframe ? GL_LINE : GL_FILL));
+	GLState::setEnabled(GL_FRAMEBUFFER_SRGB, true);
 
-	// draw scene
+	// draw scene; the functions below submit to the render queue, which
+	// runs everything at once in the order that changes the least state
 	if (comboSelection == 0) {
+		renderQueue.setPass(gpuPasses.controlPoints);
 		drawLandscapeControlPoints();
-		drawLandscape();
+		if (staticBatch.isBaked()) {
+			renderQueue.setPass(gpuPasses.staticBatch);
+			drawStaticScene();
+		}
+		else {
+			renderQueue.setPass(gpuPasses.terrain);
+			drawLandscape();
+			renderQueue.setPass(gpuPasses.population);
+			drawPopulation();
+		}
+		renderQueue.setPass(gpuPasses.axes);
 		drawAxes("controlPoint");
 	}
 	else if (comboSelection == 1) {
+		renderQueue.setPass(gpuPasses.preview);
 		previewPlants();
+		renderQueue.setPass(gpuPasses.controlPoints);
 		drawControlPoints();
+		renderQueue.setPass(gpuPasses.curves);
 		drawCurves();
+		renderQueue.setPass(gpuPasses.axes);
 		drawAxes("editing");
 	}
+	renderQueue.setPass(-1);
+	{
+		PROFILE_SCOPE("RenderQueue::execute");
+		renderQueue.execute();
+	}
+	overlayStream.endFrame();
 
 	// draw imgui
-	glDisable(GL_FRAMEBUFFER_SRGB);
-	drawImGui();
+	GLState::setEnabled(GL_FRAMEBUFFER_SRGB, false);
+	if (imguiEnabled) {
+		drawImGui();
+	}
+	gpuProfiler.endFrame();
 }
 
 void Scene::previewPlants() {
-	if (previewingPart) {
-		assert(selectedPartIndex >= 0 && selectedPlantIndex >= 0);
-		auto& selectedPart = plants[selectedPlantIndex].getParts()[selectedPartIndex];
-		if (!selectedPart.isSurfaceGenerated()) {
-			selectedPart.generatePlantPart();
+	// A part on its own is previewed at the origin; a plant's parts are
+	// placed.
+	auto submitPart = [this](PartHandle handle, bool placed) {
+		RenderQueue::State state;
+		state.polygonMode = GL_FILL;
+
+		if (gpuSweepPreview) {
+			state.program = shaders.at("sweep");
+			renderQueue.submit(state, FIRST_PART_MESH + handle.index, [this, handle, placed]() {
+				const PlantPart* part = plants.getPart(handle);
+				if (!part) {
+					return;
+				}
+				ShaderProgram& sweepShader = *shaders.at("sweep");
+				cb->viewPipelinePlantPreview(sweepShader, placed ? part->getPartTransformMatrix() : glm::mat4(1.0f));
+				gpuSweep.draw(handle, *part, sweepShader);
+			});
+			return;
 		}
 
-		// Draw the surface
-		shaders.at("default")->use();
-
-		GPU_Geometry gpuGeom;
-		gpuGeom.setVerts(selectedPart.getSurface());
-		gpuGeom.setCols(selectedPart.getCols());
-		gpuGeom.setIndices(selectedPart.getIndices());
-		gpuGeom.setNormals(selectedPart.getNormals());
-		gpuGeom.bind();
-
-		cb->viewPipeline();
-
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-		glDrawElements(GL_TRIANGLES, selectedPart.getIndices().size(), GL_UNSIGNED_INT, 0);
+		state.program = shaders.at("default");
+		renderQueue.submit(state, FIRST_PART_MESH + handle.index, [this, handle, placed]() {
+			// Binds the part's resident mesh, uploading only if it changed.
+			const PlantPart* part = plants.getPart(handle);
+			PackedGeometry* geometry = part ? gpuMeshes.acquire(handle, *part) : nullptr;
+			if (!geometry) {
+				return;
+			}
+			glm::mat4 M = placed ? part->getPartTransformMatrix() : glm::mat4(1.0f);
+			cb->viewPipelinePlantPreview(M * geometry->getDecode());
+			glDrawElements(GL_TRIANGLES, GLsizei(part->getCompactIndices().count()), part->getCompactIndices().type, 0);
+		});
+	};
 
+	if (previewingPart) {
+		assert(getSelectedPart());
+		submitPart(getSelectedPlant()->getParts()[selectedPartIndex], false);
 	}
 	else if (previewingPlant) {
-		assert(selectedPlantIndex >= 0);
-		auto& plant = plants[selectedPlantIndex];
-
-		for (auto& part : plant.getParts()) {
-			if (!part.isSurfaceGenerated()) {
-				part.generatePlantPart();
-			}
-
-			if (part.getSurface().size() == 0) {
-				continue;
-			}
-
-			shaders.at("default")->use();
+		Plant* plant = getSelectedPlant();
+		assert(plant);
 
-			GPU_Geometry gpuGeom;
-
-			gpuGeom.setVerts(part.getSurface());
-			gpuGeom.setCols(part.getCols());
-			gpuGeom.setIndices(part.getIndices());
-			gpuGeom.setNormals(part.getNormals());
-			gpuGeom.bind();
+		for (PartHandle handle : plant->getParts()) {
+			submitPart(handle, true);
+		}
+	}
+}
 
-			cb->viewPipelinePlantPreview(part.getPartTransformMatrix());
+Plant* Scene::getSelectedPlant() {
+	return plants.getPlant(plants.plantAt(selectedPlantIndex));
+}
 
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-			glDrawElements(GL_TRIANGLES, part.getIndices().size(), GL_UNSIGNED_INT, 0);
-		}
+PlantPart* Scene::getSelectedPart() {
+	Plant* plant = getSelectedPlant();
+	if (!plant || selectedPartIndex < 0 || selectedPartIndex >= static_cast<int>(plant->getParts().size())) {
+		return nullptr;
 	}
+	return plants.getPart(plant->getParts()[selectedPartIndex]);
 }
 
 void Scene::drawCurves() {
 
 	if (!previewingPlant && !previewingPart) {
-		if (selectedPlantIndex >= 0 && selectedPartIndex >= 0) {
-			auto& selectedPart = plants[selectedPlantIndex].getParts()[selectedPartIndex];
-
-			shaders.at("editing")->use();
-			cb->viewPipelineEditing(*shaders.at("editing"));
-
-			GPU_Geometry gpuGeom;
-
-			gpuGeom.setVerts(selectedPart.getLeftCurve());
-			gpuGeom.setCols(std::vector<glm::vec3>(selectedPart.getLeftCurve().size(), glm::vec3(1.0f, 0.0f, 0.0f)));
-			gpuGeom.bind();
-			glDrawArrays(GL_LINE_STRIP, 0, selectedPart.getLeftCurve().size());
-
-			gpuGeom.setVerts(selectedPart.getRightCurve());
-			gpuGeom.setCols(std::vector<glm::vec3>(selectedPart.getRightCurve().size(), glm::vec3(0.0f, 1.0f, 0.0f)));
-			gpuGeom.bind();
-			glDrawArrays(GL_LINE_STRIP, 0, selectedPart.getRightCurve().size());
-
-			gpuGeom.setVerts(selectedPart.getCrossSectionCurve());
-			gpuGeom.setCols(std::vector<glm::vec3>(selectedPart.getCrossSectionCurve().size(), glm::vec3(0.0f, 0.0f, 1.0f)));
-			gpuGeom.bind();
-			glDrawArrays(GL_LINE_STRIP, 0, selectedPart.getCrossSectionCurve().size());
+		if (getSelectedPart()) {
+			RenderQueue::State state;
+			state.program = shaders.at("editing");
+			renderQueue.submit(state, 0, [this]() {
+				const PlantPart& selectedPart = *getSelectedPart();
+
+				cb->viewPipelineEditing(*shaders.at("editing"));
+
+				GPU_Geometry& gpuGeom = overlayGeom;
+
+				gpuGeom.setVerts(selectedPart.getLeftCurve());
+				gpuGeom.setCols(std::vector<glm::vec3>(selectedPart.getLeftCurve().size(), glm::vec3(1.0f, 0.0f, 0.0f)));
+				gpuGeom.bind();
+				glDrawArrays(GL_LINE_STRIP, 0, GLsizei(selectedPart.getLeftCurve().size()));
+
+				gpuGeom.setVerts(selectedPart.getRightCurve());
+				gpuGeom.setCols(std::vector<glm::vec3>(selectedPart.getRightCurve().size(), glm::vec3(0.0f, 1.0f, 0.0f)));
+				gpuGeom.bind();
+				glDrawArrays(GL_LINE_STRIP, 0, GLsizei(selectedPart.getRightCurve().size()));
+
+				gpuGeom.setVerts(selectedPart.getCrossSectionCurve());
+				gpuGeom.setCols(std::vector<glm::vec3>(selectedPart.getCrossSectionCurve().size(), glm::vec3(0.0f, 0.0f, 1.0f)));
+				gpuGeom.bind();
+				glDrawArrays(GL_LINE_STRIP, 0, GLsizei(selectedPart.getCrossSectionCurve().size()));
+			});
 		}
 	}
 }
 
 void Scene::drawControlPoints() {
 	if (!previewingPlant && !previewingPart) {
-		if (selectedPlantIndex >= 0 && selectedPartIndex >= 0) {
-			auto& selectedPart = plants[selectedPlantIndex].getParts()[selectedPartIndex];
-
-			shaders.at("editing")->use();
-			cb->viewPipelineEditing(*shaders.at("editing"));
+		if (getSelectedPart()) {
+			RenderQueue::State state;
+			state.program = shaders.at("editing");
+			state.pointSize = 10.0f;
+			renderQueue.submit(state, 0, [this]() {
+				const PlantPart& selectedPart = *getSelectedPart();
 
-			CPU_Geometry cpuGeom;
-			GPU_Geometry gpuGeom;
+				cb->viewPipelineEditing(*shaders.at("editing"));
 
-			if (showLeftCurve) {
-				cpuGeom = selectedPart.getLeftControlPoints().cpuGeom;
+				CPU_Geometry cpuGeom;
+				GPU_Geometry& gpuGeom = overlayGeom;
 
-				gpuGeom.setVerts(cpuGeom.verts);
-				gpuGeom.setCols(std::vector<glm::vec3>(cpuGeom.verts.size(), glm::vec3(1.0f, 0.0f, 0.0f)));
+				if (showLeftCurve) {
+					cpuGeom = selectedPart.getLeftControlPoints().cpuGeom;
 
-			}
-			else if (showRightCurve) {
-				cpuGeom = selectedPart.getRightControlPoints().cpuGeom;
-				gpuGeom.setVerts(cpuGeom.verts);
-				gpuGeom.setCols(std::vector<glm::vec3>(cpuGeom.verts.size(), glm::vec3(1.0f, 0.0f, 0.0f)));
-			}
-			else if (showCrossSection) {
-				cpuGeom = selectedPart.getCrossSectionControlPoints().cpuGeom;
-				gpuGeom.setVerts(cpuGeom.verts);
-				gpuGeom.setCols(std::vector<glm::vec3>(cpuGeom.verts.size(), glm::vec3(1.0f, 0.0f, 0.0f)));
-			}
+					gpuGeom.setVerts(cpuGeom.verts);
+					gpuGeom.setCols(std::vector<glm::vec3>(cpuGeom.verts.size(), glm::vec3(1.0f, 0.0f, 0.0f)));
 
-			gpuGeom.bind();
-			glPointSize(10);
-			glDrawArrays(GL_POINTS, 0, cpuGeom.verts.size());
+				}
+				else if (showRightCurve) {
+					cpuGeom = selectedPart.getRightControlPoints().cpuGeom;
+					gpuGeom.setVerts(cpuGeom.verts);
+					gpuGeom.setCols(std::vector<glm::vec3>(cpuGeom.verts.size(), glm::vec3(1.0f, 0.0f, 0.0f)));
+				}
+				else if (showCrossSection) {
+					cpuGeom = selectedPart.getCrossSectionControlPoints().cpuGeom;
+					gpuGeom.setVerts(cpuGeom.verts);
+					gpuGeom.setCols(std::vector<glm::vec3>(cpuGeom.verts.size(), glm::vec3(1.0f, 0.0f, 0.0f)));
+				}
 
-			glDisable(GL_FRAMEBUFFER_SRGB); // disable sRGB for things like imgui
+				gpuGeom.bind();
+				glDrawArrays(GL_POINTS, 0, GLsizei(cpuGeom.verts.size()));
+			});
 		}
 	}
 }
@@ -828,43 +1376,143 @@ void Scene::drawControlPoints() {
 void Scene::drawAxes(const char* shaderType) {
 	if (!show3DAxes) return;
 
-	std::vector<glm::vec3> axisVerts = {
-		glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
-		glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
-		glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f)
-	};
-
-	std::vector<glm::vec3> axisColors = {
-		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
-		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
-		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f)
-	};
+	RenderQueue::State state;
+	state.program = shaders.at(shaderType);
+	state.lineWidth = 2.0f;
+	renderQueue.submit(state, 0, [this, shaderType]() {
+		std::vector<glm::vec3> axisVerts = {
+			glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+			glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f)
+		};
+
+		std::vector<glm::vec3> axisColors = {
+			glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f)
+		};
+
+		GPU_Geometry& axisGeom = overlayGeom;
+		axisGeom.setVerts(axisVerts);
+		axisGeom.setCols(axisColors);
+		axisGeom.bind();
+
+		if (strcmp(shaderType, "editing") == 0) {
+			cb->viewPipelineEditing(*shaders.at(shaderType));
+		}
+		else if (strcmp(shaderType, "controlPoints") == 0) {
+			cb->viewPipelineControlPoints(*shaders.at(shaderType));
+		}
 
-	GPU_Geometry axisGeom;
-	axisGeom.setVerts(axisVerts);
-	axisGeom.setCols(axisColors);
-	axisGeom.bind();
+		glDrawArrays(GL_LINES, 0, GLsizei(axisVerts.size()));
+	});
+}
 
-	shaders.at(shaderType)->use();
-	if (strcmp(shaderType, "editing") == 0) {
-		cb->viewPipelineEditing(*shaders.at(shaderType));
-	}
-	else if (strcmp(shaderType, "controlPoints") == 0) {
-		cb->viewPipelineControlPoints(*shaders.at(shaderType));
-	}
+void Scene::drawLandscape() {
+	const char* shaderName = landscape.getRenderMode() == Surface::RenderMode::HEIGHT_MAP ? "terrain" : "controlPoint";
+
+	RenderQueue::State state;
+	state.program = shaders.at(shaderName);
+	state.polygonMode = GL_LINE;
+	renderQueue.submit(state, TERRAIN_MESH, [this, shaderName]() {
+		ShaderProgram& sp = *shaders.at(shaderName);
+		cb->viewPipelineControlPoints(sp);
+		glUniform1i(sp.uniform("heightMap"), 0);
+
+		landscape.bind();
+		if (!cullingEnabled) {
+			terrainChunksDrawn = landscape.getChunks().size();
+			landscape.draw(0, GLsizei(landscape.numVerts()));
+			return;
+		}
 
+		// Chunks are stored one after another, so neighbouring visible chunks
+		// are drawn as one range.
+		Frustum frustum(cb->getViewProjection());
+		terrainChunksDrawn = 0;
+		GLint first = 0;
+		GLsizei count = 0;
+		for (const Surface::Chunk& chunk : landscape.getChunks()) {
+			if (frustum.test(chunk.bounds) == Frustum::OUTSIDE) {
+				continue;
+			}
+			terrainChunksDrawn++;
+			if (count > 0 && first + count == chunk.first) {
+				count += chunk.count;
+				continue;
+			}
+			if (count > 0) {
+				landscape.draw(first, count);
+			}
+			first = chunk.first;
+			count = chunk.count;
+		}
+		if (count > 0) {
+			landscape.draw(first, count);
+		}
+	});
+}
 
-	glLineWidth(2.0f);
-	glDrawArrays(GL_LINES, 0, axisVerts.size());
+void Scene::drawStaticScene() {
+	staticCellsDrawn = 0;
+
+	RenderQueue::State terrain;
+	terrain.program = shaders.at("controlPoint");
+	terrain.polygonMode = GL_LINE;
+	renderQueue.submit(terrain, STATIC_BATCH_MESH, [this]() {
+		Frustum frustum(cb->getViewProjection());
+		cb->viewPipelinePlantPreview(*shaders.at("controlPoint"), staticBatch.getDecode());
+		staticBatch.draw(StaticBatch::TERRAIN, cullingEnabled ? &frustum : nullptr);
+		staticCellsDrawn += staticBatch.getLastCellsDrawn();
+	});
+
+	RenderQueue::State plantState;
+	plantState.program = shaders.at("default");
+	plantState.polygonMode = simpleWireframe ? GL_LINE : GL_FILL;
+	renderQueue.submit(plantState, STATIC_BATCH_MESH, [this]() {
+		Frustum frustum(cb->getViewProjection());
+		cb->viewPipelinePlantPreview(staticBatch.getDecode());
+		staticBatch.draw(StaticBatch::PLANTS, cullingEnabled ? &frustum : nullptr);
+		staticCellsDrawn += staticBatch.getLastCellsDrawn();
+	});
 }
 
-void Scene::drawLandscape() {
-	shaders.at("controlPoint")->use();
-	cb->viewPipelineControlPoints(*shaders.at("controlPoint"));
+void Scene::drawPopulation() {
+	if (population.instanceCount() == 0) {
+		return;
+	}
 
-	landscape.bind();
-	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	glDrawArrays(GL_TRIANGLES, 0, landscape.numVerts());
+	// The terrain hides plants behind hills even though it is drawn as a
+	// wireframe.
+	glm::mat4 viewProjection = cb->getViewProjection();
+	if (cullingEnabled && occlusionCulling) {
+		terrainDepth.begin(viewProjection);
+		terrainDepth.rasterize(landscape.getTriangles());
+	}
+	population.setWind(windSettings);
+	PlantPopulation::View view{ viewProjection, cb->getCameraPos(), cb->getPixelsPerUnit() };
+	population.cull(plants, view, cullingEnabled, impostorSettings, lodSettings,
+		(cullingEnabled && occlusionCulling) ? &terrainDepth : nullptr);
+
+	// Bakes render offscreen, so they go before anything is set up here.
+	population.bakeImpostors(plants, gpuMeshes, *shaders.at("impostorBake"));
+
+	RenderQueue::State state;
+	state.polygonMode = simpleWireframe ? GL_LINE : GL_FILL;
+
+	state.program = shaders.at("instanced");
+	renderQueue.submit(state, 0, [this]() {
+		ShaderProgram& shader = *shaders.at("instanced");
+		cb->viewPipelineInstanced(shader);
+		population.draw(plants, gpuMeshes, shader, float(glfwGetTime()));
+	});
+
+	state.program = shaders.at("impostor");
+	renderQueue.submit(state, 0, [this]() {
+		ShaderProgram& impostorShader = *shaders.at("impostor");
+		cb->viewPipelineInstanced(impostorShader);
+		population.drawImpostors(plants, impostorShader);
+	});
 }
 
 void Scene::drawLandscapeControlPoints() {
@@ -872,27 +1520,31 @@ void Scene::drawLandscapeControlPoints() {
 		return;
 	}
 
-	shaders.at("controlPoint")->use();  
-	cb->viewPipelineControlPoints(*shaders.at("controlPoint"));  
+	RenderQueue::State state;
+	state.program = shaders.at("controlPoint");
+	state.pointSize = 10.0f;
+	renderQueue.submit(state, 0, [this]() {
+		cb->viewPipelineControlPoints(*shaders.at("controlPoint"));
 
-	GPU_Geometry controlPointsGPU;  
+		GPU_Geometry& controlPointsGPU = overlayGeom;
 
-	std::vector<std::vector<glm::vec3>> cp = landscape.getControlGrid();  
+		std::vector<std::vector<glm::vec3>> cp = landscape.getControlGrid();
 
-	std::vector<glm::vec3> flattenedControlPoints;  
-	for (const auto& row : cp) {  
-		flattenedControlPoints.insert(flattenedControlPoints.end(), row.begin(), row.end());  
-	}  
+		std::vector<glm::vec3> flattenedControlPoints;
+		for (const auto& row : cp) {
+			flattenedControlPoints.insert(flattenedControlPoints.end(), row.begin(), row.end());
+		}
 
-	controlPointsGPU.setVerts(flattenedControlPoints);  
-	controlPointsGPU.setCols(std::vector<glm::vec3>(flattenedControlPoints.size(), glm::vec3(1.0f, 0.0f, 0.0f)));  
-	controlPointsGPU.bind();  
+		controlPointsGPU.setVerts(flattenedControlPoints);
+		controlPointsGPU.setCols(std::vector<glm::vec3>(flattenedControlPoints.size(), glm::vec3(1.0f, 0.0f, 0.0f)));
+		controlPointsGPU.bind();
 
-	glPointSize(10);  
-	glDrawArrays(GL_POINTS, 0, flattenedControlPoints.size());  
+		glDrawArrays(GL_POINTS, 0, GLsizei(flattenedControlPoints.size()));
+	});
 }
 
 void Scene::applyBrushDeformation() {
+	PROFILE_SCOPE("Scene::applyBrushDeformation");
 	/*static float brushRadius = 1.5f;
 	static float brushStrength = 0.1f;
 	static float noiseScale = 0.5f;
@@ -12,10 +12,24 @@
 #include "Surface.h"
 #include "Plant.h"
 #include "PlantPart.h"
+#include "PlantMeshBatcher.h"
+#include "PlantMeshCache.h"
+#include "PlantLodBuilder.h"
+#include "PlantStore.h"
+#include "PlantPartGPUCache.h"
+#include "GPUSweep.h"
+#include "PlantPopulation.h"
+#include "Scatter.h"
+#include "StaticBatch.h"
+#include "RenderQueue.h"
+#include "StreamBuffer.h"
+#include "DepthRaster.h"
+#include "GPUProfiler.h"
 
 #include <unordered_map>
 #include <iostream>
 #include <string.h>
+#include <chrono>
 
 
 class Scene {
@@ -34,6 +48,8 @@ public:
 		, cb(callbacks)
 		, pickerTex(0, GL_R32I, window_.getFramebufferSize().x, window_.getFramebufferSize().y, GL_RED_INTEGER, GL_INT, GL_NEAREST)
 		, landscape(10, 3, 3, 20, 20)
+		, meshBatcher(meshCache)
+		, lodBuilder(meshCache)
 	{
 		initialize();
 		initializeGpuPicking();
@@ -43,6 +59,30 @@ public:
 
 	void draw();
 
+	// On-demand drawing. updateScene() notes anything that could change the
+	// picture; while nothing has, needsRedraw() is false and the main loop
+	// waits for events rather than drawing the same frame again.
+	//
+	// ImGui only reacts to input on the frame after it, and may take a
+	// couple more to settle, so input asks for several frames.
+	static const int INPUT_REDRAW_FRAMES = 3;
+	void requestRedraw(int frames = INPUT_REDRAW_FRAMES);
+	bool needsRedraw();
+	// How long the main loop may wait for events before calling
+	// updateScene() again: shorter while background work may land.
+	double getIdleTimeout() const;
+	// Whether meshes or LOD chains are still being built in the background.
+	bool hasBackgroundWork() const;
+
+	// Offscreen drawing, for the headless mode. draw() clears and draws
+	// into framebuffer (0 for the window) and leaves ImGui out if told to.
+	// Mode 0 is the landscape, 1 plant editing.
+	void setRenderTarget(GLuint framebuffer);
+	void setImGuiEnabled(bool enabled) { imguiEnabled = enabled; }
+	void setMode(int mode);
+
+	const GPUProfiler& getGPUProfiler() const { return gpuProfiler; }
+
 
 private:
 	Window& window;
@@ -58,7 +98,27 @@ private:
 	int pickerClearValue[4] = { 0, 0, 0, 0 };
 
 	Surface landscape;
-	std::vector<Plant> plants;
+	PlantStore plants;
+	PlantMeshCache meshCache;
+	PlantMeshBatcher meshBatcher;
+	PlantLodBuilder lodBuilder;
+	PlantPartGPUCache gpuMeshes;
+	GPUSweep gpuSweep;
+	PlantPopulation population;
+	StaticBatch staticBatch;
+	// This frame's draws; filled by the draw*() functions and run in draw().
+	RenderQueue renderQueue;
+	// The overlays (control points, curves, axes) are rebuilt every time
+	// they are drawn, so their vertices go through a ring buffer rather
+	// than buffers of their own.
+	StreamBuffer overlayStream;
+	GPU_Geometry overlayGeom;
+	// GPU time per pass. The queue tags each submission with the pass that
+	// was current when it was made; see RenderQueue::setPass().
+	GPUProfiler gpuProfiler;
+	struct GPUPasses {
+		int clear, picking, terrain, population, staticBatch, controlPoints, preview, curves, axes, imgui;
+	} gpuPasses;
 	// __________________________________________________________________
 	// __________________________________________________________________
 
@@ -73,7 +133,16 @@ private:
 	void drawLandscapeControlPoints();
 	void updateLandscapeState();
 	void drawEditingImGui();
+	void drawGPUResidencyImGui();
+	void drawGPUProfilerImGui();
+	void drawProfilerImGui();
+	void drawPopulationImGui();
+	void scatterPopulation();
+	void drawPopulation();
+	void drawStaticScene();
 	void previewPlants();
+	Plant* getSelectedPlant();
+	PlantPart* getSelectedPart();
 	std::vector<glm::vec3> updateBSpline(PointsData& controlPoints);
 	glm::vec3 E_delta_1(const std::vector<glm::vec3>& ctrlPts, const std::vector<float>& weights, const std::vector<double>& U, float u, int k, int m);
 	std::vector<double> getKnotSequence(int k, int m);
@@ -90,8 +159,26 @@ private:
 	bool isDrawingLandscape = false;
 	bool lightingChange = false;
 	bool show3DAxes = false;
+	bool showGPUResidency = false;
+	bool showGPUProfiler = false;
+	bool showProfiler = false;
+	// Frames the CPU flame view spans, and how the last trace export went.
+	int profilerFrames = 5;
+	std::string traceStatus;
 	int controlPointIndex = -1;
 
+	// Where draw() draws, and whether the UI goes on top.
+	GLuint renderTarget = 0;
+	bool imguiEnabled = true;
+
+	// on-demand drawing
+	bool onDemandRendering = true;
+	int redrawFrames = INPUT_REDRAW_FRAMES;
+	size_t lastCameraUploads = 0;
+	double lastDrawTime = 0.0;
+	size_t framesDrawn = 0;
+	size_t updatesSkipped = 0;
+
 	float brushRadius = 1.5f;
 	float brushStrength = 0.1f;
 	float noiseScale = 0.5f;
@@ -99,11 +186,34 @@ private:
 	bool brushRaise = true;
 	bool brushEnabled = false;
 
+	// population
+	std::vector<PlantHandle> scatterPlants;
+	Scatter::Settings scatterSettings;
+	size_t lastScatterCount = 0;
+	double lastScatterMs = 0.0;
+	float scatterSlopeAlignment = 0.0f;
+	size_t lastResnapCount = 0;
+
+	// culling
+	bool cullingEnabled = true;
+	bool occlusionCulling = true;
+	DepthRaster terrainDepth;
+	size_t terrainChunksDrawn = 0;
+	PlantPopulation::ImpostorSettings impostorSettings;
+	PlantPopulation::LodSettings lodSettings;
+	PlantPopulation::WindSettings windSettings;
+	size_t staticCellsDrawn = 0;
+	// Wind direction in radians about the y axis, from +x.
+	float windAngle = 0.0f;
+
 	// editing
 	int selectedPlantIndex = -1;
 	int selectedPartIndex = -1;
 	bool previewingPart = false;
 	bool previewingPlant = false;
+	// Previews sweep the curves on the GPU instead of drawing the generated
+	// meshes, so edits show without waiting for the mesh batcher.
+	bool gpuSweepPreview = true;
 	bool showControlPoints = false;
 
 	bool showLeftCurve = false;
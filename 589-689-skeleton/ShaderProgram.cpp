@@ -1,9 +1,13 @@
 #include "ShaderProgram.h"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <vector>
 
+#include <glm/gtc/type_ptr.hpp>
+
+#include "FrameUniforms.h"
 #include "Log.h"
 
 
@@ -20,6 +24,16 @@ ShaderProgram::ShaderProgram(const std::string& vertexPath, const std::string& f
 		glDeleteProgram(programID);
 		throw std::runtime_error("Shaders did not link.");
 	}
+	cacheUniforms();
+}
+
+
+void ShaderProgram::setModel(const glm::mat4& M) const {
+	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(M));
+	if (normalMatrixLoc != -1) {
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(M)));
+		glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+	}
 }
 
 bool ShaderProgram::recompile() {
@@ -42,6 +56,46 @@ void attach(ShaderProgram& sp, Shader& s) {
 }
 
 
+void ShaderProgram::cacheUniforms() {
+	uniforms.clear();
+
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> name(std::max(maxLength, 1));
+
+	for (GLint i = 0; i < count; ++i) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(programID, GLuint(i), GLsizei(name.size()), &length, &size, &type, name.data());
+		std::string uniformName(name.data(), length);
+
+		// Members of uniform blocks have no location.
+		GLint location = glGetUniformLocation(programID, uniformName.c_str());
+		if (location == -1) {
+			continue;
+		}
+		uniforms[uniformName] = location;
+
+		// Arrays are listed as "name[0]"; make "name" work too.
+		size_t bracket = uniformName.find('[');
+		if (bracket != std::string::npos) {
+			uniforms[uniformName.substr(0, bracket)] = location;
+		}
+	}
+
+	modelLoc = uniform("M");
+	normalMatrixLoc = uniform("normalMatrix");
+
+	GLuint frameBlock = glGetUniformBlockIndex(programID, "Frame");
+	if (frameBlock != GL_INVALID_INDEX) {
+		glUniformBlockBinding(programID, frameBlock, FrameUniforms::BINDING);
+	}
+}
+
+
 bool ShaderProgram::checkAndLogLinkSuccess() const {
 
 	GLint success;
@@ -3,10 +3,13 @@
 #include "Shader.h"
 
 #include "GLHandles.h"
+#include "GLState.h"
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
 #include <string>
+#include <unordered_map>
 
 
 class ShaderProgram {
@@ -23,7 +26,7 @@ public:
 
 	// Public interface
 	bool recompile();
-	void use() const { glUseProgram(programID); }
+	void use() const { GLState::useProgram(programID); }
 
 	void friend attach(ShaderProgram& sp, Shader& s);
 
@@ -31,11 +34,31 @@ public:
 		return programID;
 	}
 
+	// Location of an active uniform, looked up in a table filled when the
+	// program is linked (and so refreshed by recompile()). -1 if the program
+	// has no such uniform, which glUniform* calls ignore.
+	GLint uniform(const std::string& name) const {
+		auto it = uniforms.find(name);
+		return it != uniforms.end() ? it->second : -1;
+	}
+
+	// Sets M and, if the program has it, normalMatrix (M's inverse
+	// transpose), so vertex shaders need not invert M per vertex. The
+	// program must be in use.
+	void setModel(const glm::mat4& M) const;
+
 private:
 	ShaderProgramHandle programID;
 
 	Shader vertex;
 	Shader fragment;
 
+	std::unordered_map<std::string, GLint> uniforms;
+	GLint modelLoc = -1;
+	GLint normalMatrixLoc = -1;
+
 	bool checkAndLogLinkSuccess() const;
+	// Fills the uniform table and binds the Frame block, if declared, to
+	// FrameUniforms::BINDING.
+	void cacheUniforms();
 };
@@ -0,0 +1,73 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Uniform spatial hash over the XZ plane. Items are plain indices bucketed by
+// the cell their position falls in; only occupied cells take any memory.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class SpatialHash {
+
+public:
+	explicit SpatialHash(float cellSize = 0.5f) : cellSize(cellSize) {}
+
+	void clear() { cells.clear(); }
+
+	void insert(uint32_t item, glm::vec2 xz) {
+		cells[keyOf(cellOf(xz.x), cellOf(xz.y))].push_back(item);
+	}
+
+	// Inserts item into every cell overlapping [low, high], for items with
+	// an extent rather than a position.
+	void insert(uint32_t item, glm::vec2 low, glm::vec2 high) {
+		for (int32_t z = cellOf(low.y); z <= cellOf(high.y); ++z) {
+			for (int32_t x = cellOf(low.x); x <= cellOf(high.x); ++x) {
+				cells[keyOf(x, z)].push_back(item);
+			}
+		}
+	}
+
+	// Calls fn(item) for every item in a cell overlapping [low, high]. Items
+	// near the edges of those cells may lie slightly outside the box.
+	template <typename F>
+	void query(glm::vec2 low, glm::vec2 high, F&& fn) const {
+		int32_t x0 = cellOf(low.x), x1 = cellOf(high.x);
+		int32_t z0 = cellOf(low.y), z1 = cellOf(high.y);
+
+		// A huge box over a sparse hash is cheaper to answer by walking the cells.
+		if (int64_t(x1 - x0 + 1) * (z1 - z0 + 1) > int64_t(cells.size())) {
+			for (auto& cell : cells) {
+				int32_t x = int32_t(cell.first >> 32), z = int32_t(uint32_t(cell.first));
+				if (x >= x0 && x <= x1 && z >= z0 && z <= z1) {
+					for (uint32_t item : cell.second) fn(item);
+				}
+			}
+			return;
+		}
+
+		for (int32_t z = z0; z <= z1; ++z) {
+			for (int32_t x = x0; x <= x1; ++x) {
+				auto it = cells.find(keyOf(x, z));
+				if (it != cells.end()) {
+					for (uint32_t item : it->second) fn(item);
+				}
+			}
+		}
+	}
+
+	float getCellSize() const { return cellSize; }
+	size_t cellCount() const { return cells.size(); }
+
+private:
+	int32_t cellOf(float v) const { return int32_t(std::floor(v / cellSize)); }
+	static uint64_t keyOf(int32_t x, int32_t z) { return (uint64_t(uint32_t(x)) << 32) | uint32_t(z); }
+
+	float cellSize;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+};
@@ -0,0 +1,206 @@
+#include "StaticBatch.h"
+
+#include "GLState.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+
+
+namespace {
+
+// What goes into one cell before it is laid out.
+struct CellContents {
+	// One (index into bakedParts, instance) pair per part of each copy.
+	std::vector<std::pair<size_t, const PlantInstance*>> copies;
+	// Index of the first vertex of each terrain triangle.
+	std::vector<size_t> triangles;
+};
+
+}
+
+
+void StaticBatch::bake(PlantStore& plants, const PlantPopulation& population, const Surface& terrain, float cellSize) {
+	auto start = std::chrono::steady_clock::now();
+	clear();
+
+	auto cellOf = [cellSize](const glm::vec3& p) {
+		return std::make_pair(int(std::floor(p.x / cellSize)), int(std::floor(p.z / cellSize)));
+	};
+	// Ordered so the layout, and hence the buffers, are the same every bake.
+	std::map<std::pair<int, int>, CellContents> contents;
+
+	for (PlantHandle handle : plants.getPlantOrder()) {
+		const Plant* plant = plants.getPlant(handle);
+		const std::vector<PlantInstance>* instances = population.find(handle);
+		if (!plant || !instances || instances->empty()) {
+			continue;
+		}
+
+		size_t firstPart = bakedParts.size();
+		for (PartHandle partHandle : plant->getParts()) {
+			const PlantPart* part = plants.getPart(partHandle);
+			if (part && !part->getMesh()->surface.empty()) {
+				bakedParts.push_back(BakedPart{ handle, partHandle, part->getMesh(), plant->getModelMatrix() * part->getPartTransformMatrix() });
+			}
+		}
+
+		// A copy stays whole in the cell its origin is in.
+		for (const PlantInstance& instance : *instances) {
+			CellContents& cell = contents[cellOf(glm::vec3(instance.transform[3]))];
+			for (size_t p = firstPart; p < bakedParts.size(); ++p) {
+				cell.copies.emplace_back(p, &instance);
+			}
+		}
+	}
+
+	const std::vector<glm::vec3>& terrainTriangles = terrain.getTriangles();
+	for (size_t t = 0; t + 2 < terrainTriangles.size(); t += 3) {
+		glm::vec3 centroid = (terrainTriangles[t] + terrainTriangles[t + 1] + terrainTriangles[t + 2]) / 3.0f;
+		contents[cellOf(centroid)].triangles.push_back(t);
+	}
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec3> colors;
+	std::vector<uint32_t> indices;
+	for (auto& entry : contents) {
+		const CellContents& source = entry.second;
+		Cell cell;
+		cell.baseVertex = GLint(positions.size());
+
+		cell.plantFirst = sizeof(uint32_t) * indices.size();
+		for (const auto& copy : source.copies) {
+			const BakedPart& part = bakedParts[copy.first];
+			const PlantPartMesh& mesh = *part.mesh;
+			glm::mat4 model = copy.second->transform * part.local;
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+			glm::vec3 tint = glm::vec3(copy.second->tint);
+
+			uint32_t first = uint32_t(positions.size() - cell.baseVertex);
+			for (size_t v = 0; v < mesh.surface.size(); ++v) {
+				positions.push_back(glm::vec3(model * glm::vec4(mesh.surface[v], 1.0f)));
+				normals.push_back(v < mesh.normals.size() ? glm::normalize(normalMatrix * mesh.normals[v]) : glm::vec3(0.0f, 1.0f, 0.0f));
+				colors.push_back((v < mesh.cols.size() ? mesh.cols[v] : glm::vec3(1.0f)) * tint);
+				cell.bounds.expand(positions.back());
+			}
+			for (unsigned int index : mesh.indices) {
+				indices.push_back(first + index);
+			}
+		}
+		cell.plantCount = GLsizei(indices.size() - cell.plantFirst / sizeof(uint32_t));
+
+		// The terrain's own buffer has no colours, so it draws black.
+		cell.terrainFirst = sizeof(uint32_t) * indices.size();
+		for (size_t t : source.triangles) {
+			const glm::vec3* corners = &terrainTriangles[t];
+			glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+			for (int k = 0; k < 3; ++k) {
+				indices.push_back(uint32_t(positions.size() - cell.baseVertex));
+				positions.push_back(corners[k]);
+				normals.push_back(normal);
+				colors.push_back(glm::vec3(0.0f));
+				cell.bounds.expand(corners[k]);
+			}
+		}
+		cell.terrainCount = GLsizei(indices.size() - cell.terrainFirst / sizeof(uint32_t));
+
+		cells.push_back(cell);
+	}
+
+	if (positions.empty()) {
+		bakedParts.clear();
+		cells.clear();
+		return;
+	}
+
+	vertexArray = std::make_unique<VertexArray>();
+	vertexArray->bind();
+
+	// The same locations as test.vert and controlPoints.vert read. Every
+	// vertex has its own colour, so none is left as a constant.
+	PackedVertices packed = PackedVertices::pack(positions, normals, {}, colors, PackedVertices::Options());
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, packed.bytes.size(), packed.bytes.data(), GL_STATIC_DRAW);
+	packed.layout.apply(vertexBuffer);
+	decode = packed.decode;
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	GLState::bindVertexArray(0);
+
+	stats.cells = cells.size();
+	stats.vertices = positions.size();
+	stats.triangles = indices.size() / 3;
+	stats.bytes = packed.bytes.size() + sizeof(uint32_t) * indices.size();
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	Log::info("Baked {} triangles into {} cells ({:.1f} MB) in {:.1f} ms", stats.triangles, stats.cells, static_cast<double>(stats.bytes) / (1024.0 * 1024.0), stats.ms);
+}
+
+
+void StaticBatch::clear() {
+	if (vertexArray) {
+		// Releases the storage; the handles themselves are reused.
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+	}
+	vertexArray.reset();
+	decode = glm::mat4(1.0f);
+	cells.clear();
+	bakedParts.clear();
+	stats = Stats();
+	lastDrawCalls = 0;
+	lastCellsDrawn = 0;
+}
+
+
+bool StaticBatch::isStale(PlantStore& plants) const {
+	for (const BakedPart& baked : bakedParts) {
+		const Plant* plant = plants.getPlant(baked.plant);
+		const PlantPart* part = plants.getPart(baked.part);
+		if (!plant || !part || part->getMesh() != baked.mesh
+			|| plant->getModelMatrix() * part->getPartTransformMatrix() != baked.local) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void StaticBatch::draw(Layer layer, const Frustum* frustum) {
+	lastDrawCalls = 0;
+	lastCellsDrawn = 0;
+	if (!vertexArray) {
+		return;
+	}
+
+	drawCounts.clear();
+	drawOffsets.clear();
+	drawBaseVertices.clear();
+	for (const Cell& cell : cells) {
+		GLsizei count = layer == PLANTS ? cell.plantCount : cell.terrainCount;
+		if (count == 0 || (frustum && frustum->test(cell.bounds) == Frustum::OUTSIDE)) {
+			continue;
+		}
+		drawCounts.push_back(count);
+		drawOffsets.push_back((const void*)(layer == PLANTS ? cell.plantFirst : cell.terrainFirst));
+		drawBaseVertices.push_back(cell.baseVertex);
+	}
+	if (drawCounts.empty()) {
+		return;
+	}
+
+	vertexArray->bind();
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), GLsizei(drawCounts.size()), drawBaseVertices.data());
+
+	lastDrawCalls = 1;
+	lastCellsDrawn = drawCounts.size();
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A finished scene merged into a few large buffers, drawn with a constant
+// number of calls.
+//
+// bake() copies every part of every plant copy in the population, transformed
+// to world space and tinted, together with the terrain into one vertex buffer
+// and one index buffer. Geometry is split into square XZ cells; within a cell
+// the plant and terrain triangles are separate index ranges, since the two are
+// drawn with different shaders. draw() tests each cell against the frustum and
+// draws one layer of all visible cells with a single
+// glMultiDrawElementsBaseVertex, so the number of calls no longer depends on
+// how many parts, copies or chunks the scene has. Vertices are packed as
+// PackedVertices, relative to the bounds of the whole bake.
+//
+// The bake is a snapshot. Copies drawn from it do not sway in the wind or
+// switch to LODs and impostors, and edits to the plants, population or
+// terrain are not seen until it is baked again.
+//------------------------------------------------------------------------------
+
+#include "Bounds.h"
+#include "GLHandles.h"
+#include "Geometry.h"
+#include "PlantPopulation.h"
+#include "PlantStore.h"
+#include "Surface.h"
+#include "VertexArray.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+class StaticBatch {
+
+public:
+	enum Layer { PLANTS, TERRAIN };
+
+	struct Stats {
+		size_t cells = 0;
+		size_t vertices = 0;
+		size_t triangles = 0;
+		size_t bytes = 0;
+		double ms = 0.0;
+	};
+
+	// Replaces any previous bake. cellSize is the side of a cell in world
+	// units.
+	void bake(PlantStore& plants, const PlantPopulation& population, const Surface& terrain, float cellSize = 4.0f);
+	void clear();
+
+	bool isBaked() const { return vertexArray != nullptr; }
+
+	// True if a baked plant's parts have changed, moved or gone since the
+	// bake.
+	bool isStale(PlantStore& plants) const;
+
+	// Draws layer of the cells inside frustum, or of every cell if frustum
+	// is null. The layer's shader must be in use with M set to getDecode().
+	void draw(Layer layer, const Frustum* frustum);
+
+	// Takes the packed vertices back to world space.
+	const glm::mat4& getDecode() const { return decode; }
+
+	const Stats& getStats() const { return stats; }
+	size_t getLastDrawCalls() const { return lastDrawCalls; }
+	size_t getLastCellsDrawn() const { return lastCellsDrawn; }
+
+private:
+	struct Cell {
+		AABB bounds;
+		// Indices relative to baseVertex; the ranges are in bytes of the
+		// index buffer.
+		GLint baseVertex = 0;
+		size_t plantFirst = 0;
+		GLsizei plantCount = 0;
+		size_t terrainFirst = 0;
+		GLsizei terrainCount = 0;
+	};
+
+	// What the bake was made from, for isStale().
+	struct BakedPart {
+		PlantHandle plant;
+		PartHandle part;
+		std::shared_ptr<const PlantPartMesh> mesh;
+		glm::mat4 local;
+	};
+
+	std::vector<Cell> cells;
+	std::vector<BakedPart> bakedParts;
+
+	std::unique_ptr<VertexArray> vertexArray;
+	VertexBufferHandle vertexBuffer;
+	VertexBufferHandle indexBuffer;
+	glm::mat4 decode = glm::mat4(1.0f);
+
+	// Scratch space for draw(), kept to avoid reallocating every frame.
+	std::vector<GLsizei> drawCounts;
+	std::vector<const void*> drawOffsets;
+	std::vector<GLint> drawBaseVertices;
+
+	Stats stats;
+	size_t lastDrawCalls = 0;
+	size_t lastCellsDrawn = 0;
+};
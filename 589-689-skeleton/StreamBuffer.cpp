@@ -0,0 +1,177 @@
+#include "StreamBuffer.h"
+
+#include "Log.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <cstring>
+
+
+namespace {
+
+// From GL 4.4 / ARB_buffer_storage, which the GL 3.3 headers lack.
+typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+const GLbitfield MAP_PERSISTENT_BIT = 0x0040;
+const GLbitfield MAP_COHERENT_BIT = 0x0080;
+
+// How long beginFrame() waits for a region at a time, in nanoseconds.
+const GLuint64 WAIT_TIMEOUT = 100000000;
+
+bool bufferStorageSupported() {
+	GLint major = 0;
+	GLint minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major > 4 || (major == 4 && minor >= 4)) {
+		return true;
+	}
+
+	GLint extensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+	for (GLint i = 0; i < extensions; ++i) {
+		const char* name = (const char*)glGetStringi(GL_EXTENSIONS, GLuint(i));
+		if (name && std::strcmp(name, "GL_ARB_buffer_storage") == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+}
+
+
+StreamBuffer::StreamBuffer(GLsizeiptr regionSize_, Mode preferred)
+	: regionSize(regionSize_)
+{
+	if (preferred == Mode::PERSISTENT && createPersistent()) {
+		mode = Mode::PERSISTENT;
+	}
+	else {
+		mode = preferred == Mode::ORPHANING ? Mode::ORPHANING : Mode::UNSYNCHRONIZED;
+		// Orphaning gets a fresh buffer from the driver every frame, so one
+		// region is enough.
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, mode == Mode::ORPHANING ? regionSize : regionSize * REGIONS, nullptr, GL_STREAM_DRAW);
+	}
+	Log::info("Streaming dynamic geometry in {} mode ({} KB per frame)", modeName(mode), regionSize / 1024);
+}
+
+
+StreamBuffer::~StreamBuffer() {
+	for (GLsync& fence : fences) {
+		if (fence) {
+			glDeleteSync(fence);
+		}
+	}
+	if (mapped) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+}
+
+
+bool StreamBuffer::createPersistent() {
+	if (!bufferStorageSupported()) {
+		return false;
+	}
+	BufferStorageProc bufferStorage = (BufferStorageProc)glfwGetProcAddress("glBufferStorage");
+	if (!bufferStorage) {
+		return false;
+	}
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | MAP_PERSISTENT_BIT | MAP_COHERENT_BIT;
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	bufferStorage(GL_ARRAY_BUFFER, regionSize * REGIONS, nullptr, flags);
+	mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * REGIONS, flags);
+	if (!mapped) {
+		Log::warn("STREAM_BUFFER could not map persistent storage; falling back");
+		// The storage is immutable, so the fallback needs a buffer of its own.
+		buffer = VertexBufferHandle();
+		return false;
+	}
+	return true;
+}
+
+
+void StreamBuffer::beginFrame() {
+	head = 0;
+	frameBytes = 0;
+
+	if (mode == Mode::ORPHANING) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+		return;
+	}
+
+	region = (region + 1) % REGIONS;
+	GLsync& fence = fences[region];
+	if (!fence) {
+		return;
+	}
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		waits++;
+		do {
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT);
+		} while (status == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+
+void StreamBuffer::endFrame() {
+	if (mode != Mode::ORPHANING && frameBytes > 0) {
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+
+bool StreamBuffer::write(const void* data, GLsizeiptr size, Allocation& allocation, GLsizeiptr alignment) {
+	GLsizeiptr start = (head + alignment - 1) / alignment * alignment;
+	if (size <= 0 || start + size > regionSize) {
+		overflows += size > 0;
+		return false;
+	}
+
+	GLintptr offset = GLintptr(region) * regionSize + start;
+	switch (mode) {
+	case Mode::PERSISTENT:
+		// Coherent, so nothing needs flushing.
+		std::memcpy(mapped + offset, data, size_t(size));
+		break;
+
+	case Mode::UNSYNCHRONIZED: {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		void* target = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (!target) {
+			return false;
+		}
+		std::memcpy(target, data, size_t(size));
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		break;
+	}
+
+	case Mode::ORPHANING:
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+		break;
+	}
+
+	head = start + size;
+	frameBytes += size_t(size);
+	allocation.buffer = buffer;
+	allocation.offset = offset;
+	return true;
+}
+
+
+const char* StreamBuffer::modeName(Mode mode) {
+	switch (mode) {
+	case Mode::PERSISTENT: return "persistent";
+	case Mode::UNSYNCHRONIZED: return "unsynchronized";
+	default: return "orphaning";
+	}
+}
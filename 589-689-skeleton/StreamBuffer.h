@@ -0,0 +1,90 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A ring buffer for vertex data that lives for a single frame, such as the
+// editing overlays, which are rebuilt every time they are drawn.
+//
+// The buffer is split into REGIONS equal parts, one per frame in flight.
+// Each frame writes into its own region, and a fence set at the end of the
+// frame tells a later frame when the GPU has finished reading it. No buffer
+// is allocated per frame, and writing never waits on the GPU unless it falls
+// more than REGIONS - 1 frames behind.
+//
+// How the data gets into the buffer depends on what the context offers:
+//
+//   PERSISTENT      glBufferStorage (GL 4.4 or ARB_buffer_storage, loaded at
+//                   run time since the GL 3.3 loader does not provide it),
+//                   mapped once for the buffer's whole life.
+//   UNSYNCHRONIZED  glMapBufferRange on each write, relying on the fences
+//                   instead of the driver for synchronisation.
+//   ORPHANING       glBufferData(nullptr) at the start of each frame and
+//                   glBufferSubData for writes, for drivers that handle
+//                   neither of the above well. Fences are not needed.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+class StreamBuffer {
+
+public:
+	enum class Mode { PERSISTENT, UNSYNCHRONIZED, ORPHANING };
+
+	static const int REGIONS = 3;
+
+	// Where write() put its data.
+	struct Allocation {
+		GLuint buffer = 0;
+		GLintptr offset = 0;
+	};
+
+	// regionSize is the most one frame can write. The best mode no later
+	// than preferred that the context supports is used.
+	explicit StreamBuffer(GLsizeiptr regionSize = 4 << 20, Mode preferred = Mode::PERSISTENT);
+	~StreamBuffer();
+
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+	// Moves on to the next region, waiting for the GPU if it is still
+	// reading it.
+	void beginFrame();
+	// Fences the current region once the frame's draws have been issued.
+	void endFrame();
+
+	// Copies size bytes to the current region, at a multiple of alignment.
+	// Returns false if the region is full.
+	bool write(const void* data, GLsizeiptr size, Allocation& allocation, GLsizeiptr alignment = 16);
+
+	GLuint getBuffer() const { return buffer; }
+	Mode getMode() const { return mode; }
+	GLsizeiptr getRegionSize() const { return regionSize; }
+
+	size_t getFrameBytes() const { return frameBytes; }
+	// Frames that had to wait for the GPU, and writes that did not fit.
+	size_t getWaits() const { return waits; }
+	size_t getOverflows() const { return overflows; }
+
+	static const char* modeName(Mode mode);
+
+private:
+	bool createPersistent();
+
+	VertexBufferHandle buffer;
+	Mode mode = Mode::ORPHANING;
+	GLsizeiptr regionSize;
+
+	// Persistent mode's mapping of the whole buffer.
+	char* mapped = nullptr;
+
+	GLsync fences[REGIONS] = {};
+	int region = 0;
+	GLsizeiptr head = 0;
+
+	size_t frameBytes = 0;
+	size_t waits = 0;
+	size_t overflows = 0;
+};
@@ -1,9 +1,43 @@
 #include "Surface.h"
+
+#include "Profiler.h"
+
 #include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Barycentric weights of (x, z) in the XZ projection of triangle abc. Returns
+// false if it lies outside, or the triangle has no area in XZ.
+bool barycentricXZ(float x, float z, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, glm::vec3& weights) {
+	const float EPSILON = 1e-5f;
+
+	glm::vec2 ab(b.x - a.x, b.z - a.z);
+	glm::vec2 ac(c.x - a.x, c.z - a.z);
+	glm::vec2 ap(x - a.x, z - a.z);
+	float det = ab.x * ac.y - ab.y * ac.x;
+	if (std::abs(det) < 1e-12f) {
+		return false;
+	}
+	float s = (ap.x * ac.y - ap.y * ac.x) / det;
+	float t = (ab.x * ap.y - ab.y * ap.x) / det;
+	if (s < -EPSILON || t < -EPSILON || s + t > 1.0f + EPSILON) {
+		return false;
+	}
+	weights = glm::vec3(1.0f - s - t, s, t);
+	return true;
+}
+
+}
 
 Surface::Surface(int controlSize, int kU, int kV, int resU, int resV)
-	: kU(kU), kV(kV), resU(resU), resV(resV)
+	: heightMap(0, GL_R32F, resV, resU, GL_RED, GL_FLOAT, GL_NEAREST)
+	, normalMap(0, GL_RGB16F, resV, resU, GL_RGB, GL_FLOAT, GL_LINEAR)
+	, kU(kU), kV(kV), resU(resU), resV(resV)
 {
+	// Brushing regenerates the surface every frame.
+	gpuGeom.setUsage(GL_DYNAMIC_DRAW);
+
 	// Initialize 2D control grid (flat terrain)
 	float spacing = 1.0f;
 	float half = (controlSize - 1) * spacing / 2.0f;
@@ -90,6 +124,7 @@ glm::vec3 Surface::E_delta(const std::vector<std::vector<glm::vec3>>& ctrlPts,
 }
 
 void Surface::generateSurface() {
+	PROFILE_SCOPE("Surface::generateSurface");
 	cpuGeom.verts.clear();
 	cpuGeom.normals.clear();
 	//cpuGeom.cols.clear();
@@ -100,49 +135,312 @@ void Surface::generateSurface() {
 	auto U = initializeKnot(kU, mU);
 	auto V = initializeKnot(kV, mV);
 
-	for (int i = 0; i < resU - 1; ++i) {
-		float u0 = float(i) / (resU - 1);
-		float u1 = float(i + 1) / (resU - 1);
-		for (int j = 0; j < resV - 1; ++j) {
-			float v0 = float(j) / (resV - 1);
-			float v1 = float(j + 1) / (resV - 1);
+	// Evaluate each grid point once; neighbouring cells share their corners.
+	std::vector<glm::vec3> previous = std::move(samples);
+	samples.resize(resU * resV);
+	int changedI0 = resU, changedI1 = -1, changedJ0 = resV, changedJ1 = -1;
+	for (int i = 0; i < resU; ++i) {
+		for (int j = 0; j < resV; ++j) {
+			glm::vec3 p = E_delta(controlGrid, U, V, float(i) / static_cast<float>(resU - 1), float(j) / static_cast<float>(resV - 1), kU, kV, mU, mV);
+			if (previous.size() != samples.size() || previous[i * resV + j] != p) {
+				changedI0 = std::min(changedI0, i);
+				changedI1 = std::max(changedI1, i);
+				changedJ0 = std::min(changedJ0, j);
+				changedJ1 = std::max(changedJ1, j);
+			}
+			samples[i * resV + j] = p;
+		}
+	}
 
-			//glm::vec3 p00 = evaluateSurfacePoint(u0, v0);
-			//glm::vec3 p10 = evaluateSurfacePoint(u1, v0);
-			//glm::vec3 p01 = evaluateSurfacePoint(u0, v1);
-			//glm::vec3 p11 = evaluateSurfacePoint(u1, v1);
+	// Only heights change under the brush; anything else moves the grid.
+	bool movedXZ = false;
+	for (size_t k = 0; k < samples.size() && !movedXZ; ++k) {
+		movedXZ = previous.size() != samples.size()
+			|| previous[k].x != samples[k].x || previous[k].z != samples[k].z;
+	}
+	if (movedXZ) {
+		gridStale = true;
+		buildCellLookup();
+	}
 
-			glm::vec3 p00 = E_delta(controlGrid, U, V, u0, v0, kU, kV, mU, mV);
-			glm::vec3 p10 = E_delta(controlGrid, U, V, u1, v0, kU, kV, mU, mV);
-			glm::vec3 p01 = E_delta(controlGrid, U, V, u0, v1, kU, kV, mU, mV);
-			glm::vec3 p11 = E_delta(controlGrid, U, V, u1, v1, kU, kV, mU, mV);
+	// A changed sample moves every triangle touching it, which reaches one
+	// sample further in each direction. The same goes for normals.
+	if (changedI1 >= 0) {
+		trianglesStale = true;
 
+		int i0 = std::max(changedI0 - 1, 0);
+		int i1 = std::min(changedI1 + 1, resU - 1);
+		int j0 = std::max(changedJ0 - 1, 0);
+		int j1 = std::min(changedJ1 + 1, resV - 1);
+		heights.resize(samples.size());
+		sampleNormals.resize(samples.size());
+		for (int i = i0; i <= i1; ++i) {
+			for (int j = j0; j <= j1; ++j) {
+				glm::vec3 alongU = samples[std::min(i + 1, resU - 1) * resV + j] - samples[std::max(i - 1, 0) * resV + j];
+				glm::vec3 alongV = samples[i * resV + std::min(j + 1, resV - 1)] - samples[i * resV + std::max(j - 1, 0)];
+				glm::vec3 n = glm::cross(alongU, alongV);
+				n = glm::length(n) > 0.0f ? glm::normalize(n) : glm::vec3(0.0f, 1.0f, 0.0f);
+				sampleNormals[i * resV + j] = n.y < 0.0f ? -n : n;
+				heights[i * resV + j] = samples[i * resV + j].y;
+			}
+		}
+		markTexelsStale(i0, i1, j0, j1);
 
+		// Samples may have moved in XZ, so take the box over every changed
+		// sample where it is now and where it was.
+		glm::vec2 lowXZ(samples[i0 * resV + j0].x, samples[i0 * resV + j0].z);
+		glm::vec2 highXZ = lowXZ;
+		bool hadPrevious = previous.size() == samples.size();
+		for (int i = i0; i <= i1; ++i) {
+			for (int j = j0; j <= j1; ++j) {
+				glm::vec3 p = samples[i * resV + j];
+				lowXZ = glm::min(lowXZ, glm::vec2(p.x, p.z));
+				highXZ = glm::max(highXZ, glm::vec2(p.x, p.z));
+				if (hadPrevious) {
+					glm::vec3 q = previous[i * resV + j];
+					lowXZ = glm::min(lowXZ, glm::vec2(q.x, q.z));
+					highXZ = glm::max(highXZ, glm::vec2(q.x, q.z));
+				}
+			}
+		}
+
+		dirtyLow = hasDirtyRegion ? glm::min(dirtyLow, lowXZ) : lowXZ;
+		dirtyHigh = hasDirtyRegion ? glm::max(dirtyHigh, highXZ) : highXZ;
+		hasDirtyRegion = true;
+	}
+
+	// Cells are emitted chunk by chunk, so each chunk's triangles form one
+	// contiguous vertex range that can be culled and drawn on its own.
+	chunks.clear();
+	for (int ci = 0; ci < resU - 1; ci += CHUNK_CELLS) {
+		for (int cj = 0; cj < resV - 1; cj += CHUNK_CELLS) {
+			Chunk chunk;
+			chunk.first = GLint(cpuGeom.verts.size());
+
+			for (int i = ci; i < std::min(ci + CHUNK_CELLS, resU - 1); ++i) {
+				for (int j = cj; j < std::min(cj + CHUNK_CELLS, resV - 1); ++j) {
+					glm::vec3 p00 = samples[i * resV + j];
+					glm::vec3 p10 = samples[(i + 1) * resV + j];
+					glm::vec3 p01 = samples[i * resV + j + 1];
+					glm::vec3 p11 = samples[(i + 1) * resV + j + 1];
 
-			// First triangle
-			cpuGeom.verts.push_back(p00);
-			cpuGeom.verts.push_back(p10);
-			cpuGeom.verts.push_back(p01);
+					// First triangle
+					cpuGeom.verts.push_back(p00);
+					cpuGeom.verts.push_back(p10);
+					cpuGeom.verts.push_back(p01);
 
-			// Second triangle
-			cpuGeom.verts.push_back(p01);
-			cpuGeom.verts.push_back(p10);
-			cpuGeom.verts.push_back(p11);
+					// Second triangle
+					cpuGeom.verts.push_back(p01);
+					cpuGeom.verts.push_back(p10);
+					cpuGeom.verts.push_back(p11);
 
-			// Colors (for now all green)
-			//for (int k = 0; k < 6; ++k)
-			//	cpuGeom.cols.push_back(glm::vec3(0.2f, 0.8f, 0.3f));
+					chunk.bounds.expand(p00);
+					chunk.bounds.expand(p10);
+					chunk.bounds.expand(p01);
+					chunk.bounds.expand(p11);
+				}
+			}
+
+			chunk.count = GLsizei(cpuGeom.verts.size() - chunk.first);
+			chunks.push_back(chunk);
 		}
 	}
-	gpuGeom.bind();
-	gpuGeom.setVerts(cpuGeom.verts);
 	//gpuGeom.setCols(cpuGeom.cols);
 }
 
 void Surface::bind() {
-	gpuGeom.bind();
+	size_t uploaded = 0;
+	if (renderMode == RenderMode::TRIANGLES) {
+		gpuGeom.bind();
+		if (trianglesStale) {
+			gpuGeom.setVerts(cpuGeom.verts);
+			uploaded += sizeof(glm::vec3) * cpuGeom.verts.size();
+			trianglesStale = false;
+		}
+	}
+	else {
+		grid.bind();
+		if (gridStale) {
+			uploadGrid();
+			uploaded += sizeof(glm::vec3) * samples.size() + sizeof(unsigned int) * gridIndexCount;
+		}
+		if (texelI1 >= 0) {
+			uploaded += size_t(texelI1 - texelI0 + 1) * (texelJ1 - texelJ0 + 1) * (sizeof(float) + sizeof(glm::vec3));
+			uploadTexels();
+		}
+		glActiveTexture(GL_TEXTURE1);
+		normalMap.bind();
+		glActiveTexture(GL_TEXTURE0);
+		heightMap.bind();
+	}
+	if (uploaded > 0) {
+		lastUploadBytes = uploaded;
+	}
+
+	// There is no colour array, so shaders read the generic value. That is
+	// context state other geometry's constant attributes also set, so the
+	// surface's black is set here.
+	glVertexAttrib4f(3, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void Surface::draw(GLint first, GLsizei count) {
+	if (renderMode == RenderMode::TRIANGLES) {
+		glDrawArrays(GL_TRIANGLES, first, count);
+	}
+	else {
+		// The grid's indices follow the triangle list vertex for vertex.
+		glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * first));
+	}
+}
+
+void Surface::setRenderMode(RenderMode mode) {
+	// Each representation keeps track of its own changes, so switching
+	// only uploads what the new one missed.
+	renderMode = mode;
+}
+
+void Surface::markTexelsStale(int i0, int i1, int j0, int j1) {
+	bool any = texelI1 >= 0;
+	texelI0 = any ? std::min(texelI0, i0) : i0;
+	texelI1 = any ? std::max(texelI1, i1) : i1;
+	texelJ0 = any ? std::min(texelJ0, j0) : j0;
+	texelJ1 = any ? std::max(texelJ1, j1) : j1;
+}
+
+void Surface::uploadTexels() {
+	GLsizei width = texelJ1 - texelJ0 + 1;
+	GLsizei height = texelI1 - texelI0 + 1;
+	size_t first = size_t(texelI0) * resV + texelJ0;
+
+	// Rows of the rectangle are resV samples apart in the arrays.
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, resV);
+	heightMap.bind();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, texelJ0, texelI0, width, height, GL_RED, GL_FLOAT, &heights[first]);
+	normalMap.bind();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, texelJ0, texelI0, width, height, GL_RGB, GL_FLOAT, &sampleNormals[first]);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	texelI1 = texelJ1 = -1;
+}
+
+void Surface::uploadGrid() {
+	// Heights come from the height map, so only XZ is stored.
+	std::vector<glm::vec3> verts(samples.size());
+	for (size_t k = 0; k < samples.size(); ++k) {
+		verts[k] = glm::vec3(samples[k].x, 0.0f, samples[k].z);
+	}
+
+	// Same chunks, cells and triangles as generateSurface() emits.
+	std::vector<unsigned int> indices;
+	indices.reserve(cpuGeom.verts.size());
+	for (int ci = 0; ci < resU - 1; ci += CHUNK_CELLS) {
+		for (int cj = 0; cj < resV - 1; cj += CHUNK_CELLS) {
+			for (int i = ci; i < std::min(ci + CHUNK_CELLS, resU - 1); ++i) {
+				for (int j = cj; j < std::min(cj + CHUNK_CELLS, resV - 1); ++j) {
+					unsigned int i00 = i * resV + j;
+					unsigned int i10 = (i + 1) * resV + j;
+					unsigned int i01 = i * resV + j + 1;
+					unsigned int i11 = (i + 1) * resV + j + 1;
+					indices.insert(indices.end(), { i00, i10, i01, i01, i10, i11 });
+				}
+			}
+		}
+	}
+
+	grid.setVerts(verts);
+	grid.setIndices(indices);
+	gridIndexCount = indices.size();
+	gridStale = false;
 }
 
 size_t Surface::numVerts() {
 	return cpuGeom.verts.size();
+}
+
+bool Surface::takeDirtyRegion(glm::vec2& low, glm::vec2& high) {
+	if (!hasDirtyRegion) {
+		return false;
+	}
+	low = dirtyLow;
+	high = dirtyHigh;
+	hasDirtyRegion = false;
+	return true;
+}
+
+void Surface::buildCellLookup() {
+	minXZ = glm::vec2(samples[0].x, samples[0].z);
+	maxXZ = minXZ;
+	for (const glm::vec3& p : samples) {
+		minXZ = glm::min(minXZ, glm::vec2(p.x, p.z));
+		maxXZ = glm::max(maxXZ, glm::vec2(p.x, p.z));
+	}
+
+	// About one hash cell per surface cell, however the samples have moved.
+	glm::vec2 extent = maxXZ - minXZ;
+	float spacing = std::max(extent.x / static_cast<float>(resV - 1), extent.y / static_cast<float>(resU - 1));
+	cellLookup = SpatialHash(spacing > 0.0f ? spacing : 1.0f);
+
+	for (int i = 0; i < resU - 1; ++i) {
+		for (int j = 0; j < resV - 1; ++j) {
+			glm::vec3 p00 = samples[i * resV + j];
+			glm::vec3 p10 = samples[(i + 1) * resV + j];
+			glm::vec3 p01 = samples[i * resV + j + 1];
+			glm::vec3 p11 = samples[(i + 1) * resV + j + 1];
+			glm::vec3 low = glm::min(glm::min(p00, p10), glm::min(p01, p11));
+			glm::vec3 high = glm::max(glm::max(p00, p10), glm::max(p01, p11));
+			cellLookup.insert(uint32_t(i * (resV - 1) + j), glm::vec2(low.x, low.z), glm::vec2(high.x, high.z));
+		}
+	}
+}
+
+bool Surface::locate(float x, float z, glm::vec3& a, glm::vec3& b, glm::vec3& c, glm::vec3& weights) const {
+	if (samples.empty() || x < minXZ.x || x > maxXZ.x || z < minXZ.y || z > maxXZ.y) {
+		return false;
+	}
+
+	bool found = false;
+	glm::vec2 p(x, z);
+	cellLookup.query(p, p, [&](uint32_t cell) {
+		if (found) {
+			return;
+		}
+		int i = int(cell) / (resV - 1);
+		int j = int(cell) % (resV - 1);
+		glm::vec3 p00 = samples[i * resV + j];
+		glm::vec3 p10 = samples[(i + 1) * resV + j];
+		glm::vec3 p01 = samples[i * resV + j + 1];
+		glm::vec3 p11 = samples[(i + 1) * resV + j + 1];
+
+		// Same split as the two triangles generateSurface() emits per cell.
+		if (barycentricXZ(x, z, p00, p10, p01, weights)) {
+			a = p00; b = p10; c = p01;
+			found = true;
+		}
+		else if (barycentricXZ(x, z, p11, p01, p10, weights)) {
+			a = p11; b = p01; c = p10;
+			found = true;
+		}
+	});
+	return found;
+}
+
+bool Surface::heightAt(float x, float z, float& height) const {
+	glm::vec3 a, b, c, w;
+	if (!locate(x, z, a, b, c, w)) {
+		return false;
+	}
+	height = w.x * a.y + w.y * b.y + w.z * c.y;
+	return true;
+}
+
+bool Surface::normalAt(float x, float z, glm::vec3& normal) const {
+	glm::vec3 a, b, c, w;
+	if (!locate(x, z, a, b, c, w)) {
+		return false;
+	}
+	normal = glm::normalize(glm::cross(b - a, c - a));
+	if (normal.y < 0.0f) {
+		normal = -normal;
+	}
+	return true;
 }
\ No newline at end of file
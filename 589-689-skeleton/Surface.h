@@ -1,6 +1,9 @@
 #pragma once
 
+#include "Bounds.h"
 #include "Geometry.h"
+#include "SpatialHash.h"
+#include "Texture.h"
 #include <vector>
 #include "glm/glm.hpp"
 
@@ -8,10 +11,62 @@ class Surface {
 public:
 	Surface(int controlSize, int kU, int kV, int resU, int resV);
 
-	void generateSurface();      // Compute surface + upload to GPU
-	void bind();                 // Bind VAO
+	// How the surface reaches the GPU.
+	//
+	//   TRIANGLES   the triangle list from getTriangles(), re-uploaded in
+	//               full whenever the surface changes.
+	//   HEIGHT_MAP  a static indexed grid, one vertex per sample, raised by
+	//               terrain.vert from an R32F height map (plus an RGB16F
+	//               normal map for shaders that light the terrain). Edits
+	//               only upload the rectangle of texels that changed. The
+	//               grid itself is re-uploaded only if samples move in XZ.
+	enum class RenderMode { TRIANGLES, HEIGHT_MAP };
+
+	void generateSurface();      // Compute surface
+	// Uploads whatever generateSurface() changed for the current mode, then
+	// binds the VAO, and in HEIGHT_MAP mode the height and normal maps to
+	// texture units 0 and 1.
+	void bind();
 	size_t numVerts();           // For draw call
 
+	// Draws triangle list vertices [first, first + count), e.g. a range of
+	// chunks, in the current mode. bind() must have been called.
+	void draw(GLint first, GLsizei count);
+
+	void setRenderMode(RenderMode mode);
+	RenderMode getRenderMode() const { return renderMode; }
+
+	// Bytes uploaded by the last bind().
+	size_t getLastUploadBytes() const { return lastUploadBytes; }
+
+	// Height and normal of the surface above (x, z), interpolated over the
+	// triangle containing it. Both return false outside the surface. They only
+	// read the last generated samples, so they are safe to call concurrently
+	// with each other.
+	bool heightAt(float x, float z, float& height) const;
+	bool normalAt(float x, float z, glm::vec3& normal) const;
+
+	// The surface as a triangle list, three vertices per triangle.
+	const std::vector<glm::vec3>& getTriangles() const { return cpuGeom.verts; }
+
+	// Square blocks of CHUNK_CELLS x CHUNK_CELLS cells, each drawable as
+	// glDrawArrays(GL_TRIANGLES, first, count) after bind().
+	struct Chunk {
+		AABB bounds;
+		GLint first = 0;
+		GLsizei count = 0;
+	};
+	static const int CHUNK_CELLS = 4;
+	const std::vector<Chunk>& getChunks() const { return chunks; }
+
+	// XZ box around everything generateSurface() has changed since the last
+	// call, including the first generation. Returns false if nothing changed.
+	bool takeDirtyRegion(glm::vec2& low, glm::vec2& high);
+
+	// XZ extent of the generated surface, over every sample.
+	glm::vec2 getMinXZ() const { return minXZ; }
+	glm::vec2 getMaxXZ() const { return maxXZ; }
+
 	std::vector<std::vector<glm::vec3>> getControlGrid() { return controlGrid; }
     void updateControlPoint(int index, const glm::vec3 offset) {  
        int i = 0;  
@@ -26,12 +81,51 @@ public:
 private:
 	std::vector<std::vector<glm::vec3>> controlGrid;
 	CPU_Geometry cpuGeom;
+	// resU x resV evaluated points; row i is u = i / (resU - 1).
+	std::vector<glm::vec3> samples;
+
+	std::vector<Chunk> chunks;
+
+	// Dragging control points moves samples in XZ, so cells are found
+	// through their XZ boxes rather than from the grid's spacing. Both are
+	// rebuilt only when a sample moves in XZ.
+	glm::vec2 minXZ = glm::vec2(0.0f);
+	glm::vec2 maxXZ = glm::vec2(0.0f);
+	SpatialHash cellLookup;
+	void buildCellLookup();
+
+	bool hasDirtyRegion = false;
+	glm::vec2 dirtyLow;
+	glm::vec2 dirtyHigh;
 	GPU_Geometry gpuGeom;
 
+	RenderMode renderMode = RenderMode::HEIGHT_MAP;
+	// Per-sample heights and normals, laid out as the textures: row i, texel j.
+	std::vector<float> heights;
+	std::vector<glm::vec3> sampleNormals;
+	Texture heightMap;
+	Texture normalMap;
+	GPU_Geometry grid;
+	size_t gridIndexCount = 0;
+
+	// What bind() still has to upload: the triangle list, the grid, and the
+	// samples [texelI0, texelI1] x [texelJ0, texelJ1] of the textures.
+	bool trianglesStale = true;
+	bool gridStale = true;
+	int texelI0, texelI1 = -1, texelJ0, texelJ1 = -1;
+	size_t lastUploadBytes = 0;
+
+	void markTexelsStale(int i0, int i1, int j0, int j1);
+	void uploadTexels();
+	void uploadGrid();
+
 	int kU, kV;
 	int resU, resV;
 
 	std::vector<double> initializeKnot(int k, int m);
+	// Finds the triangle under (x, z), as emitted by generateSurface(). Where
+	// drags have folded the surface over itself, the first one found.
+	bool locate(float x, float z, glm::vec3& a, glm::vec3& b, glm::vec3& c, glm::vec3& weights) const;
 	glm::vec3 E_delta(const std::vector<std::vector<glm::vec3>>& ctrlPts,
 		const std::vector<double>& U, const std::vector<double>& V, float u, float v,
 		int kU, int kV, int mU, int mV);
@@ -3,10 +3,12 @@
 #include <stb/stb_image.h>
 
 #include "Log.h"
+#include "Profiler.h"
 
 Texture::Texture(std::string path, GLint interpolation)
 	: textureID(), path(path), interpolation(interpolation)
 {
+	PROFILE_SCOPE("Texture::Texture (file)");
 	int numComponents;
 	stbi_set_flip_vertically_on_load(true);
 	const char* pathData = path.c_str();
@@ -0,0 +1,63 @@
+#include "ThreadPool.h"
+
+#include "Profiler.h"
+
+namespace {
+	thread_local bool workerThread = false;
+}
+
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	// hardware_concurrency() may report 0. The calling thread also takes a share
+	// of every parallelFor(), so one worker fewer than the core count is enough.
+	if (threadCount > 1) threadCount -= 1;
+	if (threadCount == 0) threadCount = 1;
+
+	workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		workers.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+
+ThreadPool& ThreadPool::shared() {
+	static ThreadPool pool;
+	return pool;
+}
+
+
+bool ThreadPool::isWorkerThread() {
+	return workerThread;
+}
+
+
+void ThreadPool::workerLoop() {
+	workerThread = true;
+	PROFILE_THREAD("Worker");
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty()) {
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
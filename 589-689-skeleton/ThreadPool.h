@@ -0,0 +1,103 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A small fixed-size worker pool for CPU-side geometry work (mesh generation,
+// normal accumulation, scattering, ...). GL calls must stay on the main thread.
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool {
+
+public:
+	explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+
+	// Workers are joined, so copying or moving the pool makes no sense.
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool();
+
+	// Process-wide pool sized to the hardware.
+	static ThreadPool& shared();
+
+	unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+	template <typename F>
+	std::future<void> submit(F&& task) {
+		auto packaged = std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+		std::future<void> result = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			tasks.emplace([packaged]() { (*packaged)(); });
+		}
+		queueCondition.notify_one();
+		return result;
+	}
+
+	// Splits [0, count) into at most size() + 1 chunks of at least minChunk items
+	// and calls fn(begin, end, chunkIndex) for each. The calling thread runs the
+	// first chunk itself and returns once every chunk has finished.
+	// Returns the number of chunks used.
+	//
+	// Called from one of the pool's own workers, the chunks run inline instead:
+	// queueing them and waiting could deadlock once every worker is waiting.
+	template <typename F>
+	size_t parallelFor(size_t count, size_t minChunk, F&& fn) {
+		size_t chunks = chunkCount(count, minChunk);
+		if (chunks <= 1) {
+			if (count > 0) fn(size_t(0), count, size_t(0));
+			return count > 0 ? 1 : 0;
+		}
+
+		size_t chunkSize = (count + chunks - 1) / chunks;
+		if (isWorkerThread()) {
+			for (size_t c = 0; c < chunks; ++c) {
+				fn(c * chunkSize, std::min(count, (c + 1) * chunkSize), c);
+			}
+			return chunks;
+		}
+
+		std::vector<std::future<void>> pending;
+		pending.reserve(chunks - 1);
+		for (size_t c = 1; c < chunks; ++c) {
+			size_t begin = c * chunkSize;
+			size_t end = std::min(count, begin + chunkSize);
+			pending.push_back(submit([&fn, begin, end, c]() { fn(begin, end, c); }));
+		}
+		fn(size_t(0), std::min(count, chunkSize), size_t(0));
+
+		for (auto& f : pending) {
+			f.get();
+		}
+		return chunks;
+	}
+
+	// True on threads owned by any ThreadPool.
+	static bool isWorkerThread();
+
+	// Number of chunks parallelFor() would use for the same arguments.
+	size_t chunkCount(size_t count, size_t minChunk) const {
+		if (minChunk == 0) minChunk = 1;
+		size_t chunks = std::min<size_t>(size() + 1, count / minChunk);
+		return std::max<size_t>(chunks, count > 0 ? 1 : 0);
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool stopping = false;
+
+	void workerLoop();
+};
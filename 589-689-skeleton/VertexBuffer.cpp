@@ -5,25 +5,34 @@
 
 VertexBuffer::VertexBuffer(GLuint index, GLint size, GLenum dataType)
 	: bufferID{}
+	, capacity(0)
+	, capacityUsage(GL_STATIC_DRAW)
 	, attribArrayEnabled(false)
 	, attribIndex(index)
 	, attribSize(size)
 	, attribDataType(dataType)
+	, attribBuffer(0)
+	, attribOffset(0)
 {}
 
 
 void VertexBuffer::uploadData(GLsizeiptr size, const void* data, GLenum usage) {
 	if (size > 0) {
 		bind();
-		glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+		bool dynamic = usage == GL_DYNAMIC_DRAW || usage == GL_STREAM_DRAW;
+		if (dynamic && usage == capacityUsage && size <= capacity) {
+			glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, usage);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+		}
+		else {
+			glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+			capacity = size;
+			capacityUsage = usage;
+		}
 
 		// If we have data and did not yet set up and enable the AttribArray
-		// with this vertex buffer, then we do so now.
-		if (!attribArrayEnabled) {
-			glVertexAttribPointer(attribIndex, attribSize, attribDataType, GL_FALSE, 0, (void*)0);
-			glEnableVertexAttribArray(attribIndex);
-			attribArrayEnabled = true;
-		}
+		// with this vertex buffer, or it was last streamed, then we do so now.
+		pointAttrib(bufferID, 0);
 	}
 	else if (attribArrayEnabled) {
 		// If there's no data, we disable use of an array for this attrib
@@ -38,4 +47,38 @@ void VertexBuffer::uploadData(GLsizeiptr size, const void* data, GLenum usage) {
 		attribArrayEnabled = false;
 	}
 
+}
+
+
+void VertexBuffer::streamData(StreamBuffer& stream, GLsizeiptr size, const void* data) {
+	StreamBuffer::Allocation allocation;
+	if (size > 0 && stream.write(data, size, allocation)) {
+		pointAttrib(allocation.buffer, allocation.offset);
+	}
+	else {
+		uploadData(size, data, GL_STREAM_DRAW);
+	}
+}
+
+
+void VertexBuffer::pointAttrib(GLuint buffer, GLintptr offset) {
+	if (attribArrayEnabled && attribBuffer == buffer && attribOffset == offset) {
+		return;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glVertexAttribPointer(attribIndex, attribSize, attribDataType, GL_FALSE, 0, (void*)offset);
+	if (!attribArrayEnabled) {
+		glEnableVertexAttribArray(attribIndex);
+		attribArrayEnabled = true;
+	}
+	attribBuffer = buffer;
+	attribOffset = offset;
+}
+
+
+void VertexBuffer::updateData(GLintptr offset, GLsizeiptr size, const void* data) {
+	if (size > 0) {
+		bind();
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+	}
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GLHandles.h"
+#include "StreamBuffer.h"
 
 #include <glad/glad.h>
 
@@ -19,10 +20,24 @@ public:
 
 	// Public interface
 	void bind() const { glBindBuffer(GL_ARRAY_BUFFER, bufferID); }
+	// With GL_DYNAMIC_DRAW or GL_STREAM_DRAW, uploads that fit in the
+	// storage of the previous one orphan it instead of allocating anew, so
+	// the driver can recycle it without waiting on draws still reading it.
 	void uploadData(GLsizeiptr size, const void* data, GLenum usage);
+	// Writes data to stream's current frame and points the attribute there,
+	// for data drawn once. Falls back to uploadData() with GL_STREAM_DRAW if
+	// the frame's share of stream is full. The VAO must be bound.
+	void streamData(StreamBuffer& stream, GLsizeiptr size, const void* data);
+	// Overwrites size bytes at offset within storage from a prior uploadData().
+	void updateData(GLintptr offset, GLsizeiptr size, const void* data);
 
 private:
+	// Points the attribute at offset bytes into buffer, if not already.
+	void pointAttrib(GLuint buffer, GLintptr offset);
+
 	VertexBufferHandle bufferID;
+	GLsizeiptr capacity;
+	GLenum capacityUsage;
 
 	// The use of this bool is to only enable or disable "AttribArray" when
 	// absolutely required. It assumes that no other areas of the code will
@@ -34,5 +49,8 @@ private:
 	GLuint attribIndex;
 	GLint attribSize;
 	GLenum attribDataType;
+	// Where the attribute reads from: this buffer or a stream.
+	GLuint attribBuffer;
+	GLintptr attribOffset;
 };
 
@@ -0,0 +1,128 @@
+#include "VertexLayout.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+
+namespace {
+
+struct FormatInfo {
+	GLint components;
+	GLenum type;
+	GLboolean normalized;
+	GLsizei size;
+};
+
+FormatInfo infoOf(VertexLayout::Format format) {
+	switch (format) {
+	case VertexLayout::Format::FLOAT2: return { 2, GL_FLOAT, GL_FALSE, 8 };
+	case VertexLayout::Format::FLOAT3: return { 3, GL_FLOAT, GL_FALSE, 12 };
+	case VertexLayout::Format::HALF4: return { 4, GL_HALF_FLOAT, GL_FALSE, 8 };
+	case VertexLayout::Format::SNORM16x4: return { 4, GL_SHORT, GL_TRUE, 8 };
+	case VertexLayout::Format::UNORM16x2: return { 2, GL_UNSIGNED_SHORT, GL_TRUE, 4 };
+	case VertexLayout::Format::SNORM10x3: return { 4, GL_INT_2_10_10_10_REV, GL_TRUE, 4 };
+	case VertexLayout::Format::UNORM8x4: return { 4, GL_UNSIGNED_BYTE, GL_TRUE, 4 };
+	}
+	return { 3, GL_FLOAT, GL_FALSE, 12 };
+}
+
+template <typename T>
+void store(const T& value, unsigned char* out) {
+	std::memcpy(out, &value, sizeof(T));
+}
+
+}
+
+
+VertexLayout& VertexLayout::add(GLuint location, Format format) {
+	Attribute attribute;
+	attribute.location = location;
+	attribute.format = format;
+	attribute.offset = stride;
+	attributes.push_back(attribute);
+	stride += sizeOf(format);
+	return *this;
+}
+
+
+VertexLayout& VertexLayout::addConstant(GLuint location, const glm::vec4& value) {
+	Attribute attribute;
+	attribute.location = location;
+	attribute.constant = true;
+	attribute.value = value;
+	attributes.push_back(attribute);
+	return *this;
+}
+
+
+void VertexLayout::apply(GLuint buffer, GLintptr offset) const {
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (const Attribute& attribute : attributes) {
+		if (attribute.constant) {
+			glDisableVertexAttribArray(attribute.location);
+			continue;
+		}
+		FormatInfo info = infoOf(attribute.format);
+		glVertexAttribPointer(attribute.location, info.components, info.type, info.normalized, stride, (void*)(offset + attribute.offset));
+		glEnableVertexAttribArray(attribute.location);
+	}
+}
+
+
+void VertexLayout::applyConstants() const {
+	for (const Attribute& attribute : attributes) {
+		if (attribute.constant) {
+			glVertexAttrib4fv(attribute.location, &attribute.value[0]);
+		}
+	}
+}
+
+
+void VertexLayout::encode(Format format, const glm::vec4& value, unsigned char* out) {
+	switch (format) {
+	case Format::FLOAT2:
+		store(glm::vec2(value), out);
+		break;
+	case Format::FLOAT3:
+		store(glm::vec3(value), out);
+		break;
+	case Format::HALF4:
+		store(glm::packHalf4x16(value), out);
+		break;
+	case Format::SNORM16x4:
+		store(glm::packSnorm4x16(value), out);
+		break;
+	case Format::UNORM16x2:
+		store(glm::packUnorm2x16(glm::vec2(value)), out);
+		break;
+	case Format::SNORM10x3:
+		store(glm::packSnorm3x10_1x2(glm::vec4(glm::vec3(value), 0.0f)), out);
+		break;
+	case Format::UNORM8x4:
+		store(glm::packUnorm4x8(value), out);
+		break;
+	}
+}
+
+
+GLsizei VertexLayout::sizeOf(Format format) {
+	return infoOf(format).size;
+}
+
+
+bool VertexLayout::operator==(const VertexLayout& other) const {
+	if (stride != other.stride || attributes.size() != other.attributes.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < attributes.size(); ++i) {
+		const Attribute& a = attributes[i];
+		const Attribute& b = other.attributes[i];
+		if (a.location != b.location || a.format != b.format || a.offset != b.offset
+			|| a.constant != b.constant || a.value != b.value) {
+			return false;
+		}
+	}
+	return true;
+}
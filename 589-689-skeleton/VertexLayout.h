@@ -0,0 +1,66 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// How vertex attributes are laid out in one interleaved buffer, and in what
+// format each is stored.
+//
+// Compact formats are all ones GL turns back into floats by itself, so the
+// shaders read them as the vec2/vec3 they always did:
+//
+//   SNORM16x4   positions mapped into [-1, 1], to be scaled back by the
+//               model matrix (see PackedVertices::decode)
+//   HALF4       the same, or colours that may exceed 1
+//   SNORM10x3   unit normals, 10 bits per component (GL_INT_2_10_10_10_REV)
+//   UNORM16x2   texture coordinates in [0, 1]
+//   UNORM8x4    colours in [0, 1]
+//
+// An attribute every vertex shares can be a constant instead: it takes no
+// space in the buffer, and applyConstants() sets it before each draw.
+//------------------------------------------------------------------------------
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class VertexLayout {
+
+public:
+	enum class Format { FLOAT2, FLOAT3, HALF4, SNORM16x4, UNORM16x2, SNORM10x3, UNORM8x4 };
+
+	struct Attribute {
+		GLuint location = 0;
+		Format format = Format::FLOAT3;
+		GLsizei offset = 0;
+		bool constant = false;
+		glm::vec4 value = glm::vec4(0.0f);
+	};
+
+	// Appends an attribute stored per vertex after the previous ones.
+	VertexLayout& add(GLuint location, Format format);
+	// An attribute with the same value for every vertex.
+	VertexLayout& addConstant(GLuint location, const glm::vec4& value);
+
+	GLsizei getStride() const { return stride; }
+	const std::vector<Attribute>& getAttributes() const { return attributes; }
+
+	// Points the bound VAO's attributes at buffer, which holds vertices in
+	// this layout from offset bytes on, and disables the constant ones'
+	// arrays. Locations not in the layout are left alone.
+	void apply(GLuint buffer, GLintptr offset = 0) const;
+
+	// Current attribute values are context state, not VAO state, so these
+	// must be set again before every draw.
+	void applyConstants() const;
+
+	// Writes value in format to out, which must have sizeOf(format) bytes.
+	static void encode(Format format, const glm::vec4& value, unsigned char* out);
+	static GLsizei sizeOf(Format format);
+
+	bool operator==(const VertexLayout& other) const;
+	bool operator!=(const VertexLayout& other) const { return !(*this == other); }
+
+private:
+	std::vector<Attribute> attributes;
+	GLsizei stride = 0;
+};
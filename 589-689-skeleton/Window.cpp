@@ -10,37 +10,55 @@
 // ---------------------------
 
 void Window::keyMetaCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->keyCallback(key, scancode, action, mods);
+	Window* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+	self->eventCount++;
+	self->callbacks->keyCallback(key, scancode, action, mods);
 }
 
 
 void Window::mouseButtonMetaCallback(GLFWwindow* window, int button, int action, int mods) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->mouseButtonCallback(button, action, mods);
+	Window* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+	self->eventCount++;
+	self->callbacks->mouseButtonCallback(button, action, mods);
 }
 
 
 void Window::cursorPosMetaCallback(GLFWwindow* window, double xpos, double ypos) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->cursorPosCallback(xpos, ypos);
+	Window* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+	self->eventCount++;
+	self->callbacks->cursorPosCallback(xpos, ypos);
 }
 
 
 void Window::scrollMetaCallback(GLFWwindow* window, double xoffset, double yoffset) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->scrollCallback(xoffset, yoffset);
+	Window* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+	self->eventCount++;
+	self->callbacks->scrollCallback(xoffset, yoffset);
 }
 
 
 void Window::windowSizeMetaCallback(GLFWwindow* window, int width, int height) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->windowSizeCallback(width, height);
+	Window* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+	self->eventCount++;
+	self->callbacks->windowSizeCallback(width, height);
 }
 
 void Window::framebufferSizeMetaCallback(GLFWwindow* window, int width, int height) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->framebufferSizeCallback(width, height);
+	Window* self = static_cast<Window*>(glfwGetWindowUserPointer(window));
+	self->eventCount++;
+	self->callbacks->framebufferSizeCallback(width, height);
+}
+
+void Window::refreshMetaCallback(GLFWwindow* window) {
+	static_cast<Window*>(glfwGetWindowUserPointer(window))->eventCount++;
+}
+
+void Window::focusMetaCallback(GLFWwindow* window, int focused) {
+	static_cast<Window*>(glfwGetWindowUserPointer(window))->eventCount++;
+}
+
+void Window::cursorEnterMetaCallback(GLFWwindow* window, int entered) {
+	static_cast<Window*>(glfwGetWindowUserPointer(window))->eventCount++;
 }
 
 // ----------------------
@@ -120,8 +138,9 @@ void Window::setupImGui()
 }
 
 void Window::connectCallbacks() {
-	// set userdata of window to point to the object that carries out the callbacks
-	glfwSetWindowUserPointer(window.get(), callbacks.get());
+	// set userdata of window to point to this, which counts events and passes
+	// them on to the object that carries out the callbacks
+	glfwSetWindowUserPointer(window.get(), this);
 
 	// bind meta callbacks to actual callbacks
 	glfwSetKeyCallback(window.get(), keyMetaCallback);
@@ -130,6 +149,10 @@ void Window::connectCallbacks() {
 	glfwSetScrollCallback(window.get(), scrollMetaCallback);
 	glfwSetWindowSizeCallback(window.get(), windowSizeMetaCallback);
 	glfwSetFramebufferSizeCallback(window.get(), framebufferSizeMetaCallback);
+	// Set before ImGui installs its own, which chain to these.
+	glfwSetWindowRefreshCallback(window.get(), refreshMetaCallback);
+	glfwSetWindowFocusCallback(window.get(), focusMetaCallback);
+	glfwSetCursorEnterCallback(window.get(), cursorEnterMetaCallback);
 }
 
 
@@ -139,6 +162,12 @@ void Window::setCallbacks(std::shared_ptr<CallbackInterface> callbacks_) {
 }
 
 
+size_t Window::takeEventCount() {
+	size_t count = eventCount;
+	eventCount = 0;
+	return count;
+}
+
 glm::ivec2 Window::getPos() const {
 	int x, y;
 	glfwGetWindowPos(window.get(), &x, &y);
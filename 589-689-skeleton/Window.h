@@ -66,6 +66,10 @@ public:
 	);
 	Window(int width, int height, const char* title, GLFWmonitor* monitor = NULL, GLFWwindow* share = NULL);
 
+	// GLFW holds a pointer to this, so it must stay put.
+	Window(const Window&) = delete;
+	Window& operator=(const Window&) = delete;
+
 	void setCallbacks(std::shared_ptr<CallbackInterface> callbacks);
 
 	glm::ivec2 getPos() const;
@@ -81,6 +85,10 @@ public:
 	void makeContextCurrent() { glfwMakeContextCurrent(window.get()); }
 	void swapBuffers() { glfwSwapBuffers(window.get()); }
 
+	// Input and window events (including ones ImGui consumes, and the
+	// window needing a repaint) received since the last call.
+	size_t takeEventCount();
+
 	void setupImGui();
 
 	glm::ivec2 getFramebufferSize() const;
@@ -89,6 +97,8 @@ private:
 	std::unique_ptr<GLFWwindow, WindowDeleter> window; // owning ptr (from GLFW)
 	std::shared_ptr<CallbackInterface> callbacks;      // optional shared owning ptr (user provided)
 
+	size_t eventCount = 0;
+
 	void connectCallbacks();
 
 	// Meta callback functions. These bind to the actual glfw callback,
@@ -99,5 +109,9 @@ private:
 	static void scrollMetaCallback(GLFWwindow* window, double xoffset, double yoffset);
 	static void windowSizeMetaCallback(GLFWwindow* window, int width, int height);
 	static void framebufferSizeMetaCallback(GLFWwindow* window, int width, int height);
+	// These only count as events; CallbackInterface has nothing for them.
+	static void refreshMetaCallback(GLFWwindow* window);
+	static void focusMetaCallback(GLFWwindow* window, int focused);
+	static void cursorEnterMetaCallback(GLFWwindow* window, int entered);
 };
 
@@ -24,6 +24,8 @@
 #include "PlantPart.h"
 
 #include "GeomLoaderForOBJ.h"
+#include "Headless.h"
+#include "Profiler.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
@@ -31,21 +33,36 @@
 #include "Surface.h"
 #include "PointsData.h"
 
-int main() {
+int main(int argc, char** argv) {
 	Log::debug("Starting main");
+	PROFILE_THREAD("Main");
+
+	// --headless draws offscreen instead; see Headless.h for its options.
+	Headless::Settings headless;
+	if (!Headless::parseArguments(argc, argv, headless)) {
+		return 1;
+	}
 
 	// WINDOW
 	glfwInit();
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-	Window window(1200, 1200, "CPSC 589/689"); // could set callbacks at construction if desired
+	if (headless.enabled) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+	Window window(headless.enabled ? headless.width : 1200, headless.enabled ? headless.height : 1200, "CPSC 589/689"); // could set callbacks at construction if desired
 
 	//GLDebug::enable();
 
 	// SHADERS
 	ShaderProgram shader("shaders/test.vert", "shaders/test.frag");
 	ShaderProgram cpShader("shaders/controlPoints.vert", "shaders/controlPoints.frag");
+	ShaderProgram terrainShader("shaders/terrain.vert", "shaders/controlPoints.frag");
 	ShaderProgram editingShader("shaders/editing.vert", "shaders/editing.frag");
 	ShaderProgram pickerShader("shaders/test.vert", "shaders/picker.frag");
+	ShaderProgram instancedShader("shaders/instanced.vert", "shaders/instanced.frag");
+	ShaderProgram impostorBakeShader("shaders/impostorBake.vert", "shaders/impostorBake.frag");
+	ShaderProgram impostorShader("shaders/impostor.vert", "shaders/impostor.frag");
+	ShaderProgram sweepShader("shaders/sweep.vert", "shaders/test.frag");
 
 	auto cb = std::make_shared<Callbacks3D>(shader, pickerShader, window.getWidth(), window.getHeight());
 	// CALLBACKS
@@ -56,20 +73,42 @@ int main() {
 	std::unordered_map<std::string, ShaderProgram*> shaders = {
 		{"default", &shader},
 		{"controlPoint", &cpShader},
+		{"terrain", &terrainShader},
 		{"picker", &pickerShader},
-		{"editing", &editingShader}
+		{"editing", &editingShader},
+		{"instanced", &instancedShader},
+		{"impostorBake", &impostorBakeShader},
+		{"impostor", &impostorShader},
+		{"sweep", &sweepShader}
 	};
 
 	Scene scene(window, cb, shaders);
 
 	// RENDER LOOP
-	while (!window.shouldClose()) {
-		glfwPollEvents();
+	// Frames are only drawn when something could have changed; in between,
+	// the loop sleeps until an event arrives or the scene's timeout passes.
+	int status = 0;
+	if (headless.enabled) {
+		status = Headless::run(scene, window, headless);
+	}
+	bool drew = true;
+	while (!headless.enabled && !window.shouldClose()) {
+		if (drew) {
+			glfwPollEvents();
+		}
+		else {
+			glfwWaitEventsTimeout(scene.getIdleTimeout());
+		}
+		if (window.takeEventCount() > 0) {
+			scene.requestRedraw();
+		}
 
 		scene.updateScene();
-		scene.draw();
-
-		window.swapBuffers();
+		drew = scene.needsRedraw();
+		if (drew) {
+			scene.draw();
+			window.swapBuffers();
+		}
 	}
 
 	// Cleanup
@@ -78,5 +117,5 @@ int main() {
 	ImGui::DestroyContext();
 
 	glfwTerminate();
-	return 0;
+	return status;
 }
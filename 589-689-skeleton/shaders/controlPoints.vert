@@ -5,8 +5,12 @@ layout (location = 3) in vec3 col;
 out vec3 C;
 
 uniform mat4 M;
-uniform mat4 V;
-uniform mat4 P;
+// See FrameUniforms.
+layout (std140) uniform Frame {
+	mat4 V;
+	mat4 P;
+	vec4 cameraPos;
+};
 
 void main() {
 	C = col;
@@ -0,0 +1,49 @@
+#version 330 core
+
+in vec3 fragPos;
+in vec2 atlasUV;
+flat in mat3 toWorld;
+flat in vec3 tint;
+flat in float fade;
+
+uniform sampler2D colorAtlas;
+uniform sampler2D normalAtlas;
+
+uniform vec3 lightPos;
+uniform vec3 lightCol;
+
+uniform vec3 diffuseCol;
+uniform float ambientStrength;
+
+out vec4 color;
+
+// 4x4 ordered dither threshold in [0, 1), shared with instanced.frag.
+float bayer(vec2 p) {
+	int x = int(mod(p.x, 4.0));
+	int y = int(mod(p.y, 4.0));
+	int m[16] = int[16](0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5);
+	return (float(m[y * 4 + x]) + 0.5) / 16.0;
+}
+
+void main() {
+	// The mesh draws the pixels where this fails, so the two cross-fade.
+	if (bayer(gl_FragCoord.xy) >= fade) {
+		discard;
+	}
+
+	vec4 albedo = texture(colorAtlas, atlasUV);
+	if (albedo.a < 0.5) {
+		discard;
+	}
+
+	vec3 norm = normalize(toWorld * (texture(normalAtlas, atlasUV).xyz * 2.0 - 1.0));
+	vec3 lightDir = normalize(lightPos - fragPos);
+
+	float distance = length(lightPos - fragPos);
+	float attenuation = 1.0 / (distance * distance);
+	float diffuseStrength = max(0.0, dot(norm, lightDir)) * attenuation;
+
+	vec3 diffuseCol = diffuseStrength * diffuseCol + albedo.rgb * tint;
+
+	color = vec4(lightCol * (vec3(ambientStrength) + diffuseCol), 1.0);
+}
@@ -0,0 +1,68 @@
+#version 330 core
+
+// One camera-facing quad per plant copy, drawn as a four vertex strip.
+layout (location = 5) in int instanceIndex;
+uniform samplerBuffer instances;
+
+// See FrameUniforms.
+layout (std140) uniform Frame {
+	mat4 V;
+	mat4 P;
+	vec4 cameraPos;
+};
+
+// Bounding sphere the atlas frames were fitted to, in plant space.
+uniform vec3 center;
+uniform float radius;
+uniform int frames;
+
+uniform float fadeStart;
+uniform float fadeWidth;
+
+out vec3 fragPos;
+out vec2 atlasUV;
+flat out mat3 toWorld;
+flat out vec3 tint;
+flat out float fade;
+
+vec2 signNotZero(vec2 v) {
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Octahedral mapping with y as the pole; see ImpostorAtlas::frameDirection.
+vec2 octEncode(vec3 d) {
+	d /= abs(d.x) + abs(d.y) + abs(d.z);
+	vec2 e = d.xz;
+	if (d.y < 0.0) {
+		e = (1.0 - abs(e.yx)) * signNotZero(e);
+	}
+	return e;
+}
+
+void main() {
+	int base = instanceIndex * 6;
+	mat4 instanceM = mat4(texelFetch(instances, base), texelFetch(instances, base + 1), texelFetch(instances, base + 2), texelFetch(instances, base + 3));
+	tint = texelFetch(instances, base + 4).rgb;
+
+	float scale = length(instanceM[0].xyz);
+	toWorld = mat3(instanceM) / scale;
+	vec3 worldCenter = vec3(instanceM * vec4(center, 1.0));
+
+	// Same measure as PlantPopulation::cull() and instanced.vert.
+	fade = clamp((distance(cameraPos.xyz, instanceM[3].xyz) - fadeStart) / fadeWidth, 0.0, 1.0);
+
+	// The view direction in plant space picks the frame.
+	vec3 localDir = normalize(transpose(toWorld) * (cameraPos.xyz - worldCenter));
+	vec2 cell = clamp(floor((octEncode(localDir) * 0.5 + 0.5) * float(frames)), 0.0, float(frames - 1));
+
+	// Same basis the frames were rendered with, so the quad faces the camera.
+	vec3 upRef = abs(localDir.y) > 0.99 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+	vec3 right = normalize(cross(upRef, localDir));
+	vec3 up = cross(localDir, right);
+
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+	atlasUV = (cell + corner * 0.5 + 0.5) / float(frames);
+
+	fragPos = worldCenter + toWorld * (right * corner.x + up * corner.y) * radius * scale;
+	gl_Position = P * V * vec4(fragPos, 1.0);
+}
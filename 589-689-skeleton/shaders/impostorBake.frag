@@ -0,0 +1,12 @@
+#version 330 core
+
+in vec3 n;
+in vec3 baseColor;
+
+layout (location = 0) out vec4 color;
+layout (location = 1) out vec4 normal;
+
+void main() {
+	color = vec4(baseColor, 1.0);
+	normal = vec4(normalize(n) * 0.5 + 0.5, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 uv;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec3 cols;
+
+// M takes the part into plant space, which is what the atlas stores.
+uniform mat4 M;
+uniform mat3 normalMatrix;
+// The atlas frame's camera rather than the scene's.
+uniform mat4 V;
+uniform mat4 P;
+
+out vec3 n;
+out vec3 baseColor;
+
+void main() {
+	baseColor = cols;
+	n = normalMatrix * normal;
+
+	gl_Position = P * V * M * vec4(pos, 1.0);
+}
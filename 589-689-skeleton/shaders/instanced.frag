@@ -0,0 +1,48 @@
+#version 330 core
+
+in vec3 fragPos;
+in vec2 fragUV;
+in vec3 n;
+in vec3 baseColor;
+flat in float fade;
+
+uniform vec3 lightPos;
+uniform vec3 lightCol;
+
+uniform vec3 diffuseCol;
+uniform float ambientStrength;
+
+uniform int texExistence;
+
+uniform sampler2D tex;
+
+out vec4 color;
+
+// 4x4 ordered dither threshold in [0, 1), shared with impostor.frag.
+float bayer(vec2 p) {
+	int x = int(mod(p.x, 4.0));
+	int y = int(mod(p.y, 4.0));
+	int m[16] = int[16](0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5);
+	return (float(m[y * 4 + x]) + 0.5) / 16.0;
+}
+
+void main() {
+	// Fading out towards the impostor; see impostor.frag.
+	if (bayer(gl_FragCoord.xy) < fade) {
+		discard;
+	}
+
+	vec3 norm = normalize(n);
+	vec3 lightDir = normalize(lightPos - fragPos);
+
+	float distance = length(lightPos - fragPos);
+	float attenuation = 1.0 / (distance * distance);
+	float diffuseStrength = max(0.0, dot(norm, lightDir)) * attenuation;
+
+	vec3 diffuseCol = diffuseStrength * diffuseCol + baseColor;
+	if (texExistence == 1) {
+		diffuseCol = diffuseStrength * texture(tex, fragUV).rgb;
+	}
+
+	color = vec4(lightCol * (vec3(ambientStrength) + diffuseCol), 1.0);
+}
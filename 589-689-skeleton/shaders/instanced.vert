@@ -0,0 +1,69 @@
+#version 330 core
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 uv;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec3 cols;
+
+// Which copy this instance is; its transform, tint and wind parameters are
+// six texels of instances starting at instanceIndex * 6.
+layout (location = 5) in int instanceIndex;
+uniform samplerBuffer instances;
+
+// The part's transform within its plant, shared by every instance.
+uniform mat4 M;
+uniform mat3 normalMatrix;
+// See FrameUniforms.
+layout (std140) uniform Frame {
+	mat4 V;
+	mat4 P;
+	vec4 cameraPos;
+};
+
+uniform float fadeStart;
+uniform float fadeWidth;
+
+// See PlantPopulation::WindSettings. plantHeight is the top of the plant's
+// parts in plant space; uv.y runs from 0 to 1 along each part's sweep.
+uniform float time;
+uniform vec2 windDirection;
+uniform float windStrength;
+uniform float windFrequency;
+uniform float plantHeight;
+
+out vec3 fragPos;
+out vec2 fragUV;
+out vec3 n;
+out vec3 baseColor;
+flat out float fade;
+
+void main() {
+	int base = instanceIndex * 6;
+	mat4 instanceM = mat4(texelFetch(instances, base), texelFetch(instances, base + 1), texelFetch(instances, base + 2), texelFetch(instances, base + 3));
+	vec3 instanceTint = texelFetch(instances, base + 4).rgb;
+	vec2 instanceWind = texelFetch(instances, base + 5).xy;
+
+	mat4 model = instanceM * M;
+
+	// Same measure as PlantPopulation::cull() and impostor.vert.
+	fade = clamp((distance(cameraPos.xyz, instanceM[3].xyz) - fadeStart) / fadeWidth, 0.0, 1.0);
+
+	fragUV = uv;
+	baseColor = cols * instanceTint;
+
+	// Copies are only rotated and uniformly scaled, so their own rotation
+	// turns normals correctly; fragment shaders normalise.
+	n = mat3(instanceM) * (normalMatrix * normal);
+
+	// The copy bends with the square of its height, gusting between 0.2 and
+	// 1 of full strength, while each part flutters towards its tip. At most
+	// 1.15 * windStrength of the copy's height, as PlantPopulation assumes.
+	float h = clamp((M * vec4(pos, 1.0)).y / max(plantHeight, 1e-4), 0.0, 1.0);
+	float t = time * windFrequency + instanceWind.x;
+	float gust = 0.6 + 0.25 * sin(t) + 0.15 * sin(2.7 * t + 1.3);
+	float flutter = 0.15 * uv.y * sin(5.0 * t + 6.0 * uv.y);
+	float sway = windStrength / instanceWind.y * (h * h * gust + flutter) * plantHeight * length(instanceM[1].xyz);
+
+	fragPos = vec3(model * vec4(pos, 1.0)) + vec3(windDirection.x, 0.0, windDirection.y) * sway;
+
+	gl_Position = P * V * vec4(fragPos, 1.0);
+}
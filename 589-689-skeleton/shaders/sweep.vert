@@ -0,0 +1,87 @@
+#version 330 core
+
+// Rebuilds a part's sweep surface from its curve samples; see GPUSweep.
+// Each instance is the band between rings gl_InstanceID and gl_InstanceID + 1,
+// drawn as a strip alternating between the two rings around the profile.
+
+// Two texels per ring: the left and right curve points.
+uniform samplerBuffer rings;
+// The cross-section samples, normalised by profileMatrix and reflected to
+// close the profile as in PlantPart::generateSurfaceFast().
+uniform samplerBuffer profile;
+uniform mat4 profileMatrix;
+uniform int ringCount;
+uniform int curveSize;
+
+uniform vec3 sweepColor;
+
+uniform mat4 M;
+uniform mat3 normalMatrix;
+// See FrameUniforms.
+layout (std140) uniform Frame {
+	mat4 V;
+	mat4 P;
+	vec4 cameraPos;
+};
+
+out vec3 fragPos;
+out vec2 fragUV;
+out vec3 n;
+out vec3 baseColor;
+
+int profilePoints() {
+	return 2 * curveSize - 2;
+}
+
+vec3 profilePoint(int j) {
+	j = (j + profilePoints()) % profilePoints();
+	bool reflected = j >= curveSize;
+	vec3 p = (profileMatrix * vec4(texelFetch(profile, reflected ? profilePoints() - j : j).xyz, 1.0)).xyz;
+	if (reflected) {
+		p.z = -p.z;
+	}
+	return p;
+}
+
+// The profile scaled and turned to span the ring's left and right points.
+vec3 surfacePoint(int i, int j) {
+	i = clamp(i, 0, ringCount - 1);
+	vec3 ql = texelFetch(rings, 2 * i).xyz;
+	vec3 qr = texelFetch(rings, 2 * i + 1).xyz;
+	vec3 axis = qr - ql;
+	vec3 mid = (ql + qr) * 0.5;
+
+	// cos and sin of the axis' angle from x, times its length.
+	float c = axis.x;
+	float s = length(axis.yz);
+
+	vec3 p = profilePoint(j);
+	return vec3(c * p.x - s * p.y, s * p.x + c * p.y, length(axis) * p.z) + mid;
+}
+
+void main() {
+	int i = gl_InstanceID + (gl_VertexID & 1);
+	int j = gl_VertexID / 2;
+
+	vec3 pos = surfacePoint(i, j);
+
+	// Rings where the curves meet collapse to a point, so take the direction
+	// around the profile from the next ring inwards.
+	vec3 around = surfacePoint(i, j + 1) - surfacePoint(i, j - 1);
+	if (dot(around, around) < 1e-12) {
+		int inward = i < ringCount / 2 ? i + 1 : i - 1;
+		around = surfacePoint(inward, j + 1) - surfacePoint(inward, j - 1);
+	}
+	vec3 along = surfacePoint(i + 1, j) - surfacePoint(i - 1, j);
+	vec3 normal = cross(around, along);
+	normal = dot(normal, normal) > 0.0 ? normalize(normal) : vec3(0.0, 1.0, 0.0);
+
+	fragUV = vec2(float(j) / float(profilePoints()), float(i) / float(ringCount - 1));
+	baseColor = sweepColor;
+
+	n = normalMatrix * normal;
+
+	fragPos = vec3(M * vec4(pos, 1.0));
+
+	gl_Position = P * V * M * vec4(pos, 1.0);
+}
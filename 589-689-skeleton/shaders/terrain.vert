@@ -0,0 +1,25 @@
+#version 330 core
+// The grid's XZ; the height is the vertex's texel of heightMap (see Surface).
+layout (location = 0) in vec3 pos;
+layout (location = 3) in vec3 col;
+
+uniform sampler2D heightMap;
+
+out vec3 C;
+
+uniform mat4 M;
+// See FrameUniforms.
+layout (std140) uniform Frame {
+	mat4 V;
+	mat4 P;
+	vec4 cameraPos;
+};
+
+void main() {
+	// The grid has one vertex per texel, row by row.
+	int width = textureSize(heightMap, 0).x;
+	float height = texelFetch(heightMap, ivec2(gl_VertexID % width, gl_VertexID / width), 0).r;
+
+	C = col;
+	gl_Position = P * V * M * vec4(pos.x, height, pos.z, 1.0);
+}
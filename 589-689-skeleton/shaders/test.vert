@@ -5,8 +5,13 @@ layout (location = 2) in vec3 normal;
 layout (location = 3) in vec3 cols;
 
 uniform mat4 M;
-uniform mat4 V;
-uniform mat4 P;
+uniform mat3 normalMatrix;
+// See FrameUniforms.
+layout (std140) uniform Frame {
+	mat4 V;
+	mat4 P;
+	vec4 cameraPos;
+};
 
 out vec3 fragPos;
 out vec2 fragUV;
@@ -17,9 +22,7 @@ void main() {
 	fragUV = uv;
 	baseColor = cols;
 
-	// If you need extra efficiency, you may want to calculate the mat3 on
-	// the CPU instead and then upload it as a uniform.
-	n = mat3(transpose(inverse(M))) * normal;  
+	n = normalMatrix * normal;
 
 	fragPos = vec3(M * vec4(pos, 1.0));
 